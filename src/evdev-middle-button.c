@@ -23,8 +23,9 @@
 #include <stdint.h>
 
 #include "evdev.h"
+#include "usdt.h"
 
-#define MIDDLEBUTTON_TIMEOUT 50
+#define MIDDLEBUTTON_TIMEOUT ms2us(50)
 
 /*****************************************
  * BEFORE YOU EDIT THIS FILE, look at the state diagram in
@@ -77,6 +78,24 @@ middlebutton_event_to_str(enum evdev_middlebutton_event event)
 	return NULL;
 }
 
+static const char *
+middlebutton_state_trace_name(int state)
+{
+	return middlebutton_state_to_str(state);
+}
+
+static const char *
+middlebutton_event_trace_name(int event)
+{
+	return middlebutton_event_to_str(event);
+}
+
+static const struct state_trace_machine middlebutton_trace_machine = {
+	.name = "middlebutton",
+	.state_to_str = middlebutton_state_trace_name,
+	.event_to_str = middlebutton_event_trace_name,
+};
+
 static void
 middlebutton_state_error(struct evdev_device *device,
 			 enum evdev_middlebutton_event event)
@@ -546,6 +565,12 @@ evdev_middlebutton_handle_event(struct evdev_device *device,
 		break;
 	}
 
+	usdt_probe(middlebutton_state, device->sysname, current, event,
+		   device->middlebutton.state);
+	state_trace_record(&device->state_trace, &middlebutton_trace_machine,
+			   time, STATE_TRACE_NO_TOUCH,
+			   current, event, device->middlebutton.state);
+
 	log_debug(device->base.seat->libinput,
 		  "middlebuttonstate: %s → %s → %s, rc %d\n",
 		  middlebutton_state_to_str(current),
@@ -28,10 +28,11 @@
 #include "linux/input.h"
 
 #include "evdev-mt-touchpad.h"
+#include "usdt.h"
 
 #define DEFAULT_BUTTON_MOTION_THRESHOLD 0.02 /* 2% of size */
-#define DEFAULT_BUTTON_ENTER_TIMEOUT 100 /* ms */
-#define DEFAULT_BUTTON_LEAVE_TIMEOUT 300 /* ms */
+#define DEFAULT_BUTTON_ENTER_TIMEOUT ms2us(100)
+#define DEFAULT_BUTTON_LEAVE_TIMEOUT ms2us(300)
 
 /*****************************************
  * BEFORE YOU EDIT THIS FILE, look at the state diagram in
@@ -77,6 +78,24 @@ button_event_to_str(enum button_event event) {
 	return NULL;
 }
 
+static const char *
+button_state_trace_name(int state)
+{
+	return button_state_to_str(state);
+}
+
+static const char *
+button_event_trace_name(int event)
+{
+	return button_event_to_str(event);
+}
+
+static const struct state_trace_machine button_trace_machine = {
+	.name = "softbutton",
+	.state_to_str = button_state_trace_name,
+	.event_to_str = button_event_trace_name,
+};
+
 static inline bool
 is_inside_bottom_button_area(struct tp_dispatch *tp, struct tp_touch *t)
 {
@@ -129,14 +148,14 @@ static void
 tp_button_set_enter_timer(struct tp_dispatch *tp, struct tp_touch *t)
 {
 	libinput_timer_set(&t->button.timer,
-			   t->millis + DEFAULT_BUTTON_ENTER_TIMEOUT);
+			   t->time + DEFAULT_BUTTON_ENTER_TIMEOUT);
 }
 
 static void
 tp_button_set_leave_timer(struct tp_dispatch *tp, struct tp_touch *t)
 {
 	libinput_timer_set(&t->button.timer,
-			   t->millis + DEFAULT_BUTTON_LEAVE_TIMEOUT);
+			   t->time + DEFAULT_BUTTON_LEAVE_TIMEOUT);
 }
 
 /*
@@ -419,6 +438,12 @@ tp_button_handle_event(struct tp_dispatch *tp,
 		break;
 	}
 
+	usdt_probe(button_state, tp->device->sysname, t - tp->touches,
+		   current, event, t->button.state);
+	state_trace_record(&tp->device->state_trace, &button_trace_machine,
+			   time, t - tp->touches,
+			   current, event, t->button.state);
+
 	if (current != t->button.state)
 		log_debug(libinput,
 			  "button state: from %s, event %s to %s\n",
@@ -794,8 +819,8 @@ tp_notify_clickpadbutton(struct tp_dispatch *tp,
 		struct evdev_dispatch *dispatch = tp->buttons.trackpoint->dispatch;
 		struct input_event event;
 
-		event.time.tv_sec = time/1000;
-		event.time.tv_usec = (time % 1000) * 1000;
+		event.time.tv_sec = time / ms2us(1000);
+		event.time.tv_usec = time % ms2us(1000);
 		event.type = EV_KEY;
 		event.code = button;
 		event.value = (state == LIBINPUT_BUTTON_STATE_PRESSED) ? 1 : 0;
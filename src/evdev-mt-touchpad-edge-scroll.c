@@ -31,7 +31,7 @@
 
 #define CASE_RETURN_STRING(a) case a: return #a
 
-#define DEFAULT_SCROLL_LOCK_TIMEOUT 300 /* ms */
+#define DEFAULT_SCROLL_LOCK_TIMEOUT ms2us(300)
 /* Use a reasonably large threshold until locked into scrolling mode, to
    avoid accidentally locking in scrolling mode when trying to use the entire
    touchpad to move the pointer. The user can wait for the timeout to trigger
@@ -106,7 +106,7 @@ tp_edge_scroll_set_state(struct tp_dispatch *tp,
 		t->scroll.edge = tp_touch_get_edge(tp, t);
 		t->scroll.initial = t->point;
 		libinput_timer_set(&t->scroll.timer,
-				   t->millis + DEFAULT_SCROLL_LOCK_TIMEOUT);
+				   t->time + DEFAULT_SCROLL_LOCK_TIMEOUT);
 		break;
 	case EDGE_SCROLL_TOUCH_STATE_EDGE:
 		break;
@@ -29,22 +29,22 @@
 
 #include "evdev-mt-touchpad.h"
 
-#define DEFAULT_GESTURE_SWITCH_TIMEOUT 100 /* ms */
+#define DEFAULT_GESTURE_SWITCH_TIMEOUT ms2us(100)
 
-static struct normalized_coords
+static motion_coords_t
 tp_get_touches_delta(struct tp_dispatch *tp, bool average)
 {
 	struct tp_touch *t;
 	unsigned int i, nchanged = 0;
-	struct normalized_coords normalized;
-	struct normalized_coords delta = {0.0, 0.0};
+	motion_coords_t normalized;
+	motion_coords_t delta = {0, 0};
 
 	for (i = 0; i < tp->num_slots; i++) {
 		t = &tp->touches[i];
 
 		if (tp_touch_active(tp, t) && t->dirty) {
 			nchanged++;
-			normalized = tp_get_delta(t);
+			normalized = tp_get_motion(t);
 
 			delta.x += normalized.x;
 			delta.y += normalized.y;
@@ -60,13 +60,13 @@ tp_get_touches_delta(struct tp_dispatch *tp, bool average)
 	return delta;
 }
 
-static inline struct normalized_coords
+static inline motion_coords_t
 tp_get_combined_touches_delta(struct tp_dispatch *tp)
 {
 	return tp_get_touches_delta(tp, false);
 }
 
-static inline struct normalized_coords
+static inline motion_coords_t
 tp_get_average_touches_delta(struct tp_dispatch *tp)
 {
 	return tp_get_touches_delta(tp, true);
@@ -89,7 +89,7 @@ tp_gesture_start(struct tp_dispatch *tp, uint64_t time)
 static void
 tp_gesture_post_pointer_motion(struct tp_dispatch *tp, uint64_t time)
 {
-	struct normalized_coords delta, unaccel;
+	motion_coords_t delta, unaccel;
 
 	/* When a clickpad is clicked, combine motion of all active touches */
 	if (tp->buttons.is_clickpad && tp->buttons.state)
@@ -97,9 +97,9 @@ tp_gesture_post_pointer_motion(struct tp_dispatch *tp, uint64_t time)
 	else
 		unaccel = tp_get_average_touches_delta(tp);
 
-	delta = tp_filter_motion(tp, &unaccel, time);
+	delta = tp_filter_pointer_motion(tp, &unaccel, time);
 
-	if (!normalized_is_zero(delta) || !normalized_is_zero(unaccel)) {
+	if (!motion_is_zero(delta) || !motion_is_zero(unaccel)) {
 		pointer_notify_motion(&tp->device->base, time,
 				      &delta, &unaccel);
 	}
@@ -121,7 +121,8 @@ tp_gesture_post_twofinger_scroll(struct tp_dispatch *tp, uint64_t time)
 
 		delta = tp_get_delta(&tp->touches[0]);
 	} else {
-		delta = tp_get_average_touches_delta(tp);
+		delta = motion_to_normalized(
+				tp_get_average_touches_delta(tp));
 	}
 
 	delta = tp_filter_motion(tp, &delta, time);
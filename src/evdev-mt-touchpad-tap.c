@@ -33,11 +33,12 @@
 #include <unistd.h>
 
 #include "evdev-mt-touchpad.h"
+#include "usdt.h"
 
 #define CASE_RETURN_STRING(a) case a: return #a
 
-#define DEFAULT_TAP_TIMEOUT_PERIOD 180
-#define DEFAULT_DRAG_TIMEOUT_PERIOD 500
+#define DEFAULT_TAP_TIMEOUT_PERIOD ms2us(180)
+#define DEFAULT_DRAG_TIMEOUT_PERIOD ms2us(500)
 #define DEFAULT_TAP_MOVE_THRESHOLD TP_MM_TO_DPI_NORMALIZED(3)
 
 enum tap_event {
@@ -97,6 +98,24 @@ tap_event_to_str(enum tap_event event)
 }
 #undef CASE_RETURN_STRING
 
+static const char *
+tap_state_trace_name(int state)
+{
+	return tap_state_to_str(state);
+}
+
+static const char *
+tap_event_trace_name(int event)
+{
+	return tap_event_to_str(event);
+}
+
+static const struct state_trace_machine tap_trace_machine = {
+	.name = "tap",
+	.state_to_str = tap_state_trace_name,
+	.event_to_str = tap_event_trace_name,
+};
+
 static void
 tp_tap_notify(struct tp_dispatch *tp,
 	      uint64_t time,
@@ -635,6 +654,12 @@ tp_tap_handle_event(struct tp_dispatch *tp,
 	if (tp->tap.state == TAP_STATE_IDLE || tp->tap.state == TAP_STATE_DEAD)
 		tp_tap_clear_timer(tp);
 
+	usdt_probe(tap_state, tp->device->sysname, current, event,
+		   tp->tap.state);
+	state_trace_record(&tp->device->state_trace, &tap_trace_machine,
+			   time, t ? t - tp->touches : STATE_TRACE_NO_TOUCH,
+			   current, event, tp->tap.state);
+
 	log_debug(libinput,
 		  "tap state: %s → %s → %s\n",
 		  tap_state_to_str(current),
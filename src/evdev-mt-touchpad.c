@@ -33,9 +33,9 @@
  * TP_MAGIC_SLOWDOWN in filter.c */
 #define DEFAULT_ACCEL_NUMERATOR 3000.0
 #define DEFAULT_HYSTERESIS_MARGIN_DENOMINATOR 700.0
-#define DEFAULT_TRACKPOINT_ACTIVITY_TIMEOUT 500 /* ms */
-#define DEFAULT_KEYBOARD_ACTIVITY_TIMEOUT_1 200 /* ms */
-#define DEFAULT_KEYBOARD_ACTIVITY_TIMEOUT_2 500 /* ms */
+#define DEFAULT_TRACKPOINT_ACTIVITY_TIMEOUT ms2us(500)
+#define DEFAULT_KEYBOARD_ACTIVITY_TIMEOUT_1 ms2us(200)
+#define DEFAULT_KEYBOARD_ACTIVITY_TIMEOUT_2 ms2us(500)
 #define FAKE_FINGER_OVERFLOW (1 << 7)
 
 static inline int
@@ -73,6 +73,18 @@ tp_filter_motion(struct tp_dispatch *tp,
 			       unaccelerated, tp, time);
 }
 
+motion_coords_t
+tp_filter_pointer_motion(struct tp_dispatch *tp,
+			 const motion_coords_t *unaccelerated,
+			 uint64_t time)
+{
+	if (motion_is_zero(*unaccelerated))
+		return *unaccelerated;
+
+	return filter_dispatch_motion(tp->device->pointer.filter,
+				      unaccelerated, tp, time);
+}
+
 static inline void
 tp_motion_history_push(struct tp_touch *t)
 {
@@ -199,7 +211,7 @@ tp_new_touch(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 	t->has_ended = false;
 	t->state = TOUCH_HOVERING;
 	t->pinned.is_pinned = false;
-	t->millis = time;
+	t->time = time;
 	tp->queued |= TOUCHPAD_EVENT_MOTION;
 }
 
@@ -208,7 +220,7 @@ tp_begin_touch(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 {
 	t->dirty = true;
 	t->state = TOUCH_BEGIN;
-	t->millis = time;
+	t->time = time;
 	tp->nfingers_down++;
 	assert(tp->nfingers_down >= 1);
 }
@@ -236,7 +248,7 @@ tp_end_touch(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 	t->palm.state = PALM_NONE;
 	t->state = TOUCH_END;
 	t->pinned.is_pinned = false;
-	t->millis = time;
+	t->time = time;
 	assert(tp->nfingers_down >= 1);
 	tp->nfingers_down--;
 	tp->queued |= TOUCHPAD_EVENT_MOTION;
@@ -252,17 +264,26 @@ tp_end_sequence(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 	tp_end_touch(tp, t, time);
 }
 
+#ifdef HAVE_FIXED_POINT
+static fixed_t
+tp_estimate_delta(int x0, int x1, int x2, int x3)
+{
+	return fixed_from_int(x0 + x1 - x2 - x3) / 4;
+}
+#else
 static double
 tp_estimate_delta(int x0, int x1, int x2, int x3)
 {
 	return (x0 + x1 - x2 - x3) / 4.0;
 }
+#endif
 
-struct normalized_coords
-tp_get_delta(struct tp_touch *t)
+motion_coords_t
+tp_get_motion(struct tp_touch *t)
 {
-	struct device_float_coords delta;
-	const struct normalized_coords zero = { 0.0, 0.0 };
+	struct tp_dispatch *tp = t->tp;
+	motion_coords_t delta;
+	const motion_coords_t zero = { 0, 0 };
 
 	if (t->history.count < TOUCHPAD_MIN_SAMPLES)
 		return zero;
@@ -276,7 +297,21 @@ tp_get_delta(struct tp_touch *t)
 				    tp_motion_history_offset(t, 2)->y,
 				    tp_motion_history_offset(t, 3)->y);
 
-	return tp_normalize_delta(t->tp, delta);
+#ifdef HAVE_FIXED_POINT
+	delta.x = fixed_mul(delta.x, tp->accel.x_scale_coeff);
+	delta.y = fixed_mul(delta.y, tp->accel.y_scale_coeff);
+#else
+	delta.x *= tp->accel.x_scale_coeff;
+	delta.y *= tp->accel.y_scale_coeff;
+#endif
+
+	return delta;
+}
+
+struct normalized_coords
+tp_get_delta(struct tp_touch *t)
+{
+	return motion_to_normalized(tp_get_motion(t));
 }
 
 static void
@@ -289,13 +324,13 @@ tp_process_absolute(struct tp_dispatch *tp,
 	switch(e->code) {
 	case ABS_MT_POSITION_X:
 		t->point.x = e->value;
-		t->millis = time;
+		t->time = time;
 		t->dirty = true;
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case ABS_MT_POSITION_Y:
 		t->point.y = e->value;
-		t->millis = time;
+		t->time = time;
 		t->dirty = true;
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
@@ -323,13 +358,13 @@ tp_process_absolute_st(struct tp_dispatch *tp,
 	switch(e->code) {
 	case ABS_X:
 		t->point.x = e->value;
-		t->millis = time;
+		t->time = time;
 		t->dirty = true;
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
 	case ABS_Y:
 		t->point.y = e->value;
-		t->millis = time;
+		t->time = time;
 		t->dirty = true;
 		tp->queued |= TOUCHPAD_EVENT_MOTION;
 		break;
@@ -484,7 +519,7 @@ tp_palm_tap_is_palm(struct tp_dispatch *tp, struct tp_touch *t)
 static void
 tp_palm_detect(struct tp_dispatch *tp, struct tp_touch *t, uint64_t time)
 {
-	const int PALM_TIMEOUT = 200; /* ms */
+	const uint64_t PALM_TIMEOUT = ms2us(200);
 	const int DIRECTIONS = NE|E|SE|SW|W|NW;
 	struct device_float_coords delta;
 	int dirs;
@@ -759,6 +794,11 @@ tp_interface_process(struct evdev_dispatch *dispatch,
 		break;
 	case EV_SYN:
 		tp_handle_state(tp, time);
+
+		/* Top software buttons are posted through the trackpoint,
+		 * which never sees this frame's SYN_REPORT */
+		if (tp->buttons.trackpoint)
+			pointer_notify_frame(&tp->buttons.trackpoint->base);
 		break;
 	}
 }
@@ -796,9 +836,10 @@ tp_interface_destroy(struct evdev_dispatch *dispatch)
 {
 	struct tp_dispatch *tp =
 		(struct tp_dispatch*)dispatch;
+	struct libinput *libinput = tp->device->base.seat->libinput;
 
-	free(tp->touches);
-	free(tp);
+	libinput_free(libinput, tp->touches);
+	libinput_free(libinput, tp);
 }
 
 static void
@@ -892,7 +933,8 @@ tp_trackpoint_event(uint64_t time, struct libinput_event *event, void *data)
 
 	/* Buttons do not count as trackpad activity, as people may use
 	   the trackpoint buttons in combination with the touchpad. */
-	if (event->type == LIBINPUT_EVENT_POINTER_BUTTON)
+	if (event->type == LIBINPUT_EVENT_POINTER_BUTTON ||
+	    event->type == LIBINPUT_EVENT_POINTER_FRAME)
 		return;
 
 	if (!tp->sendevents.trackpoint_active) {
@@ -920,7 +962,7 @@ tp_keyboard_event(uint64_t time, struct libinput_event *event, void *data)
 {
 	struct tp_dispatch *tp = data;
 	struct libinput_event_keyboard *kbdev;
-	unsigned int timeout;
+	uint64_t timeout;
 
 	if (event->type != LIBINPUT_EVENT_KEYBOARD_KEY)
 		return;
@@ -981,6 +1023,7 @@ tp_interface_device_added(struct evdev_device *device,
 		tp->buttons.active_is_topbutton = false;
 		tp->buttons.trackpoint = added_device;
 		libinput_device_add_event_listener(&added_device->base,
+					&tp->device->base,
 					&tp->sendevents.trackpoint_listener,
 					tp_trackpoint_event, tp);
 	}
@@ -991,6 +1034,7 @@ tp_interface_device_added(struct evdev_device *device,
 	if (tp_is_internal && kbd_is_internal &&
 	    tp->sendevents.keyboard == NULL) {
 		libinput_device_add_event_listener(&added_device->base,
+					&tp->device->base,
 					&tp->sendevents.keyboard_listener,
 					tp_keyboard_event, tp);
 		tp->sendevents.keyboard = added_device;
@@ -1062,8 +1106,8 @@ tp_interface_tag_device(struct evdev_device *device,
 	} else if (bustype != BUS_BLUETOOTH)
 		device->tags |= EVDEV_TAG_INTERNAL_TOUCHPAD;
 
-	if (udev_device_get_property_value(udev_device,
-					   "TOUCHPAD_HAS_TRACKPOINT_BUTTONS"))
+	if (evdev_device_get_property(device,
+				      "TOUCHPAD_HAS_TRACKPOINT_BUTTONS"))
 		device->tags |= EVDEV_TAG_TOUCHPAD_TRACKPOINT;
 }
 
@@ -1149,7 +1193,9 @@ tp_init_slots(struct tp_dispatch *tp,
 	}
 
 	tp->ntouches = max(tp->num_slots, n_btn_tool_touches);
-	tp->touches = calloc(tp->ntouches, sizeof(struct tp_touch));
+	tp->touches = libinput_calloc(device->base.seat->libinput,
+				      tp->ntouches,
+				      sizeof(struct tp_touch));
 	if (!tp->touches)
 		return -1;
 
@@ -1169,6 +1215,7 @@ static int
 tp_init_accel(struct tp_dispatch *tp, double diagonal)
 {
 	int res_x, res_y;
+	double x_scale_coeff, y_scale_coeff;
 	accel_profile_func_t profile;
 
 	res_x = tp->device->abs.absinfo_x->resolution;
@@ -1182,17 +1229,25 @@ tp_init_accel(struct tp_dispatch *tp, double diagonal)
 	 * touchpad does not turn into an elipse on the screen.
 	 */
 	if (res_x > 1 && res_y > 1) {
-		tp->accel.x_scale_coeff = (DEFAULT_MOUSE_DPI/25.4) / res_x;
-		tp->accel.y_scale_coeff = (DEFAULT_MOUSE_DPI/25.4) / res_y;
+		x_scale_coeff = (DEFAULT_MOUSE_DPI/25.4) / res_x;
+		y_scale_coeff = (DEFAULT_MOUSE_DPI/25.4) / res_y;
 	} else {
 	/*
 	 * For touchpads where the driver does not provide resolution, fall
 	 * back to scaling motion events based on the diagonal size in units.
 	 */
-		tp->accel.x_scale_coeff = DEFAULT_ACCEL_NUMERATOR / diagonal;
-		tp->accel.y_scale_coeff = DEFAULT_ACCEL_NUMERATOR / diagonal;
+		x_scale_coeff = DEFAULT_ACCEL_NUMERATOR / diagonal;
+		y_scale_coeff = DEFAULT_ACCEL_NUMERATOR / diagonal;
 	}
 
+#ifdef HAVE_FIXED_POINT
+	tp->accel.x_scale_coeff = fixed_from_double(x_scale_coeff);
+	tp->accel.y_scale_coeff = fixed_from_double(y_scale_coeff);
+#else
+	tp->accel.x_scale_coeff = x_scale_coeff;
+	tp->accel.y_scale_coeff = y_scale_coeff;
+#endif
+
 	switch (tp->device->model) {
 	case EVDEV_MODEL_LENOVO_X230:
 		profile = touchpad_lenovo_x230_accel_profile;
@@ -1526,10 +1581,11 @@ evdev_mt_touchpad_create(struct evdev_device *device)
 {
 	struct tp_dispatch *tp;
 
-	tp = zalloc(sizeof *tp);
+	tp = libinput_zalloc(device->base.seat->libinput, sizeof *tp);
 	if (!tp)
 		return NULL;
 
+	tp->device = device;
 	tp->model = tp_get_model(device);
 
 	if (tp_init(tp, device) != 0) {
@@ -135,7 +135,7 @@ struct tp_touch {
 	bool has_ended;				/* TRACKING_ID == -1 */
 	bool dirty;
 	struct device_coords point;
-	uint64_t millis;
+	uint64_t time;
 	int distance;				/* distance == 0 means touch */
 
 	struct {
@@ -179,7 +179,7 @@ struct tp_touch {
 	struct {
 		enum touch_palm_state state;
 		struct device_coords first; /* first coordinates if is_palm == true */
-		uint32_t time; /* first timestamp if is_palm == true */
+		uint64_t time; /* first timestamp if is_palm == true */
 	} palm;
 };
 
@@ -207,8 +207,13 @@ struct tp_dispatch {
 	struct device_coords hysteresis_margin;
 
 	struct {
+#ifdef HAVE_FIXED_POINT
+		fixed_t x_scale_coeff;
+		fixed_t y_scale_coeff;
+#else
 		double x_scale_coeff;
 		double y_scale_coeff;
+#endif
 	} accel;
 
 	struct {
@@ -298,8 +303,17 @@ tp_normalize_delta(struct tp_dispatch *tp, struct device_float_coords delta)
 {
 	struct normalized_coords normalized;
 
+#ifdef HAVE_FIXED_POINT
+	/* the callers pass device_delta() here, the conversion of an
+	 * integer is exact. Pointer motion uses tp_get_motion(). */
+	normalized.x = fixed_to_double(fixed_mul(fixed_from_double(delta.x),
+						 tp->accel.x_scale_coeff));
+	normalized.y = fixed_to_double(fixed_mul(fixed_from_double(delta.y),
+						 tp->accel.y_scale_coeff));
+#else
 	normalized.x = delta.x * tp->accel.x_scale_coeff;
 	normalized.y = delta.y * tp->accel.y_scale_coeff;
+#endif
 
 	return normalized;
 }
@@ -307,11 +321,19 @@ tp_normalize_delta(struct tp_dispatch *tp, struct device_float_coords delta)
 struct normalized_coords
 tp_get_delta(struct tp_touch *t);
 
+motion_coords_t
+tp_get_motion(struct tp_touch *t);
+
 struct normalized_coords
 tp_filter_motion(struct tp_dispatch *tp,
 		 const struct normalized_coords *unaccelerated,
 		 uint64_t time);
 
+motion_coords_t
+tp_filter_pointer_motion(struct tp_dispatch *tp,
+			 const motion_coords_t *unaccelerated,
+			 uint64_t time);
+
 int
 tp_touch_active(struct tp_dispatch *tp, struct tp_touch *t);
 
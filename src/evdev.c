@@ -25,6 +25,7 @@
 
 #include <errno.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "linux/input.h"
@@ -39,9 +40,11 @@
 #include "evdev.h"
 #include "filter.h"
 #include "libinput-private.h"
+#include "usdt.h"
+#include "worker-pool.h"
 
 #define DEFAULT_WHEEL_CLICK_ANGLE 15
-#define DEFAULT_MIDDLE_BUTTON_SCROLL_TIMEOUT 200
+#define DEFAULT_MIDDLE_BUTTON_SCROLL_TIMEOUT ms2us(200)
 
 enum evdev_key_type {
 	EVDEV_KEY_TYPE_NONE,
@@ -66,6 +69,12 @@ struct evdev_udev_tag_match {
 	enum evdev_device_udev_tags tag;
 };
 
+/* The dispatch of anything that is not a touchpad */
+struct fallback_dispatch {
+	struct evdev_dispatch base;
+	struct libinput *libinput;
+};
+
 static const struct evdev_udev_tag_match evdev_udev_tag_matches[] = {
 	{"ID_INPUT",			EVDEV_UDEV_TAG_INPUT},
 	{"ID_INPUT_KEYBOARD",		EVDEV_UDEV_TAG_KEYBOARD},
@@ -82,6 +91,16 @@ static const struct evdev_udev_tag_match evdev_udev_tag_matches[] = {
 	{ 0 },
 };
 
+static inline const char *
+evdev_device_get_devnode(struct evdev_device *device)
+{
+	/* Replay devices have no device node, use the sysname instead */
+	if (!device->udev_device)
+		return device->sysname;
+
+	return udev_device_get_devnode(device->udev_device);
+}
+
 static void
 hw_set_key_down(struct evdev_device *device, int code, int pressed)
 {
@@ -124,7 +143,7 @@ update_key_down_count(struct evdev_device *device, int code, int pressed)
 
 void
 evdev_keyboard_notify_key(struct evdev_device *device,
-			  uint32_t time,
+			  uint64_t time,
 			  int key,
 			  enum libinput_key_state state)
 {
@@ -139,7 +158,7 @@ evdev_keyboard_notify_key(struct evdev_device *device,
 
 void
 evdev_pointer_notify_physical_button(struct evdev_device *device,
-				     uint32_t time,
+				     uint64_t time,
 				     int button,
 				     enum libinput_button_state state)
 {
@@ -154,7 +173,7 @@ evdev_pointer_notify_physical_button(struct evdev_device *device,
 
 void
 evdev_pointer_notify_button(struct evdev_device *device,
-			    uint32_t time,
+			    uint64_t time,
 			    int button,
 			    enum libinput_button_state state)
 {
@@ -214,7 +233,13 @@ transform_absolute(struct evdev_device *device,
 	if (!device->abs.apply_calibration)
 		return;
 
+#ifdef HAVE_FIXED_POINT
+	matrix_fixed_mult_vec(&device->abs.calibration_fixed,
+			      &point->x,
+			      &point->y);
+#else
 	matrix_mult_vec(&device->abs.calibration, &point->x, &point->y);
+#endif
 }
 
 static inline double
@@ -243,10 +268,41 @@ evdev_device_transform_y(struct evdev_device *device,
 static inline void
 normalize_delta(struct evdev_device *device,
 		const struct device_coords *delta,
-		struct normalized_coords *normalized)
+		motion_coords_t *normalized)
 {
+#ifdef HAVE_FIXED_POINT
+	/* 1000 << 16 still fits into an int */
+	fixed_t scale = (DEFAULT_MOUSE_DPI << FIXED_SHIFT) / device->dpi;
+
+	normalized->x = delta->x * scale;
+	normalized->y = delta->y * scale;
+#else
 	normalized->x = delta->x * DEFAULT_MOUSE_DPI / (double)device->dpi;
 	normalized->y = delta->y * DEFAULT_MOUSE_DPI / (double)device->dpi;
+#endif
+}
+
+/* seat slots are shared between the devices of a seat */
+static int32_t
+evdev_seat_slot_claim(struct libinput_seat *seat)
+{
+	int32_t seat_slot;
+
+	libinput_workers_lock(seat->libinput);
+	seat_slot = ffs(~seat->slot_map) - 1;
+	if (seat_slot != -1)
+		seat->slot_map |= 1 << seat_slot;
+	libinput_workers_unlock(seat->libinput);
+
+	return seat_slot;
+}
+
+static void
+evdev_seat_slot_release(struct libinput_seat *seat, int32_t seat_slot)
+{
+	libinput_workers_lock(seat->libinput);
+	seat->slot_map &= ~(1 << seat_slot);
+	libinput_workers_unlock(seat->libinput);
 }
 
 static void
@@ -257,9 +313,12 @@ evdev_flush_pending_event(struct evdev_device *device, uint64_t time)
 	int seat_slot;
 	struct libinput_device *base = &device->base;
 	struct libinput_seat *seat = base->seat;
-	struct normalized_coords accel, unaccel;
+	motion_coords_t accel, unaccel;
+	struct normalized_coords scroll;
 	struct device_coords point;
 
+	usdt_probe(flush_pending, device->sysname, device->pending_event, time);
+
 	slot = device->mt.slot;
 
 	switch (device->pending_event) {
@@ -273,20 +332,22 @@ evdev_flush_pending_event(struct evdev_device *device, uint64_t time)
 		/* Use unaccelerated deltas for pointing stick scroll */
 		if (device->scroll.method == LIBINPUT_CONFIG_SCROLL_ON_BUTTON_DOWN &&
 		    hw_is_key_down(device, device->scroll.button)) {
-			if (device->scroll.button_scroll_active)
+			if (device->scroll.button_scroll_active) {
+				scroll = motion_to_normalized(unaccel);
 				evdev_post_scroll(device, time,
 						  LIBINPUT_POINTER_AXIS_SOURCE_CONTINUOUS,
-						  &unaccel);
+						  &scroll);
+			}
 			break;
 		}
 
 		/* Apply pointer acceleration. */
-		accel = filter_dispatch(device->pointer.filter,
-					&unaccel,
-					device,
-					time);
+		accel = filter_dispatch_motion(device->pointer.filter,
+					       &unaccel,
+					       device,
+					       time);
 
-		if (normalized_is_zero(accel) && normalized_is_zero(unaccel))
+		if (motion_is_zero(accel) && motion_is_zero(unaccel))
 			break;
 
 		pointer_notify_motion(base, time, &accel, &unaccel);
@@ -299,17 +360,16 @@ evdev_flush_pending_event(struct evdev_device *device, uint64_t time)
 			log_bug_kernel(libinput,
 				       "%s: Driver sent multiple touch down for the "
 				       "same slot",
-				       udev_device_get_devnode(device->udev_device));
+				       evdev_device_get_devnode(device));
 			break;
 		}
 
-		seat_slot = ffs(~seat->slot_map) - 1;
+		seat_slot = evdev_seat_slot_claim(seat);
 		device->mt.slots[slot].seat_slot = seat_slot;
 
 		if (seat_slot == -1)
 			break;
 
-		seat->slot_map |= 1 << seat_slot;
 		point = device->mt.slots[slot].point;
 		transform_absolute(device, &point);
 
@@ -340,7 +400,7 @@ evdev_flush_pending_event(struct evdev_device *device, uint64_t time)
 		if (seat_slot == -1)
 			break;
 
-		seat->slot_map &= ~(1 << seat_slot);
+		evdev_seat_slot_release(seat, seat_slot);
 
 		touch_notify_touch_up(base, time, slot, seat_slot);
 		break;
@@ -352,18 +412,16 @@ evdev_flush_pending_event(struct evdev_device *device, uint64_t time)
 			log_bug_kernel(libinput,
 				       "%s: Driver sent multiple touch down for the "
 				       "same slot",
-				       udev_device_get_devnode(device->udev_device));
+				       evdev_device_get_devnode(device));
 			break;
 		}
 
-		seat_slot = ffs(~seat->slot_map) - 1;
+		seat_slot = evdev_seat_slot_claim(seat);
 		device->abs.seat_slot = seat_slot;
 
 		if (seat_slot == -1)
 			break;
 
-		seat->slot_map |= 1 << seat_slot;
-
 		point = device->abs.point;
 		transform_absolute(device, &point);
 
@@ -395,7 +453,7 @@ evdev_flush_pending_event(struct evdev_device *device, uint64_t time)
 		if (seat_slot == -1)
 			break;
 
-		seat->slot_map &= ~(1 << seat_slot);
+		evdev_seat_slot_release(seat, seat_slot);
 
 		touch_notify_touch_up(base, time, -1, seat_slot);
 		break;
@@ -822,7 +880,10 @@ fallback_suspend(struct evdev_dispatch *dispatch,
 static void
 fallback_destroy(struct evdev_dispatch *dispatch)
 {
-	free(dispatch);
+	struct fallback_dispatch *fallback =
+		container_of(dispatch, fallback, base);
+
+	libinput_free(fallback->libinput, fallback);
 }
 
 static void
@@ -1192,25 +1253,30 @@ evdev_init_natural_scroll(struct evdev_device *device)
 static struct evdev_dispatch *
 fallback_dispatch_create(struct libinput_device *device)
 {
-	struct evdev_dispatch *dispatch = zalloc(sizeof *dispatch);
+	struct libinput *libinput = device->seat->libinput;
+	struct fallback_dispatch *fallback;
+	struct evdev_dispatch *dispatch;
 	struct evdev_device *evdev_device = (struct evdev_device *)device;
 
-	if (dispatch == NULL)
+	fallback = libinput_zalloc(libinput, sizeof *fallback);
+	if (fallback == NULL)
 		return NULL;
 
+	fallback->libinput = libinput;
+	dispatch = &fallback->base;
 	dispatch->interface = &fallback_interface;
 
 	if (evdev_device->left_handed.want_enabled &&
 	    evdev_init_left_handed(evdev_device,
 				   evdev_change_to_left_handed) == -1) {
-		free(dispatch);
+		libinput_free(libinput, fallback);
 		return NULL;
 	}
 
 	if (evdev_device->scroll.want_button &&
 	    evdev_init_button_scroll(evdev_device,
 				     evdev_change_scroll_method) == -1) {
-		free(dispatch);
+		libinput_free(libinput, fallback);
 		return NULL;
 	}
 
@@ -1245,7 +1311,7 @@ static inline void
 evdev_process_event(struct evdev_device *device, struct input_event *e)
 {
 	struct evdev_dispatch *dispatch = device->dispatch;
-	uint64_t time = e->time.tv_sec * 1000ULL + e->time.tv_usec / 1000;
+	uint64_t time = e->time.tv_sec * 1000000ULL + e->time.tv_usec;
 
 #if 0
 	if (libevdev_event_is_code(e, EV_SYN, SYN_REPORT))
@@ -1261,6 +1327,9 @@ evdev_process_event(struct evdev_device *device, struct input_event *e)
 #endif
 
 	dispatch->interface->process(dispatch, device, e, time);
+
+	if (libevdev_event_is_code(e, EV_SYN, SYN_REPORT))
+		pointer_notify_frame(&device->base);
 }
 
 static inline void
@@ -1282,7 +1351,7 @@ evdev_device_dispatch_one(struct evdev_device *device,
 }
 
 static int
-evdev_sync_device(struct evdev_device *device)
+evdev_sync_device(struct evdev_device *device, uint64_t *nevents)
 {
 	struct input_event ev;
 	int rc;
@@ -1292,20 +1361,47 @@ evdev_sync_device(struct evdev_device *device)
 					 LIBEVDEV_READ_FLAG_SYNC, &ev);
 		if (rc < 0)
 			break;
+		(*nevents)++;
 		evdev_device_dispatch_one(device, &ev);
 	} while (rc == LIBEVDEV_READ_STATUS_SYNC);
 
 	return rc == -EAGAIN ? 0 : rc;
 }
 
-static void
-evdev_device_dispatch(void *data)
+void
+evdev_device_update_stats(struct evdev_device *device,
+			  uint64_t nevents,
+			  uint64_t syn_dropped,
+			  uint64_t start)
+{
+	struct libinput *libinput = device->base.seat->libinput;
+	struct libinput_stats *stats = &device->base.stats;
+
+	libinput_stats_add(&stats->evdev_events, nevents);
+	libinput_stats_add(&libinput->stats.evdev_events, nevents);
+
+	if (syn_dropped) {
+		libinput_stats_add(&stats->syn_dropped, syn_dropped);
+		libinput_stats_add(&libinput->stats.syn_dropped, syn_dropped);
+	}
+
+	libinput_stats_add(&stats->processing_time_usec,
+			   libinput_monotonic_now(libinput) - start);
+}
+
+static bool
+evdev_device_dispatch(void *data, unsigned int budget)
 {
 	struct evdev_device *device = data;
 	struct libinput *libinput = device->base.seat->libinput;
 	struct input_event ev;
+	unsigned int frames = 0;
+	uint64_t start = libinput_monotonic_now(libinput);
+	uint64_t nevents = 0, syn_dropped = 0;
 	int rc;
 
+	usdt_probe(dispatch_entry, device->sysname, budget);
+
 	/* If the compositor is repainting, this function is called only once
 	 * per frame and we have to process all the events available on the
 	 * fd, otherwise there will be input lag. */
@@ -1313,6 +1409,7 @@ evdev_device_dispatch(void *data)
 		rc = libevdev_next_event(device->evdev,
 					 LIBEVDEV_READ_FLAG_NORMAL, &ev);
 		if (rc == LIBEVDEV_READ_STATUS_SYNC) {
+			syn_dropped++;
 			switch (ratelimit_test(&device->syn_drop_limit)) {
 			case RATELIMIT_PASS:
 				log_info(libinput, "SYN_DROPPED event from "
@@ -1334,18 +1431,81 @@ evdev_device_dispatch(void *data)
 			ev.code = SYN_REPORT;
 			evdev_device_dispatch_one(device, &ev);
 
-			rc = evdev_sync_device(device);
+			rc = evdev_sync_device(device, &nevents);
 			if (rc == 0)
 				rc = LIBEVDEV_READ_STATUS_SUCCESS;
 		} else if (rc == LIBEVDEV_READ_STATUS_SUCCESS) {
+			nevents++;
 			evdev_device_dispatch_one(device, &ev);
+
+			/* Yield on frame boundaries only, the remaining
+			 * events are picked up in the next round */
+			if (budget &&
+			    libevdev_event_is_code(&ev, EV_SYN, SYN_REPORT) &&
+			    ++frames == budget) {
+				evdev_device_update_stats(device, nevents,
+							  syn_dropped, start);
+				usdt_probe(dispatch_exit, device->sysname,
+					   nevents, 1);
+				return true;
+			}
 		}
 	} while (rc == LIBEVDEV_READ_STATUS_SUCCESS);
 
+	evdev_device_update_stats(device, nevents, syn_dropped, start);
+	usdt_probe(dispatch_exit, device->sysname, nevents, 0);
+
 	if (rc != -EAGAIN && rc != -EINTR) {
 		libinput_remove_source(libinput, device->source);
 		device->source = NULL;
 	}
+
+	return false;
+}
+
+static struct libinput_source *
+evdev_device_add_source(struct evdev_device *device, int fd)
+{
+	struct libinput *libinput = device->base.seat->libinput;
+	struct libinput_source *source;
+
+	source = libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
+	if (!source)
+		return NULL;
+
+	libinput_source_set_device(source, &device->base);
+
+	/* Keyboards are drained before pointer and touch devices in
+	 * libinput_dispatch(), so key latency stays bounded when another
+	 * device floods. Combined devices are treated like any other. */
+	if (device->seat_caps == EVDEV_DEVICE_KEYBOARD)
+		libinput_source_set_priority(source, true);
+
+	/* Don't even read devices whose events are all masked */
+	libinput_source_set_enabled(libinput, source,
+				    libinput_device_wants_input(&device->base));
+
+	return source;
+}
+
+void
+evdev_device_update_polling(struct evdev_device *device)
+{
+	if (!device->source)
+		return;
+
+	libinput_source_set_enabled(device->base.seat->libinput,
+				    device->source,
+				    libinput_device_wants_input(&device->base));
+}
+
+void
+evdev_device_read_unpolled(struct evdev_device *device)
+{
+	/* Whatever queued up in the kernel while the device was not
+	 * polled is processed under the event mask it arrived under */
+	if (device->source && !libinput_source_get_enabled(device->source))
+		evdev_device_dispatch(device, 0);
 }
 
 static int
@@ -1385,7 +1545,9 @@ int
 evdev_device_init_pointer_acceleration(struct evdev_device *device,
 				       accel_profile_func_t profile)
 {
-	device->pointer.filter = create_pointer_accelerator_filter(profile);
+	device->pointer.filter = create_pointer_accelerator_filter(
+					profile,
+					&device->base.seat->libinput->mem);
 	if (!device->pointer.filter)
 		return -1;
 
@@ -1426,8 +1588,7 @@ evdev_read_wheel_click_prop(struct evdev_device *device)
 	const char *prop;
 	int angle = DEFAULT_WHEEL_CLICK_ANGLE;
 
-	prop = udev_device_get_property_value(device->udev_device,
-					      "MOUSE_WHEEL_CLICK_ANGLE");
+	prop = evdev_device_get_property(device, "MOUSE_WHEEL_CLICK_ANGLE");
 	if (prop) {
 		angle = parse_mouse_wheel_click_angle_property(prop);
 		if (!angle) {
@@ -1450,8 +1611,8 @@ evdev_get_trackpoint_dpi(struct evdev_device *device)
 	const char *trackpoint_accel;
 	double accel = DEFAULT_TRACKPOINT_ACCEL;
 
-	trackpoint_accel = udev_device_get_property_value(
-				device->udev_device, "POINTINGSTICK_CONST_ACCEL");
+	trackpoint_accel = evdev_device_get_property(device,
+						     "POINTINGSTICK_CONST_ACCEL");
 	if (trackpoint_accel) {
 		accel = parse_trackpoint_accel_property(trackpoint_accel);
 		if (accel == 0.0) {
@@ -1482,8 +1643,7 @@ evdev_read_dpi_prop(struct evdev_device *device)
 	if (libevdev_has_property(device->evdev, INPUT_PROP_POINTING_STICK))
 		return evdev_get_trackpoint_dpi(device);
 
-	mouse_dpi = udev_device_get_property_value(device->udev_device,
-						   "MOUSE_DPI");
+	mouse_dpi = evdev_device_get_property(device, "MOUSE_DPI");
 	if (mouse_dpi) {
 		dpi = parse_mouse_dpi_property(mouse_dpi);
 		if (!dpi) {
@@ -1517,8 +1677,7 @@ evdev_read_model(struct evdev_device *device)
 	const struct model_map *m = model_map;
 
 	while (m->property) {
-		if (!!udev_device_get_property_value(device->udev_device,
-						     m->property))
+		if (!!evdev_device_get_property(device, m->property))
 			break;
 		m++;
 	}
@@ -1590,6 +1749,15 @@ evdev_device_get_udev_tags(struct evdev_device *device,
 	const struct evdev_udev_tag_match *match;
 	int i;
 
+	/* replay devices only have their own properties, no parents */
+	if (!udev_device) {
+		for (match = evdev_udev_tag_matches; match->name; match++) {
+			if (evdev_device_get_property(device, match->name))
+				tags |= match->tag;
+		}
+		return tags;
+	}
+
 	for (i = 0; i < 2 && udev_device; i++) {
 		match = evdev_udev_tag_matches;
 		while (match->name) {
@@ -1775,7 +1943,9 @@ evdev_configure_mt_device(struct evdev_device *device)
 		active_slot = libevdev_get_current_slot(evdev);
 	}
 
-	slots = calloc(num_slots, sizeof(struct mt_slot));
+	slots = libinput_calloc(device->base.seat->libinput,
+				num_slots,
+				sizeof(struct mt_slot));
 	if (!slots)
 		return -1;
 
@@ -1804,7 +1974,7 @@ evdev_configure_device(struct evdev_device *device)
 {
 	struct libinput *libinput = device->base.seat->libinput;
 	struct libevdev *evdev = device->evdev;
-	const char *devnode = udev_device_get_devnode(device->udev_device);
+	const char *devnode = evdev_device_get_devnode(device);
 	enum evdev_device_udev_tags udev_tags;
 
 	udev_tags = evdev_device_get_udev_tags(device, device->udev_device);
@@ -1979,14 +2149,13 @@ out:
 }
 
 static int
-evdev_set_device_group(struct evdev_device *device,
-		       struct udev_device *udev_device)
+evdev_set_device_group(struct evdev_device *device)
 {
 	struct libinput_device_group *group = NULL;
 	const char *udev_group;
 
-	udev_group = udev_device_get_property_value(udev_device,
-						    "LIBINPUT_DEVICE_GROUP");
+	udev_group = evdev_device_get_property(device,
+					       "LIBINPUT_DEVICE_GROUP");
 	if (udev_group) {
 		struct libinput_device *d;
 
@@ -2002,7 +2171,8 @@ evdev_set_device_group(struct evdev_device *device,
 	}
 
 	if (!group) {
-		group = libinput_device_group_create(udev_group);
+		group = libinput_device_group_create(device->base.seat->libinput,
+						     udev_group);
 		if (!group)
 			return 1;
 		libinput_device_set_device_group(&device->base, group);
@@ -2014,6 +2184,63 @@ evdev_set_device_group(struct evdev_device *device,
 	return 0;
 }
 
+/* Everything common to the udev and the replay devices, udev_device or
+ * replay.properties, sysname and fd are set up by the caller.
+ * Returns 0 on success, 1 if the device isn't handled by libinput or -1
+ * on error */
+static int
+evdev_device_setup(struct evdev_device *device)
+{
+	device->seat_caps = 0;
+	device->is_mt = 0;
+	device->mtdev = NULL;
+	device->rel.x = 0;
+	device->rel.y = 0;
+	device->abs.seat_slot = -1;
+	device->dispatch = NULL;
+	device->pending_event = EVDEV_NONE;
+	device->devname = libevdev_get_name(device->evdev);
+	device->scroll.threshold = 5.0; /* Default may be overridden */
+	device->scroll.direction = 0;
+	device->scroll.wheel_click_angle =
+		evdev_read_wheel_click_prop(device);
+	device->dpi = evdev_read_dpi_prop(device);
+	device->model = evdev_read_model(device);
+	/* at most 5 SYN_DROPPED log-messages per 30s */
+	ratelimit_init(&device->syn_drop_limit, 30ULL * 1000, 5);
+
+	matrix_init_identity(&device->abs.calibration);
+	matrix_init_identity(&device->abs.usermatrix);
+	matrix_init_identity(&device->abs.default_calibration);
+
+	if (evdev_configure_device(device) == -1)
+		return -1;
+
+	if (device->seat_caps == 0)
+		return 1;
+
+	/* If the dispatch was not set up use the fallback. */
+	if (device->dispatch == NULL)
+		device->dispatch = fallback_dispatch_create(&device->base);
+	if (device->dispatch == NULL)
+		return -1;
+
+	if (evdev_set_device_group(device))
+		return -1;
+
+	return 0;
+}
+
+static void
+evdev_device_add(struct evdev_device *device)
+{
+	list_insert(device->base.seat->devices_list.prev, &device->base.link);
+	libinput_workers_invalidate_groups(device->base.seat->libinput);
+
+	evdev_tag_device(device);
+	evdev_notify_added_device(device);
+}
+
 struct evdev_device *
 evdev_device_create(struct libinput_seat *seat,
 		    struct udev_device *udev_device)
@@ -2040,7 +2267,7 @@ evdev_device_create(struct libinput_seat *seat,
 	if (!evdev_device_have_same_syspath(udev_device, fd))
 		goto err;
 
-	device = zalloc(sizeof *device);
+	device = libinput_zalloc(libinput, sizeof *device);
 	if (device == NULL)
 		goto err;
 
@@ -2053,56 +2280,22 @@ evdev_device_create(struct libinput_seat *seat,
 
 	libevdev_set_clock_id(device->evdev, CLOCK_MONOTONIC);
 
-	device->seat_caps = 0;
-	device->is_mt = 0;
-	device->mtdev = NULL;
 	device->udev_device = udev_device_ref(udev_device);
-	device->rel.x = 0;
-	device->rel.y = 0;
-	device->abs.seat_slot = -1;
-	device->dispatch = NULL;
 	device->fd = fd;
-	device->pending_event = EVDEV_NONE;
-	device->devname = libevdev_get_name(device->evdev);
-	device->scroll.threshold = 5.0; /* Default may be overridden */
-	device->scroll.direction = 0;
-	device->scroll.wheel_click_angle =
-		evdev_read_wheel_click_prop(device);
-	device->dpi = evdev_read_dpi_prop(device);
-	device->model = evdev_read_model(device);
-	/* at most 5 SYN_DROPPED log-messages per 30s */
-	ratelimit_init(&device->syn_drop_limit, 30ULL * 1000, 5);
+	device->sysname = udev_device_get_sysname(udev_device);
 
-	matrix_init_identity(&device->abs.calibration);
-	matrix_init_identity(&device->abs.usermatrix);
-	matrix_init_identity(&device->abs.default_calibration);
-
-	if (evdev_configure_device(device) == -1)
-		goto err;
-
-	if (device->seat_caps == 0) {
-		unhandled_device = 1;
+	rc = evdev_device_setup(device);
+	if (rc != 0) {
+		unhandled_device = rc == 1;
 		goto err;
 	}
 
-	/* If the dispatch was not set up use the fallback. */
-	if (device->dispatch == NULL)
-		device->dispatch = fallback_dispatch_create(&device->base);
-	if (device->dispatch == NULL)
-		goto err;
-
 	device->source =
-		libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
+		evdev_device_add_source(device, fd);
 	if (!device->source)
 		goto err;
 
-	if (evdev_set_device_group(device, udev_device))
-		goto err;
-
-	list_insert(seat->devices_list.prev, &device->base.link);
-
-	evdev_tag_device(device);
-	evdev_notify_added_device(device);
+	evdev_device_add(device);
 
 	return device;
 
@@ -2115,6 +2308,112 @@ err:
 	return unhandled_device ? EVDEV_UNHANDLED_DEVICE :  NULL;
 }
 
+static void
+evdev_free_properties(struct libinput *libinput, char **properties)
+{
+	char **prop;
+
+	if (!properties)
+		return;
+
+	for (prop = properties; *prop; prop++)
+		libinput_free(libinput, *prop);
+	libinput_free(libinput, properties);
+}
+
+static char **
+evdev_copy_properties(struct libinput *libinput,
+		      const char *const *properties)
+{
+	char **copy;
+	size_t i, n = 0, count = 0;
+
+	while (properties && properties[count])
+		count++;
+
+	copy = libinput_calloc(libinput, count + 1, sizeof *copy);
+	if (!copy)
+		return NULL;
+
+	for (i = 0; i < count; i++) {
+		if (!strchr(properties[i], '=')) {
+			log_bug_client(libinput,
+				       "udev property '%s' is not KEY=value\n",
+				       properties[i]);
+			continue;
+		}
+
+		copy[n] = libinput_strdup(libinput, properties[i]);
+		if (!copy[n]) {
+			evdev_free_properties(libinput, copy);
+			return NULL;
+		}
+		n++;
+	}
+
+	return copy;
+}
+
+struct evdev_device *
+evdev_device_create_replay(struct libinput_seat *seat,
+			   struct libevdev *evdev,
+			   const char *sysname,
+			   const char *const *properties)
+{
+	struct libinput *libinput = seat->libinput;
+	struct evdev_device *device;
+	int rc;
+
+	device = libinput_zalloc(libinput, sizeof *device);
+	if (device == NULL)
+		return NULL;
+
+	libinput_device_init(&device->base, seat);
+	libinput_seat_ref(seat);
+
+	device->evdev = evdev;
+	device->fd = -1;
+	device->replay.enabled = true;
+	snprintf(device->replay.sysname, sizeof(device->replay.sysname),
+		 "%s", sysname);
+	device->sysname = device->replay.sysname;
+	device->replay.properties = evdev_copy_properties(libinput,
+							  properties);
+	if (!device->replay.properties)
+		goto err;
+
+	/* mtdev converts from the fd, we have none */
+	if (evdev_need_mtdev(device)) {
+		log_info(libinput,
+			 "input device '%s', %s needs mtdev, not supported "
+			 "for replay\n",
+			 libevdev_get_name(evdev), device->sysname);
+		goto err;
+	}
+
+	rc = evdev_device_setup(device);
+	if (rc != 0)
+		goto err;
+
+	evdev_device_add(device);
+
+	return device;
+
+err:
+	/* the caller keeps the libevdev on failure */
+	device->evdev = NULL;
+	evdev_device_destroy(device);
+
+	return NULL;
+}
+
+void
+evdev_device_replay_event(struct evdev_device *device,
+			  struct input_event *ev)
+{
+	evdev_device_dispatch_one(device, ev);
+}
+
 const char *
 evdev_device_get_output(struct evdev_device *device)
 {
@@ -2124,7 +2423,28 @@ evdev_device_get_output(struct evdev_device *device)
 const char *
 evdev_device_get_sysname(struct evdev_device *device)
 {
-	return udev_device_get_sysname(device->udev_device);
+	return device->sysname;
+}
+
+const char *
+evdev_device_get_property(struct evdev_device *device, const char *key)
+{
+	size_t len = strlen(key);
+	char **prop;
+
+	if (device->udev_device)
+		return udev_device_get_property_value(device->udev_device,
+						      key);
+
+	if (!device->replay.properties)
+		return NULL;
+
+	for (prop = device->replay.properties; *prop; prop++) {
+		if (strneq(*prop, key, len) && (*prop)[len] == '=')
+			return *prop + len + 1;
+	}
+
+	return NULL;
 }
 
 const char *
@@ -2221,6 +2541,10 @@ evdev_device_calibrate(struct evdev_device *device,
 
 	/* store final matrix in device */
 	matrix_mult(&device->abs.calibration, &transform, &scale);
+#ifdef HAVE_FIXED_POINT
+	matrix_to_fixed(&device->abs.calibration,
+			&device->abs.calibration_fixed);
+#endif
 }
 
 int
@@ -2435,6 +2759,7 @@ evdev_device_suspend(struct evdev_device *device)
 	if (device->dispatch->interface->suspend)
 		device->dispatch->interface->suspend(device->dispatch,
 						     device);
+	libinput_flush_pointer_frames(device->base.seat->libinput);
 
 	if (device->source) {
 		libinput_remove_source(device->base.seat->libinput,
@@ -2470,6 +2795,16 @@ evdev_device_resume(struct evdev_device *device)
 	if (device->was_removed)
 		return -ENODEV;
 
+	/* Nothing to reopen, only the state is reset */
+	if (device->replay.enabled) {
+		if (!device->suspended)
+			return 0;
+
+		memset(device->hw_key_mask, 0, sizeof(device->hw_key_mask));
+		evdev_notify_resumed_device(device);
+		return 0;
+	}
+
 	devnode = udev_device_get_devnode(device->udev_device);
 	fd = open_restricted(libinput, devnode,
 			     O_RDWR | O_NONBLOCK | O_CLOEXEC);
@@ -2505,7 +2840,7 @@ evdev_device_resume(struct evdev_device *device)
 	} while (status == LIBEVDEV_READ_STATUS_SYNC);
 
 	device->source =
-		libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
+		evdev_device_add_source(device, fd);
 	if (!device->source) {
 		mtdev_close_delete(device->mtdev);
 		return -ENOMEM;
@@ -2542,6 +2877,7 @@ evdev_device_remove(struct evdev_device *device)
 	device->was_removed = true;
 
 	list_remove(&device->base.link);
+	libinput_workers_invalidate_groups(device->base.seat->libinput);
 
 	notify_removed_device(&device->base);
 	libinput_device_unref(&device->base);
@@ -2550,6 +2886,7 @@ evdev_device_remove(struct evdev_device *device)
 void
 evdev_device_destroy(struct evdev_device *device)
 {
+	struct libinput *libinput = device->base.seat->libinput;
 	struct evdev_dispatch *dispatch;
 
 	dispatch = device->dispatch;
@@ -2563,6 +2900,8 @@ evdev_device_destroy(struct evdev_device *device)
 	libinput_seat_unref(device->base.seat);
 	libevdev_free(device->evdev);
 	udev_device_unref(device->udev_device);
-	free(device->mt.slots);
-	free(device);
+	evdev_free_properties(libinput, device->replay.properties);
+	libinput_free(libinput, device->output_name);
+	libinput_free(libinput, device->mt.slots);
+	libinput_free(libinput, device);
 }
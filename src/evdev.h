@@ -33,6 +33,7 @@
 #include "libinput-private.h"
 #include "timer.h"
 #include "filter.h"
+#include "state-trace.h"
 
 /* The HW DPI rate we normalize to before calculating pointer acceleration */
 #define DEFAULT_MOUSE_DPI 1000
@@ -118,8 +119,17 @@ struct evdev_device {
 	struct udev_device *udev_device;
 	char *output_name;
 	const char *devname;
+	const char *sysname; /* owned by udev_device or replay */
 	bool was_removed;
 	int fd;
+
+	/* devices of the replay backend have neither an fd nor a
+	 * udev_device, see replay.c */
+	struct {
+		bool enabled;
+		char sysname[32];
+		char **properties; /* NULL-terminated KEY=value */
+	} replay;
 	struct {
 		const struct input_absinfo *absinfo_x, *absinfo_y;
 		int fake_resolution;
@@ -131,6 +141,9 @@ struct evdev_device {
 		struct matrix calibration;
 		struct matrix default_calibration; /* from LIBINPUT_CALIBRATION_MATRIX */
 		struct matrix usermatrix; /* as supplied by the caller */
+#ifdef HAVE_FIXED_POINT
+		struct matrix_fixed calibration_fixed;
+#endif
 	} abs;
 
 	struct {
@@ -214,6 +227,9 @@ struct evdev_device {
 	struct ratelimit syn_drop_limit; /* ratelimit for SYN_DROPPED logging */
 
 	enum evdev_device_model model;
+
+	/* recent tap, softbutton and middlebutton transitions */
+	struct state_trace state_trace;
 };
 
 #define EVDEV_UNHANDLED_DEVICE ((struct evdev_device *) 1)
@@ -272,6 +288,23 @@ struct evdev_device *
 evdev_device_create(struct libinput_seat *seat,
 		    struct udev_device *device);
 
+/* Takes ownership of evdev on success only */
+struct evdev_device *
+evdev_device_create_replay(struct libinput_seat *seat,
+			   struct libevdev *evdev,
+			   const char *sysname,
+			   const char *const *properties);
+
+void
+evdev_device_replay_event(struct evdev_device *device,
+			  struct input_event *ev);
+
+void
+evdev_device_update_stats(struct evdev_device *device,
+			  uint64_t nevents,
+			  uint64_t syn_dropped,
+			  uint64_t start);
+
 int
 evdev_fix_abs_resolution(struct evdev_device *device,
 			 unsigned int xcode,
@@ -301,6 +334,10 @@ evdev_device_get_output(struct evdev_device *device);
 const char *
 evdev_device_get_sysname(struct evdev_device *device);
 
+/* The udev property value of key, or NULL if unset */
+const char *
+evdev_device_get_property(struct evdev_device *device, const char *key);
+
 const char *
 evdev_device_get_name(struct evdev_device *device);
 
@@ -347,6 +384,12 @@ evdev_device_transform_y(struct evdev_device *device,
 int
 evdev_device_suspend(struct evdev_device *device);
 
+void
+evdev_device_update_polling(struct evdev_device *device);
+
+void
+evdev_device_read_unpolled(struct evdev_device *device);
+
 int
 evdev_device_resume(struct evdev_device *device);
 
@@ -358,18 +401,18 @@ evdev_notify_resumed_device(struct evdev_device *device);
 
 void
 evdev_keyboard_notify_key(struct evdev_device *device,
-			  uint32_t time,
+			  uint64_t time,
 			  int key,
 			  enum libinput_key_state state);
 
 void
 evdev_pointer_notify_button(struct evdev_device *device,
-			    uint32_t time,
+			    uint64_t time,
 			    int button,
 			    enum libinput_button_state state);
 void
 evdev_pointer_notify_physical_button(struct evdev_device *device,
-				     uint32_t time,
+				     uint64_t time,
 				     int button,
 				     enum libinput_button_state state);
 
@@ -35,11 +35,24 @@ struct motion_filter_interface {
 	void (*destroy)(struct motion_filter *filter);
 	bool (*set_speed)(struct motion_filter *filter,
 			  double speed);
+	/* optional, filter_dispatch_batch() falls back to filter */
+	void (*filter_batch)(struct motion_filter *filter,
+			     const struct normalized_coords *unaccelerated,
+			     struct normalized_coords *accelerated,
+			     const uint64_t *times,
+			     size_t n,
+			     void *data);
+	/* optional, filter_dispatch_motion() falls back to filter */
+	motion_coords_t (*filter_motion)(
+			   struct motion_filter *filter,
+			   const motion_coords_t *unaccelerated,
+			   void *data, uint64_t time);
 };
 
 struct motion_filter {
 	double speed; /* normalized [-1, 1] */
 	struct motion_filter_interface *interface;
+	struct mem_allocator *mem; /* may be NULL */
 };
 
 #endif
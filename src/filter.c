@@ -42,6 +42,54 @@ filter_dispatch(struct motion_filter *filter,
 	return filter->interface->filter(filter, unaccelerated, data, time);
 }
 
+motion_coords_t
+filter_dispatch_motion(struct motion_filter *filter,
+		       const motion_coords_t *unaccelerated,
+		       void *data, uint64_t time)
+{
+	struct normalized_coords delta;
+
+	if (filter->interface->filter_motion)
+		return filter->interface->filter_motion(filter,
+							unaccelerated,
+							data,
+							time);
+
+	delta = motion_to_normalized(*unaccelerated);
+
+	return motion_from_normalized(filter_dispatch(filter,
+						      &delta,
+						      data,
+						      time));
+}
+
+void
+filter_dispatch_batch(struct motion_filter *filter,
+		      const struct normalized_coords *unaccelerated,
+		      struct normalized_coords *accelerated,
+		      const uint64_t *times,
+		      size_t n,
+		      void *data)
+{
+	size_t i;
+
+	if (filter->interface->filter_batch) {
+		filter->interface->filter_batch(filter,
+						unaccelerated,
+						accelerated,
+						times,
+						n,
+						data);
+		return;
+	}
+
+	for (i = 0; i < n; i++)
+		accelerated[i] = filter_dispatch(filter,
+						 &unaccelerated[i],
+						 data,
+						 times[i]);
+}
+
 void
 filter_destroy(struct motion_filter *filter)
 {
@@ -77,13 +125,41 @@ filter_get_speed(struct motion_filter *filter)
  */
 
 #define MAX_VELOCITY_DIFF	1.0 /* units/ms */
-#define MOTION_TIMEOUT		300 /* (ms) */
-#define NUM_POINTER_TRACKERS	16
-
-struct pointer_tracker {
-	struct normalized_coords delta; /* delta to most recent event */
-	uint64_t time;  /* ms */
-	int dir;
+#define MOTION_TIMEOUT		ms2us(300)
+#define NUM_POINTER_TRACKERS	16 /* must be a power of two */
+#define CACHE_LINE_SIZE		64
+
+/* The profile is sampled into a table of ACCEL_TABLE_SIZE intervals up
+ * to ACCEL_TABLE_MAX_VELOCITY, anything faster calls the profile */
+#define ACCEL_TABLE_SIZE	1024
+#define ACCEL_TABLE_MAX_VELOCITY 8 /* units/ms */
+
+/* With --enable-fixed-point the accelerator keeps its deltas,
+ * velocities and factors in fixed point, see motion_coords_t */
+#ifdef HAVE_FIXED_POINT
+typedef fixed_t accel_t;
+#define ACCEL_CONST(v_) ((fixed_t)((v_) * FIXED_ONE))
+#define accel_from_double(v_) fixed_from_double(v_)
+#define accel_to_double(v_) fixed_to_double(v_)
+#define accel_mul(a_, b_) fixed_mul(a_, b_)
+#else
+typedef double accel_t;
+#define ACCEL_CONST(v_) (v_)
+#define accel_from_double(v_) (v_)
+#define accel_to_double(v_) (v_)
+#define accel_mul(a_, b_) ((a_) * (b_))
+#endif
+
+/* The trackers are kept as arrays rather than an array of structs. Every
+ * event adds its delta to all trackers, with the deltas in an array of
+ * their own that's a straight add over NUM_POINTER_TRACKERS entries.
+ * The deltas are accumulated per tracker rather than derived from a
+ * running sum: the difference of two sums rounds differently than the
+ * per-tracker sum for most scales and we'd change the velocities. */
+struct pointer_trackers {
+	motion_coords_t delta[NUM_POINTER_TRACKERS]; /* to most recent event */
+	uint64_t time[NUM_POINTER_TRACKERS];  /* us */
+	int dir[NUM_POINTER_TRACKERS];
 };
 
 struct pointer_accelerator;
@@ -93,91 +169,113 @@ struct pointer_accelerator {
 	accel_profile_func_t profile;
 
 	double velocity;	/* units/ms */
-	double last_velocity;	/* units/ms */
-	struct normalized_coords last;
+	accel_t last_velocity;	/* units/ms */
+	motion_coords_t last;
 
-	struct pointer_tracker *trackers;
-	int cur_tracker;
+	/* aligned to CACHE_LINE_SIZE within trackers_mem */
+	struct pointer_trackers *trackers;
+	void *trackers_mem;
+	unsigned int cur_tracker;
 
 	double threshold;	/* units/ms */
 	double accel;		/* unitless factor */
 	double incline;		/* incline of the function */
+
+	/* ACCEL_TABLE_SIZE + 1 samples of the profile, rebuilt whenever
+	 * the speed changes */
+	accel_t *table;
 };
 
 static void
 feed_trackers(struct pointer_accelerator *accel,
-	      const struct normalized_coords *delta,
+	      const motion_coords_t *delta,
 	      uint64_t time)
 {
-	int i, current;
-	struct pointer_tracker *trackers = accel->trackers;
+	struct pointer_trackers *trackers = accel->trackers;
+	unsigned int i, current;
 
 	for (i = 0; i < NUM_POINTER_TRACKERS; i++) {
-		trackers[i].delta.x += delta->x;
-		trackers[i].delta.y += delta->y;
+		trackers->delta[i].x += delta->x;
+		trackers->delta[i].y += delta->y;
 	}
 
-	current = (accel->cur_tracker + 1) % NUM_POINTER_TRACKERS;
+	current = (accel->cur_tracker + 1) & (NUM_POINTER_TRACKERS - 1);
 	accel->cur_tracker = current;
 
-	trackers[current].delta.x = 0.0;
-	trackers[current].delta.y = 0.0;
-	trackers[current].time = time;
-	trackers[current].dir = normalized_get_direction(*delta);
+	trackers->delta[current].x = 0;
+	trackers->delta[current].y = 0;
+	trackers->time[current] = time;
+	trackers->dir[current] = motion_get_direction(*delta);
 }
 
-static struct pointer_tracker *
-tracker_by_offset(struct pointer_accelerator *accel, unsigned int offset)
+static accel_t
+calculate_tracker_velocity(const struct pointer_trackers *trackers,
+			   unsigned int index,
+			   uint64_t time)
 {
-	unsigned int index =
-		(accel->cur_tracker + NUM_POINTER_TRACKERS - offset)
-		% NUM_POINTER_TRACKERS;
-	return &accel->trackers[index];
-}
+#ifdef HAVE_FIXED_POINT
+	/* calculate_velocity() stops at trackers older than MOTION_TIMEOUT,
+	 * so tdelta fits into 19 bits. Scale length down to 22 bits and
+	 * the division fits into 32 bits. */
+	uint32_t tdelta = time - trackers->time[index] + 1; /* us */
+	uint64_t length;
+	unsigned int shift = 0;
+
+	length = fixed_hypot(trackers->delta[index].x,
+			     trackers->delta[index].y);
+
+	while (length >= ((uint64_t)1 << 22)) {
+		length >>= 1;
+		shift++;
+	}
 
-static double
-calculate_tracker_velocity(struct pointer_tracker *tracker, uint64_t time)
-{
-	double tdelta = time - tracker->time + 1;
+	/* units/ms */
+	return (fixed_t)((uint32_t)length * 1000 / tdelta) << shift;
+#else
+	double tdelta = time - trackers->time[index] + 1; /* us */
 
-	return normalized_length(tracker->delta) / tdelta; /* units/ms */
+	/* units/ms */
+	return normalized_length(trackers->delta[index]) / tdelta * 1000;
+#endif
 }
 
-static double
+static accel_t
 calculate_velocity(struct pointer_accelerator *accel, uint64_t time)
 {
-	struct pointer_tracker *tracker;
-	double velocity;
-	double result = 0.0;
-	double initial_velocity = 0.0;
-	double velocity_diff;
-	unsigned int offset;
-
-	unsigned int dir = tracker_by_offset(accel, 0)->dir;
+	const struct pointer_trackers *trackers = accel->trackers;
+	accel_t velocity;
+	accel_t result = 0;
+	accel_t initial_velocity = 0;
+	accel_t velocity_diff;
+	unsigned int offset, index;
+	unsigned int dir = trackers->dir[accel->cur_tracker];
 
 	/* Find least recent vector within a timelimit, maximum velocity diff
 	 * and direction threshold. */
 	for (offset = 1; offset < NUM_POINTER_TRACKERS; offset++) {
-		tracker = tracker_by_offset(accel, offset);
+		index = (accel->cur_tracker - offset) &
+			(NUM_POINTER_TRACKERS - 1);
 
 		/* Stop if too far away in time */
-		if (time - tracker->time > MOTION_TIMEOUT ||
-		    tracker->time > time)
+		if (time - trackers->time[index] > MOTION_TIMEOUT ||
+		    trackers->time[index] > time)
 			break;
 
 		/* Stop if direction changed */
-		dir &= tracker->dir;
+		dir &= trackers->dir[index];
 		if (dir == 0)
 			break;
 
-		velocity = calculate_tracker_velocity(tracker, time);
+		velocity = calculate_tracker_velocity(trackers, index, time);
 
-		if (initial_velocity == 0.0) {
+		if (initial_velocity == 0) {
 			result = initial_velocity = velocity;
 		} else {
 			/* Stop if velocity differs too much from initial */
-			velocity_diff = fabs(initial_velocity - velocity);
-			if (velocity_diff > MAX_VELOCITY_DIFF)
+			velocity_diff = initial_velocity - velocity;
+			if (velocity_diff < 0)
+				velocity_diff = -velocity_diff;
+			if (velocity_diff > ACCEL_CONST(MAX_VELOCITY_DIFF))
 				break;
 
 			result = velocity;
@@ -187,50 +285,96 @@ calculate_velocity(struct pointer_accelerator *accel, uint64_t time)
 	return result; /* units/ms */
 }
 
-static double
+static void
+accelerator_build_table(struct pointer_accelerator *accel)
+{
+	const double step = (double)ACCEL_TABLE_MAX_VELOCITY / ACCEL_TABLE_SIZE;
+	unsigned int i;
+
+	/* The profiles only depend on the velocity, they ignore data and
+	 * time */
+	for (i = 0; i <= ACCEL_TABLE_SIZE; i++)
+		accel->table[i] = accel_from_double(accel->profile(&accel->base,
+								   NULL,
+								   i * step,
+								   0));
+}
+
+#ifdef HAVE_FIXED_POINT
+static accel_t
 acceleration_profile(struct pointer_accelerator *accel,
-		     void *data, double velocity, uint64_t time)
+		     void *data, accel_t velocity, uint64_t time)
 {
-	return accel->profile(&accel->base, data, velocity, time);
+	const fixed_t *table = accel->table;
+	fixed_t pos = velocity * (ACCEL_TABLE_SIZE / ACCEL_TABLE_MAX_VELOCITY);
+	fixed_t i = pos >> FIXED_SHIFT;
+
+	if (i >= ACCEL_TABLE_SIZE)
+		return fixed_from_double(
+			accel->profile(&accel->base,
+				       data,
+				       fixed_to_double(velocity),
+				       time));
+
+	return table[i] + fixed_mul(table[i + 1] - table[i],
+				    pos & (FIXED_ONE - 1));
 }
+#else
+static accel_t
+acceleration_profile(struct pointer_accelerator *accel,
+		     void *data, accel_t velocity, uint64_t time)
+{
+	const double scale = ACCEL_TABLE_SIZE / ACCEL_TABLE_MAX_VELOCITY;
+	const double *table = accel->table;
+	double pos = velocity * scale;
+	unsigned int i;
+
+	if (!(pos < ACCEL_TABLE_SIZE))
+		return accel->profile(&accel->base, data, velocity, time);
+
+	i = (unsigned int)pos;
 
-static double
+	return table[i] + (table[i + 1] - table[i]) * (pos - i);
+}
+#endif
+
+static accel_t
 calculate_acceleration(struct pointer_accelerator *accel,
-		       void *data, double velocity, uint64_t time)
+		       void *data, accel_t velocity, uint64_t time)
 {
-	double factor;
+	accel_t factor;
 
 	/* Use Simpson's rule to calculate the avarage acceleration between
 	 * the previous motion and the most recent. */
 	factor = acceleration_profile(accel, data, velocity, time);
 	factor += acceleration_profile(accel, data, accel->last_velocity, time);
-	factor += 4.0 *
+	factor += 4 *
 		acceleration_profile(accel, data,
 				     (accel->last_velocity + velocity) / 2,
 				     time);
 
-	factor = factor / 6.0;
+	factor = factor / 6;
 
 	return factor; /* unitless factor */
 }
 
-static struct normalized_coords
-accelerator_filter(struct motion_filter *filter,
-		   const struct normalized_coords *unaccelerated,
-		   void *data, uint64_t time)
+static motion_coords_t
+accelerator_filter_motion(struct motion_filter *filter,
+			  const motion_coords_t *unaccelerated,
+			  void *data, uint64_t time)
 {
 	struct pointer_accelerator *accel =
 		(struct pointer_accelerator *) filter;
-	double velocity; /* units/ms */
-	double accel_value; /* unitless factor */
-	struct normalized_coords accelerated;
+	accel_t velocity; /* units/ms */
+	accel_t accel_value; /* unitless factor */
+	motion_coords_t accelerated;
 
 	feed_trackers(accel, unaccelerated, time);
 	velocity = calculate_velocity(accel, time);
 	accel_value = calculate_acceleration(accel, data, velocity, time);
 
-	accelerated.x = accel_value * unaccelerated->x;
-	accelerated.y = accel_value * unaccelerated->y;
+	accelerated.x = accel_mul(accel_value, unaccelerated->x);
+	accelerated.y = accel_mul(accel_value, unaccelerated->y);
 
 	accel->last = *unaccelerated;
 
@@ -239,14 +383,88 @@ accelerator_filter(struct motion_filter *filter,
 	return accelerated;
 }
 
+static struct normalized_coords
+accelerator_filter(struct motion_filter *filter,
+		   const struct normalized_coords *unaccelerated,
+		   void *data, uint64_t time)
+{
+	motion_coords_t delta = motion_from_normalized(*unaccelerated);
+
+	return motion_to_normalized(accelerator_filter_motion(filter,
+							      &delta,
+							      data,
+							      time));
+}
+
+static void
+accelerator_filter_batch(struct motion_filter *filter,
+			 const struct normalized_coords *unaccelerated,
+			 struct normalized_coords *accelerated,
+			 const uint64_t *times,
+			 size_t n,
+			 void *data)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *) filter;
+	accel_t velocity, last_velocity = accel->last_velocity;
+	accel_t factor, profile, last_profile;
+	motion_coords_t delta;
+	size_t i;
+
+	if (n == 0)
+		return;
+
+	/* The velocities depend on all deltas before them, that part is
+	 * sequential. Keep them in the output for now, a double holds any
+	 * accel_t exactly. */
+	for (i = 0; i < n; i++) {
+		delta = motion_from_normalized(unaccelerated[i]);
+		feed_trackers(accel, &delta, times[i]);
+		accelerated[i].x = calculate_velocity(accel, times[i]);
+	}
+
+	/* Same as calculate_acceleration(), except that the profile of one
+	 * velocity is reused as that of the last velocity for the next
+	 * delta. The factors go into the output too. */
+	last_profile = acceleration_profile(accel, data,
+					    last_velocity, times[0]);
+	for (i = 0; i < n; i++) {
+		velocity = accelerated[i].x;
+		profile = acceleration_profile(accel, data,
+					       velocity, times[i]);
+		factor = profile;
+		factor += last_profile;
+		factor += 4 *
+			acceleration_profile(accel, data,
+					     (last_velocity + velocity) / 2,
+					     times[i]);
+		accelerated[i].y = factor / 6;
+
+		last_profile = profile;
+		last_velocity = velocity;
+	}
+
+	for (i = 0; i < n; i++) {
+		factor = accelerated[i].y;
+		delta = motion_from_normalized(unaccelerated[i]);
+		delta.x = accel_mul(factor, delta.x);
+		delta.y = accel_mul(factor, delta.y);
+		accelerated[i] = motion_to_normalized(delta);
+	}
+
+	accel->last = motion_from_normalized(unaccelerated[n - 1]);
+	accel->last_velocity = last_velocity;
+}
+
 static void
 accelerator_destroy(struct motion_filter *filter)
 {
 	struct pointer_accelerator *accel =
 		(struct pointer_accelerator *) filter;
 
-	free(accel->trackers);
-	free(accel);
+	mem_free(filter->mem, accel->table);
+	mem_free(filter->mem, accel->trackers_mem);
+	mem_free(filter->mem, accel);
 }
 
 static bool
@@ -270,6 +488,9 @@ accelerator_set_speed(struct motion_filter *filter,
 	accel_filter->incline = DEFAULT_INCLINE + speed * 0.75;
 
 	filter->speed = speed;
+
+	accelerator_build_table(accel_filter);
+
 	return true;
 }
 
@@ -277,35 +498,74 @@ struct motion_filter_interface accelerator_interface = {
 	accelerator_filter,
 	accelerator_destroy,
 	accelerator_set_speed,
+	accelerator_filter_batch,
+	accelerator_filter_motion,
 };
 
 struct motion_filter *
-create_pointer_accelerator_filter(accel_profile_func_t profile)
+create_pointer_accelerator_filter(accel_profile_func_t profile,
+				  struct mem_allocator *mem)
 {
 	struct pointer_accelerator *filter;
 
-	filter = zalloc(sizeof *filter);
+	filter = mem_zalloc(mem, sizeof *filter);
 	if (filter == NULL)
 		return NULL;
 
 	filter->base.interface = &accelerator_interface;
+	filter->base.mem = mem;
 
 	filter->profile = profile;
 	filter->last_velocity = 0.0;
 	filter->last.x = 0;
 	filter->last.y = 0;
 
-	filter->trackers =
-		calloc(NUM_POINTER_TRACKERS, sizeof *filter->trackers);
+	/* The allocator has no alignment beyond malloc's, pad the
+	 * allocation and align the trackers within it */
+	filter->trackers_mem = mem_zalloc(mem,
+					  sizeof *filter->trackers +
+					  CACHE_LINE_SIZE - 1);
+	if (filter->trackers_mem == NULL) {
+		mem_free(mem, filter);
+		return NULL;
+	}
+	filter->trackers = (struct pointer_trackers *)
+		(((uintptr_t)filter->trackers_mem + CACHE_LINE_SIZE - 1) &
+		 ~(uintptr_t)(CACHE_LINE_SIZE - 1));
 	filter->cur_tracker = 0;
 
 	filter->threshold = DEFAULT_THRESHOLD;
 	filter->accel = DEFAULT_ACCELERATION;
 	filter->incline = DEFAULT_INCLINE;
 
+	filter->table = mem_calloc(mem,
+				   ACCEL_TABLE_SIZE + 1,
+				   sizeof *filter->table);
+	if (filter->table == NULL) {
+		mem_free(mem, filter->trackers_mem);
+		mem_free(mem, filter);
+		return NULL;
+	}
+	accelerator_build_table(filter);
+
 	return &filter->base;
 }
 
+double
+pointer_accel_lookup(struct motion_filter *filter,
+		     void *data,
+		     double speed_in,
+		     uint64_t time)
+{
+	struct pointer_accelerator *accel_filter =
+		(struct pointer_accelerator *)filter;
+
+	return accel_to_double(acceleration_profile(accel_filter,
+						    data,
+						    accel_from_double(speed_in),
+						    time));
+}
+
 double
 pointer_accel_profile_linear(struct motion_filter *filter,
 			     void *data,
@@ -36,6 +36,25 @@ struct normalized_coords
 filter_dispatch(struct motion_filter *filter,
 		const struct normalized_coords *unaccelerated,
 		void *data, uint64_t time);
+
+/* Same as filter_dispatch() for the deltas of the pointer motion path,
+ * which are in fixed point with --enable-fixed-point */
+motion_coords_t
+filter_dispatch_motion(struct motion_filter *filter,
+		       const motion_coords_t *unaccelerated,
+		       void *data, uint64_t time);
+
+/* Filters n deltas with the given timestamps in order, the result is the
+ * same as that of n calls to filter_dispatch(). The two arrays must not
+ * overlap. */
+void
+filter_dispatch_batch(struct motion_filter *filter,
+		      const struct normalized_coords *unaccelerated,
+		      struct normalized_coords *accelerated,
+		      const uint64_t *times,
+		      size_t n,
+		      void *data);
+
 void
 filter_destroy(struct motion_filter *filter);
 
@@ -51,7 +70,16 @@ typedef double (*accel_profile_func_t)(struct motion_filter *filter,
 				       uint64_t time);
 
 struct motion_filter *
-create_pointer_accelerator_filter(accel_profile_func_t filter);
+create_pointer_accelerator_filter(accel_profile_func_t filter,
+				  struct mem_allocator *mem);
+
+/* The profile of a pointer accelerator filter as the filter applies it,
+ * interpolated from the table of samples taken at the current speed */
+double
+pointer_accel_lookup(struct motion_filter *filter,
+		     void *data,
+		     double speed_in,
+		     uint64_t time);
 
 /*
  * Pointer acceleration profiles.
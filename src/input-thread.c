@@ -0,0 +1,439 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "libinput-private.h"
+#include "input-thread.h"
+#include "timer.h"
+#include "worker-pool.h"
+
+/* Number of events in the hand-off ring, must be a power of two */
+#define THREAD_RING_SIZE 1024
+
+struct libinput_thread {
+	pthread_t thread;
+	/* Held while the input thread processes devices, see
+	 * libinput_lock(). The event hand-off never takes it */
+	pthread_mutex_t device_lock;
+
+	int epoll_fd;	/* the sources, polled by the input thread */
+	int wake_fd;	/* eventfd, wakes up the input thread */
+	int event_fd;	/* eventfd in the caller's epoll set */
+
+	bool stop;		/* accessed atomically */
+	bool producer_waiting;	/* accessed atomically */
+
+	/*
+	 * Single-producer single-consumer ring. Only the input thread
+	 * writes head, only the caller writes tail. Events posted on the
+	 * caller's thread bypass the ring, see
+	 * libinput_thread_post_local().
+	 */
+	struct libinput_event *ring[THREAD_RING_SIZE];
+	size_t head;
+	size_t tail;
+
+	/* Events that did not fit into the ring, under the device lock */
+	struct libinput_event **backlog;
+	size_t backlog_count;
+	size_t backlog_len;
+	bool posted;
+};
+
+static __thread bool on_input_thread;
+
+static bool
+ring_push(struct libinput_thread *t, struct libinput_event *event)
+{
+	size_t head = t->head;
+	size_t tail = __atomic_load_n(&t->tail, __ATOMIC_ACQUIRE);
+
+	if (head - tail == THREAD_RING_SIZE)
+		return false;
+
+	t->ring[head & (THREAD_RING_SIZE - 1)] = event;
+	__atomic_store_n(&t->head, head + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+static struct libinput_event *
+ring_pop(struct libinput_thread *t)
+{
+	size_t tail = t->tail;
+	size_t head = __atomic_load_n(&t->head, __ATOMIC_ACQUIRE);
+	struct libinput_event *event;
+
+	if (tail == head)
+		return NULL;
+
+	event = t->ring[tail & (THREAD_RING_SIZE - 1)];
+	__atomic_store_n(&t->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return event;
+}
+
+static void
+eventfd_signal(int fd)
+{
+	uint64_t value = 1;
+
+	if (write(fd, &value, sizeof value) < 0 && errno != EAGAIN)
+		abort();
+}
+
+static void
+eventfd_clear(int fd)
+{
+	uint64_t value;
+
+	/* nonblocking, an unsignalled eventfd reads EAGAIN */
+	if (read(fd, &value, sizeof value) < 0 && errno != EAGAIN)
+		abort();
+}
+
+/*
+ * Events posted on the caller's thread, e.g. when a device is added or
+ * removed. Whatever the input thread handed over is older and goes into
+ * the queue first. The caller usually holds the device lock already, the
+ * backlog needs it.
+ */
+static void
+libinput_thread_post_local(struct libinput *libinput,
+			   struct libinput_event *event)
+{
+	struct libinput_thread *t = libinput->thread;
+	struct libinput_event *queued;
+	size_t i;
+
+	pthread_mutex_lock(&t->device_lock);
+
+	while ((queued = ring_pop(t)))
+		libinput_queue_event(libinput, queued);
+	for (i = 0; i < t->backlog_count; i++)
+		libinput_queue_event(libinput, t->backlog[i]);
+	t->backlog_count = 0;
+
+	libinput_queue_event(libinput, event);
+
+	pthread_mutex_unlock(&t->device_lock);
+
+	eventfd_signal(t->event_fd);
+	if (__atomic_exchange_n(&t->producer_waiting, false, __ATOMIC_SEQ_CST))
+		eventfd_signal(t->wake_fd);
+}
+
+void
+libinput_thread_post_event(struct libinput *libinput,
+			   struct libinput_event *event)
+{
+	struct libinput_thread *t = libinput->thread;
+	struct libinput_event **backlog;
+	size_t len;
+
+	if (!on_input_thread) {
+		libinput_thread_post_local(libinput, event);
+		return;
+	}
+
+	/* keep the order, nothing may overtake the backlog */
+	if (t->backlog_count == 0 && ring_push(t, event)) {
+		t->posted = true;
+		return;
+	}
+
+	if (t->backlog_count == t->backlog_len) {
+		len = t->backlog_len ? t->backlog_len * 2 : 64;
+		backlog = libinput_realloc(libinput,
+					   t->backlog,
+					   len * sizeof(*backlog));
+		if (!backlog) {
+			log_error(libinput, "Failed to queue event\n");
+			libinput_event_destroy(event);
+			return;
+		}
+
+		t->backlog = backlog;
+		t->backlog_len = len;
+	}
+
+	t->backlog[t->backlog_count++] = event;
+}
+
+static void
+libinput_thread_flush_backlog(struct libinput_thread *t)
+{
+	size_t i = 0;
+
+	while (i < t->backlog_count && ring_push(t, t->backlog[i]))
+		i++;
+
+	if (i > 0) {
+		t->backlog_count -= i;
+		memmove(t->backlog,
+			t->backlog + i,
+			t->backlog_count * sizeof(*t->backlog));
+		t->posted = true;
+	}
+}
+
+static void
+libinput_thread_flush(struct libinput_thread *t)
+{
+	libinput_thread_flush_backlog(t);
+
+	/* Ask the caller for a wakeup once it made room, then check
+	 * again in case it did so before it saw the flag */
+	if (t->backlog_count > 0) {
+		__atomic_store_n(&t->producer_waiting, true, __ATOMIC_SEQ_CST);
+		libinput_thread_flush_backlog(t);
+	}
+
+	if (t->posted) {
+		t->posted = false;
+		eventfd_signal(t->event_fd);
+	}
+}
+
+static int
+libinput_thread_timeout(struct libinput *libinput)
+{
+	uint64_t expire, now;
+
+	/* the timerfd is one of the sources */
+	if (libinput->timer.source)
+		return -1;
+
+	expire = libinput_timer_next_expiry(libinput);
+	if (expire == 0)
+		return -1;
+
+	now = libinput_now(libinput);
+	if (expire <= now)
+		return 0;
+
+	return (expire - now + 999) / 1000;
+}
+
+static void *
+libinput_thread_main(void *data)
+{
+	struct libinput *libinput = data;
+	struct libinput_thread *t = libinput->thread;
+	struct pollfd fds[2];
+	int timeout = -1;
+	nfds_t nfds = 2;
+	bool read_devices;
+
+	on_input_thread = true;
+
+	fds[0].fd = t->wake_fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = t->epoll_fd;
+	fds[1].events = POLLIN;
+
+	while (!__atomic_load_n(&t->stop, __ATOMIC_ACQUIRE)) {
+		if (poll(fds, nfds, timeout) < 0 && errno != EINTR)
+			break;
+
+		if (fds[0].revents & POLLIN)
+			eventfd_clear(t->wake_fd);
+
+		pthread_mutex_lock(&t->device_lock);
+
+		/* The backlog may have been drained by the caller in the
+		 * meantime */
+		read_devices = t->backlog_count == 0;
+		if (read_devices)
+			libinput_dispatch_sources(libinput);
+		libinput_thread_flush(t);
+		timeout = libinput_thread_timeout(libinput);
+
+		/* Stop reading devices while the caller falls behind, the
+		 * kernel buffers their events in the meantime */
+		nfds = t->backlog_count > 0 ? 1 : 2;
+
+		pthread_mutex_unlock(&t->device_lock);
+	}
+
+	return NULL;
+}
+
+int
+libinput_thread_dispatch(struct libinput *libinput)
+{
+	struct libinput_thread *t = libinput->thread;
+	struct libinput_event *event;
+	int rc = 0;
+
+	eventfd_clear(t->event_fd);
+
+	/* Only the caller pops the ring and touches the queue. Events
+	 * destroyed by coalescing or the queue limit go back to their pool
+	 * without a lock, see event_pool_release(), so this never waits
+	 * for the input thread to finish processing devices */
+	while (true) {
+		if (libinput->events_limit &&
+		    libinput->events_policy == LIBINPUT_EVENT_QUEUE_BLOCK &&
+		    libinput->events_count >= libinput->events_limit) {
+			rc = -EAGAIN;
+			break;
+		}
+
+		event = ring_pop(t);
+		if (!event)
+			break;
+
+		libinput_queue_event(libinput, event);
+	}
+
+	if (__atomic_exchange_n(&t->producer_waiting, false, __ATOMIC_SEQ_CST))
+		eventfd_signal(t->wake_fd);
+
+	return rc;
+}
+
+static void
+libinput_thread_destroy(struct libinput *libinput,
+			struct libinput_thread *t)
+{
+	if (t->event_fd != -1) {
+		epoll_ctl(libinput->epoll_fd, EPOLL_CTL_DEL, t->event_fd, NULL);
+		close(t->event_fd);
+	}
+	if (t->wake_fd != -1)
+		close(t->wake_fd);
+	if (t->epoll_fd != -1)
+		close(t->epoll_fd);
+
+	pthread_mutex_destroy(&t->device_lock);
+	libinput_free(libinput, t->backlog);
+	libinput_free(libinput, t);
+}
+
+int
+libinput_thread_start(struct libinput *libinput)
+{
+	struct libinput_thread *t;
+	pthread_mutexattr_t attr;
+	struct epoll_event ep;
+
+	if (libinput->thread)
+		return 0;
+
+	t = libinput_zalloc(libinput, sizeof *t);
+	if (!t)
+		return -1;
+
+	/* callbacks on the input thread may call back into libinput */
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&t->device_lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	t->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	t->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	t->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (t->epoll_fd < 0 || t->wake_fd < 0 || t->event_fd < 0)
+		goto err;
+
+	/* the caller keeps polling the fd from libinput_get_fd(), it
+	 * only contains the event_fd now */
+	memset(&ep, 0, sizeof ep);
+	ep.events = EPOLLIN;
+	if (epoll_ctl(libinput->epoll_fd, EPOLL_CTL_ADD, t->event_fd, &ep) < 0) {
+		close(t->event_fd);
+		t->event_fd = -1;
+		goto err;
+	}
+
+	if (libinput_move_sources(libinput, t->epoll_fd) != 0)
+		goto err;
+
+	libinput->thread = t;
+	if (pthread_create(&t->thread, NULL, libinput_thread_main, libinput) != 0) {
+		libinput->thread = NULL;
+		libinput_move_sources(libinput, libinput->epoll_fd);
+		goto err;
+	}
+
+	return 0;
+
+err:
+	libinput_thread_destroy(libinput, t);
+	return -1;
+}
+
+void
+libinput_thread_stop(struct libinput *libinput)
+{
+	struct libinput_thread *t = libinput->thread;
+	struct libinput_event *event;
+	size_t i;
+
+	if (!t)
+		return;
+
+	__atomic_store_n(&t->stop, true, __ATOMIC_RELEASE);
+	eventfd_signal(t->wake_fd);
+	pthread_join(t->thread, NULL);
+
+	libinput->thread = NULL;
+
+	/* Hand over whatever the thread processed, in order */
+	while ((event = ring_pop(t)))
+		libinput_queue_event(libinput, event);
+	for (i = 0; i < t->backlog_count; i++)
+		libinput_queue_event(libinput, t->backlog[i]);
+
+	libinput_move_sources(libinput, libinput->epoll_fd);
+	libinput_thread_destroy(libinput, t);
+}
+
+struct libinput *
+libinput_lock(struct libinput *libinput)
+{
+	/* The input thread holds the lock while the workers run */
+	if (!libinput->thread || libinput_workers_in_worker())
+		return NULL;
+
+	pthread_mutex_lock(&libinput->thread->device_lock);
+
+	return libinput;
+}
+
+void
+libinput_unlock(struct libinput *libinput)
+{
+	if (libinput->thread)
+		pthread_mutex_unlock(&libinput->thread->device_lock);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef INPUT_THREAD_H
+#define INPUT_THREAD_H
+
+#include <stdbool.h>
+
+struct libinput;
+struct libinput_event;
+
+int
+libinput_thread_start(struct libinput *libinput);
+
+void
+libinput_thread_stop(struct libinput *libinput);
+
+/* Called on the input thread for every event that is ready */
+void
+libinput_thread_post_event(struct libinput *libinput,
+			   struct libinput_event *event);
+
+/* Called by libinput_dispatch() to collect the input thread's events */
+int
+libinput_thread_dispatch(struct libinput *libinput);
+
+/*
+ * While the input thread runs, everything that touches device state from
+ * the caller's side must hold the context lock, the input thread holds it
+ * while it processes devices. Both return immediately if no input thread
+ * runs, libinput_lock() returns NULL in that case. The lock is recursive.
+ */
+struct libinput *
+libinput_lock(struct libinput *libinput);
+
+void
+libinput_unlock(struct libinput *libinput);
+
+static inline void
+libinput_unlock_scope(struct libinput **libinput)
+{
+	if (*libinput)
+		libinput_unlock(*libinput);
+}
+
+/* Take the context lock until the end of the enclosing scope */
+#define libinput_lock_scope(li_) \
+	struct libinput *_libinput_locked_ \
+		__attribute__((cleanup(libinput_unlock_scope))) = \
+		libinput_lock(li_)
+
+#endif
@@ -25,6 +25,7 @@
 
 #include <errno.h>
 #include <math.h>
+#include <stdbool.h>
 
 #include "linux/input.h"
 
@@ -32,6 +33,9 @@
 #include "libinput-util.h"
 
 struct libinput_source;
+struct libinput_thread;
+struct libinput_timer;
+struct libinput_workers;
 
 /* A coordinate pair in device coordinates */
 struct device_coords {
@@ -51,6 +55,31 @@ struct normalized_coords {
 	double x, y;
 };
 
+/* A dpi-normalized coordinate pair in fixed point */
+struct normalized_fixed {
+	fixed_t x, y;
+};
+
+/*
+ * The deltas of the pointer motion path, from the normalization through
+ * the acceleration filter into the motion event. With
+ * --enable-fixed-point they stay in fixed point, only the event getters
+ * convert them to double.
+ */
+#ifdef HAVE_FIXED_POINT
+typedef struct normalized_fixed motion_coords_t;
+#define motion_from_normalized(n_) normalized_to_fixed(n_)
+#define motion_to_normalized(m_) normalized_from_fixed(m_)
+#define motion_is_zero(m_) normalized_fixed_is_zero(m_)
+#define motion_get_direction(m_) normalized_fixed_get_direction(m_)
+#else
+typedef struct normalized_coords motion_coords_t;
+#define motion_from_normalized(n_) (n_)
+#define motion_to_normalized(m_) (m_)
+#define motion_is_zero(m_) normalized_is_zero(m_)
+#define motion_get_direction(m_) normalized_get_direction(m_)
+#endif
+
 /* A discrete step pair (mouse wheels) */
 struct discrete_coords {
 	int x, y;
@@ -64,14 +93,53 @@ struct libinput_interface_backend {
 				  const char *seat_name);
 };
 
+enum libinput_event_pool_type {
+	EVENT_POOL_DEVICE_NOTIFY,
+	EVENT_POOL_KEYBOARD,
+	EVENT_POOL_POINTER,
+	EVENT_POOL_TOUCH,
+
+	EVENT_POOL_COUNT
+};
+
+struct event_pool_item;
+union event_pool_slab;
+
+/*
+ * Per-context cache of event structs of one type. Events are carved out of
+ * slabs and recycled by libinput_event_destroy(), so once the pools are
+ * warm, posting an event does not touch the heap.
+ */
+struct libinput_event_pool {
+	size_t event_size;
+	struct event_pool_item *free_list;
+	/* events released while the input thread runs, taken over by the
+	 * free list once it runs dry. Accessed atomically */
+	struct event_pool_item *returned;
+	union event_pool_slab *slabs;
+	uint64_t hits;		/* allocations served from the free list */
+	uint64_t misses;	/* allocations that required a new slab */
+};
+
 struct libinput {
 	int epoll_fd;
+	int sources_fd; /* epoll_fd, or the input thread's epoll fd */
+	struct list source_list;
 	struct list source_destroy_list;
+	struct epoll_event *ep_events;
+	size_t ep_events_len;
+	size_t sources_count;
 
 	struct list seat_list;
 
 	struct {
-		struct list list;
+		struct libinput_timer **heap; /* min-heap by expiry */
+		size_t heap_len;
+		size_t count;
+		uint64_t armed; /* expiry the timerfd is armed for, or 0 */
+		bool dispatching;
+		unsigned int round; /* simulated clock dispatch round */
+		struct list deferred; /* timers re-armed too early this round */
 		struct libinput_source *source;
 		int fd;
 	} timer;
@@ -81,6 +149,30 @@ struct libinput {
 	size_t events_len;
 	size_t events_in;
 	size_t events_out;
+	size_t events_limit; /* 0 for unlimited */
+	enum libinput_event_queue_policy events_policy;
+
+	struct libinput_event_pool event_pools[EVENT_POOL_COUNT];
+	bool coalesce_events;
+	bool pointer_frames; /* see libinput_set_pointer_frames() */
+
+	struct libinput_thread *thread; /* NULL unless the input thread runs */
+
+	uint32_t event_mask; /* enum libinput_event_group */
+
+	struct libinput_stats stats; /* see libinput_stats_add() */
+
+	struct libinput_workers *workers; /* NULL unless enabled */
+	bool parallel_dispatch; /* true while the workers process devices */
+	struct list staged_list; /* devices with staged events */
+	struct list pointer_frame_list; /* devices with a pending frame */
+
+	struct mem_allocator mem; /* see libinput_zalloc() */
+
+	struct {
+		libinput_clock_func func; /* NULL for CLOCK_MONOTONIC */
+		void *user_data;
+	} clock;
 
 	const struct libinput_interface *interface;
 	const struct libinput_interface_backend *interface_backend;
@@ -202,11 +294,17 @@ struct libinput_device_config {
 };
 
 struct libinput_device_group {
+	struct libinput *libinput;
 	int refcount;
 	void *user_data;
 	char *identifier; /* unique identifier or NULL for singletons */
 };
 
+/* Latency histograms have log2 buckets of microseconds, the last one
+ * holds everything above. Only event types with a timestamp have one */
+#define LATENCY_BUCKETS 32
+#define LATENCY_EVENT_TYPES 11
+
 struct libinput_device {
 	struct libinput_seat *seat;
 	struct libinput_device_group *group;
@@ -215,6 +313,47 @@ struct libinput_device {
 	void *user_data;
 	int refcount;
 	struct libinput_device_config config;
+
+	/* events dropped or merged because the event queue was full */
+	uint64_t dropped_events;
+	/* the caller read pointer events of a frame it hasn't read the
+	 * end of yet */
+	bool pointer_frame_read;
+	/* a motion dropped on a full queue was all of the frame that is
+	 * still to be queued, the frame gets dropped too */
+	bool pointer_frame_dropped;
+
+	struct libinput_stats stats; /* see libinput_stats_add() */
+
+	/* delay between the kernel timestamp and libinput_get_event() */
+	uint64_t latency[LATENCY_EVENT_TYPES][LATENCY_BUCKETS];
+
+	/* overrides the context's event mask if event_mask_set is true */
+	uint32_t event_mask;
+	bool event_mask_set;
+
+	/* pointer events were posted since the last pointer frame, the
+	 * frame carries the time of the most recent one */
+	bool pointer_frame_pending;
+	uint64_t pointer_frame_time;
+	struct list pointer_frame_link;
+
+	/* the first device of the set the worker pool processes on one
+	 * thread, the events of that set are staged in its stream */
+	struct libinput_device *worker_group;
+
+	/* events posted while devices are processed in parallel, merged
+	 * into the event queue by time once all devices are done */
+	struct libinput_staged_event *staged;
+	size_t staged_count;
+	size_t staged_len;
+	size_t staged_read;
+	struct list staged_link;
+};
+
+struct libinput_staged_event {
+	struct libinput_event *event;
+	uint64_t time;
 };
 
 struct libinput_event {
@@ -224,11 +363,19 @@ struct libinput_event {
 
 struct libinput_event_listener {
 	struct list link;
+	struct libinput_device *device; /* the device listened to */
+	struct libinput_device *owner; /* the device whose state is updated */
 	void (*notify_func)(uint64_t time, struct libinput_event *ev, void *notify_func_data);
 	void *notify_func_data;
 };
 
-typedef void (*libinput_source_dispatch_t)(void *data);
+/*
+ * Dispatch a source that is ready for reading. budget is the number of
+ * event frames the source may process before yielding to other sources,
+ * 0 for no limit. Returns true if the source yielded with events left to
+ * process, false once it is drained.
+ */
+typedef bool (*libinput_source_dispatch_t)(void *data, unsigned int budget);
 
 #define log_debug(li_, ...) log_msg((li_), LIBINPUT_LOG_PRIORITY_DEBUG, __VA_ARGS__)
 #define log_info(li_, ...) log_msg((li_), LIBINPUT_LOG_PRIORITY_INFO, __VA_ARGS__)
@@ -250,6 +397,7 @@ log_msg_va(struct libinput *libinput,
 
 int
 libinput_init(struct libinput *libinput,
+	      const struct mem_allocator *mem,
 	      const struct libinput_interface *interface,
 	      const struct libinput_interface_backend *interface_backend,
 	      void *user_data);
@@ -264,6 +412,45 @@ void
 libinput_remove_source(struct libinput *libinput,
 		       struct libinput_source *source);
 
+void
+libinput_source_set_priority(struct libinput_source *source,
+			     bool priority);
+
+void
+libinput_source_set_enabled(struct libinput *libinput,
+			    struct libinput_source *source,
+			    bool enabled);
+
+bool
+libinput_source_get_enabled(struct libinput_source *source);
+
+void
+libinput_source_set_device(struct libinput_source *source,
+			   struct libinput_device *device);
+
+struct libinput_device *
+libinput_source_get_device(struct libinput_source *source);
+
+bool
+libinput_source_dispatch(struct libinput_source *source,
+			 unsigned int budget);
+
+int
+libinput_move_sources(struct libinput *libinput, int epoll_fd);
+
+int
+libinput_dispatch_sources(struct libinput *libinput);
+
+void
+libinput_queue_event(struct libinput *libinput,
+		     struct libinput_event *event);
+
+void
+libinput_flush_staged_events(struct libinput *libinput);
+
+void
+libinput_flush_pointer_frames(struct libinput *libinput);
+
 int
 open_restricted(struct libinput *libinput,
 		const char *path, int flags);
@@ -283,7 +470,8 @@ libinput_device_init(struct libinput_device *device,
 		     struct libinput_seat *seat);
 
 struct libinput_device_group *
-libinput_device_group_create(const char *identifier);
+libinput_device_group_create(struct libinput *libinput,
+			     const char *identifier);
 
 void
 libinput_device_set_device_group(struct libinput_device *device,
@@ -291,6 +479,7 @@ libinput_device_set_device_group(struct libinput_device *device,
 
 void
 libinput_device_add_event_listener(struct libinput_device *device,
+				   struct libinput_device *owner,
 				   struct libinput_event_listener *listener,
 				   void (*notify_func)(
 						uint64_t time,
@@ -301,6 +490,12 @@ libinput_device_add_event_listener(struct libinput_device *device,
 void
 libinput_device_remove_event_listener(struct libinput_event_listener *listener);
 
+uint32_t
+libinput_device_event_mask(struct libinput_device *device);
+
+bool
+libinput_device_wants_input(struct libinput_device *device);
+
 void
 notify_added_device(struct libinput_device *device);
 
@@ -316,8 +511,8 @@ keyboard_notify_key(struct libinput_device *device,
 void
 pointer_notify_motion(struct libinput_device *device,
 		      uint64_t time,
-		      const struct normalized_coords *delta,
-		      const struct normalized_coords *unaccel);
+		      const motion_coords_t *delta,
+		      const motion_coords_t *unaccel);
 
 void
 pointer_notify_motion_absolute(struct libinput_device *device,
@@ -358,12 +553,17 @@ touch_notify_touch_up(struct libinput_device *device,
 		      int32_t slot,
 		      int32_t seat_slot);
 
+void
+pointer_notify_frame(struct libinput_device *device);
+
 void
 touch_notify_frame(struct libinput_device *device,
 		   uint64_t time);
 
+/* The real time, regardless of libinput_set_clock(). Use this to
+ * measure how long something took */
 static inline uint64_t
-libinput_now(struct libinput *libinput)
+libinput_monotonic_now(struct libinput *libinput)
 {
 	struct timespec ts = { 0, 0 };
 
@@ -372,7 +572,88 @@ libinput_now(struct libinput *libinput)
 		return 0;
 	}
 
-	return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/* The context's time, all timestamps and timers are based on this */
+static inline uint64_t
+libinput_now(struct libinput *libinput)
+{
+	if (libinput->clock.func)
+		return libinput->clock.func(libinput->clock.user_data);
+
+	return libinput_monotonic_now(libinput);
+}
+
+/*
+ * All memory owned by a context is allocated through these, see
+ * libinput_get_allocated_bytes()
+ */
+static inline void *
+libinput_zalloc(struct libinput *libinput, size_t size)
+{
+	return mem_zalloc(&libinput->mem, size);
+}
+
+static inline void *
+libinput_calloc(struct libinput *libinput, size_t nmemb, size_t size)
+{
+	return mem_calloc(&libinput->mem, nmemb, size);
+}
+
+static inline void *
+libinput_malloc(struct libinput *libinput, size_t size)
+{
+	return mem_malloc(&libinput->mem, size);
+}
+
+static inline void *
+libinput_realloc(struct libinput *libinput, void *ptr, size_t size)
+{
+	return mem_realloc(&libinput->mem, ptr, size);
+}
+
+static inline char *
+libinput_strdup(struct libinput *libinput, const char *str)
+{
+	return mem_strdup(&libinput->mem, str);
+}
+
+static inline void
+libinput_free(struct libinput *libinput, void *ptr)
+{
+	mem_free(&libinput->mem, ptr);
+}
+
+/*
+ * The counters in struct libinput_stats may be read from any thread,
+ * always update them through these
+ */
+static inline void
+libinput_stats_add(uint64_t *counter, uint64_t value)
+{
+	__atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t
+libinput_stats_load(const uint64_t *counter)
+{
+	return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static inline void
+libinput_stats_max(uint64_t *counter, uint64_t value)
+{
+	uint64_t current = libinput_stats_load(counter);
+
+	/* current is reloaded on failure, retry until ours is no longer
+	 * the higher value */
+	while (value > current &&
+	       !__atomic_compare_exchange_n(counter, &current, value,
+					    true,
+					    __ATOMIC_RELAXED,
+					    __ATOMIC_RELAXED))
+		;
 }
 
 static inline struct device_float_coords
@@ -398,6 +679,34 @@ normalized_is_zero(struct normalized_coords norm)
 	return norm.x == 0.0 && norm.y == 0.0;
 }
 
+static inline struct normalized_fixed
+normalized_to_fixed(struct normalized_coords norm)
+{
+	struct normalized_fixed fixed;
+
+	fixed.x = fixed_from_double(norm.x);
+	fixed.y = fixed_from_double(norm.y);
+
+	return fixed;
+}
+
+static inline struct normalized_coords
+normalized_from_fixed(struct normalized_fixed fixed)
+{
+	struct normalized_coords norm;
+
+	norm.x = fixed_to_double(fixed.x);
+	norm.y = fixed_to_double(fixed.y);
+
+	return norm;
+}
+
+static inline int
+normalized_fixed_is_zero(struct normalized_fixed norm)
+{
+	return norm.x == 0 && norm.y == 0;
+}
+
 enum directions {
 	N  = 1 << 0,
 	NE = 1 << 1,
@@ -455,4 +764,61 @@ normalized_get_direction(struct normalized_coords norm)
 	return dir;
 }
 
+/* Same as normalized_get_direction() without the floating point */
+static inline int
+normalized_fixed_get_direction(struct normalized_fixed norm)
+{
+	/* tan(4.5°) and tan(40.5°): normalized_get_direction() marks two
+	 * octants unless the angle to the nearest axis or diagonal is
+	 * within 4.5° */
+	const fixed_t tan_axis = 5158, tan_diagonal = 55973;
+	int dir = UNDEFINED_DIRECTION;
+	int horizontal, vertical, diagonal;
+	fixed_t ax, ay;
+
+	ax = norm.x < 0 ? -norm.x : norm.x;
+	ay = norm.y < 0 ? -norm.y : norm.y;
+
+	if (ax < 2 * FIXED_ONE && ay < 2 * FIXED_ONE) {
+		if (norm.x > 0 && norm.y > 0)
+			dir = S | SE | E;
+		else if (norm.x > 0 && norm.y < 0)
+			dir = N | NE | E;
+		else if (norm.x < 0 && norm.y > 0)
+			dir = S | SW | W;
+		else if (norm.x < 0 && norm.y < 0)
+			dir = N | NW | W;
+		else if (norm.x > 0)
+			dir = NE | E | SE;
+		else if (norm.x < 0)
+			dir = NW | W | SW;
+		else if (norm.y > 0)
+			dir = SE | S | SW;
+		else if (norm.y < 0)
+			dir = NE | N | NW;
+	} else {
+		horizontal = norm.x < 0 ? W : E;
+		vertical = norm.y < 0 ? N : S;
+		if (norm.x < 0)
+			diagonal = norm.y < 0 ? NW : SW;
+		else
+			diagonal = norm.y < 0 ? NE : SE;
+
+		/* Compare the angle to the x axis against the octant
+		 * boundaries at 4.5°, 40.5°, 49.5° and 85.5° */
+		if (ay * FIXED_ONE < ax * tan_axis)
+			dir = horizontal;
+		else if (ay * FIXED_ONE < ax * tan_diagonal)
+			dir = horizontal | diagonal;
+		else if (ay * tan_diagonal <= ax * FIXED_ONE)
+			dir = diagonal;
+		else if (ay * tan_axis <= ax * FIXED_ONE)
+			dir = diagonal | vertical;
+		else
+			dir = vertical;
+	}
+
+	return dir;
+}
+
 #endif /* LIBINPUT_PRIVATE_H */
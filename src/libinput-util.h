@@ -25,6 +25,8 @@
 
 #include <unistd.h>
 #include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
@@ -94,6 +96,178 @@ zalloc(size_t size)
 	return calloc(1, size);
 }
 
+/*
+ * Allocation through a caller-supplied struct libinput_allocator. Every
+ * block carries a header with its size so the number of live bytes can
+ * be kept without the callers passing sizes around. A NULL mem_allocator
+ * uses libc directly and counts nothing, the same mem_allocator must be
+ * used to allocate and free a block.
+ */
+struct mem_allocator {
+	struct libinput_allocator hooks;
+	size_t live_bytes; /* accessed atomically */
+};
+
+union mem_header {
+	size_t size;
+	long double align_;
+	void *align_ptr_;
+};
+
+static inline void *
+mem_libc_malloc(size_t size, void *user_data)
+{
+	return malloc(size);
+}
+
+static inline void *
+mem_libc_realloc(void *ptr, size_t size, void *user_data)
+{
+	return realloc(ptr, size);
+}
+
+static inline void
+mem_libc_free(void *ptr, void *user_data)
+{
+	free(ptr);
+}
+
+static inline void
+mem_allocator_init(struct mem_allocator *mem,
+		   const struct libinput_allocator *hooks)
+{
+	mem->live_bytes = 0;
+
+	if (hooks) {
+		mem->hooks = *hooks;
+		return;
+	}
+
+	mem->hooks.malloc_func = mem_libc_malloc;
+	mem->hooks.realloc_func = mem_libc_realloc;
+	mem->hooks.free_func = mem_libc_free;
+	mem->hooks.user_data = NULL;
+}
+
+static inline size_t
+mem_live_bytes(struct mem_allocator *mem)
+{
+	return __atomic_load_n(&mem->live_bytes, __ATOMIC_RELAXED);
+}
+
+static inline void *
+mem_malloc(struct mem_allocator *mem, size_t size)
+{
+	union mem_header *header;
+
+	if (!mem)
+		return malloc(size);
+
+	if (size > SIZE_MAX - sizeof(*header))
+		return NULL;
+
+	header = mem->hooks.malloc_func(sizeof(*header) + size,
+					mem->hooks.user_data);
+	if (!header)
+		return NULL;
+
+	header->size = size;
+	__atomic_add_fetch(&mem->live_bytes, size, __ATOMIC_RELAXED);
+
+	return header + 1;
+}
+
+static inline void *
+mem_zalloc(struct mem_allocator *mem, size_t size)
+{
+	void *ptr = mem_malloc(mem, size);
+
+	if (ptr)
+		memset(ptr, 0, size);
+
+	return ptr;
+}
+
+static inline void *
+mem_calloc(struct mem_allocator *mem, size_t nmemb, size_t size)
+{
+	if (size != 0 && nmemb > SIZE_MAX / size)
+		return NULL;
+
+	return mem_zalloc(mem, nmemb * size);
+}
+
+static inline void *
+mem_realloc(struct mem_allocator *mem, void *ptr, size_t size)
+{
+	union mem_header *header;
+	size_t old_size;
+
+	if (!mem)
+		return realloc(ptr, size);
+
+	if (!ptr)
+		return mem_malloc(mem, size);
+
+	if (size > SIZE_MAX - sizeof(*header))
+		return NULL;
+
+	header = (union mem_header *)ptr - 1;
+	old_size = header->size;
+	header = mem->hooks.realloc_func(header, sizeof(*header) + size,
+					 mem->hooks.user_data);
+	if (!header)
+		return NULL;
+
+	header->size = size;
+	__atomic_add_fetch(&mem->live_bytes, size, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&mem->live_bytes, old_size, __ATOMIC_RELAXED);
+
+	return header + 1;
+}
+
+static inline char *
+mem_strdup(struct mem_allocator *mem, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *copy = mem_malloc(mem, len);
+
+	if (copy)
+		memcpy(copy, str, len);
+
+	return copy;
+}
+
+static inline void
+mem_free(struct mem_allocator *mem, void *ptr)
+{
+	union mem_header *header;
+
+	if (!ptr)
+		return;
+
+	if (!mem) {
+		free(ptr);
+		return;
+	}
+
+	header = (union mem_header *)ptr - 1;
+	__atomic_sub_fetch(&mem->live_bytes, header->size, __ATOMIC_RELAXED);
+	mem->hooks.free_func(header, mem->hooks.user_data);
+}
+
+static inline uint64_t
+ms2us(uint64_t ms)
+{
+	return ms * 1000;
+}
+
+static inline uint32_t
+us2ms(uint64_t us)
+{
+	return (uint32_t)(us / 1000);
+}
+
 static inline void
 msleep(unsigned int ms)
 {
@@ -226,6 +400,102 @@ matrix_to_farray6(const struct matrix *m, float out[6])
 	out[5] = m->val[1][2];
 }
 
+/*
+ * Fixed-point numbers with FIXED_SHIFT fractional bits. With
+ * --enable-fixed-point, the pointer acceleration, the touchpad scale
+ * coefficients and the calibration use these instead of floating point.
+ */
+typedef int64_t fixed_t;
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE ((fixed_t)1 << FIXED_SHIFT)
+
+static inline fixed_t
+fixed_from_int(int v)
+{
+	return (fixed_t)v * FIXED_ONE;
+}
+
+static inline fixed_t
+fixed_from_double(double v)
+{
+	return (fixed_t)(v * FIXED_ONE + (v < 0 ? -0.5 : 0.5));
+}
+
+static inline double
+fixed_to_double(fixed_t v)
+{
+	return (double)v / FIXED_ONE;
+}
+
+static inline fixed_t
+fixed_mul(fixed_t a, fixed_t b)
+{
+	return a * b / FIXED_ONE;
+}
+
+static inline fixed_t
+fixed_hypot(fixed_t x, fixed_t y)
+{
+	uint64_t ax = x < 0 ? -x : x,
+		 ay = y < 0 ? -y : y;
+	uint64_t sq, root = 0, bit = (uint64_t)1 << 62;
+	unsigned int shift = 0;
+
+	/* keep the sum of the squares within 61 bits */
+	while (ax >= ((uint64_t)1 << 30) || ay >= ((uint64_t)1 << 30)) {
+		ax >>= 1;
+		ay >>= 1;
+		shift++;
+	}
+
+	sq = ax * ax + ay * ay;
+
+	while (bit > sq)
+		bit >>= 2;
+
+	while (bit != 0) {
+		if (sq >= root + bit) {
+			sq -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return (fixed_t)(root << shift);
+}
+
+/* The first two rows of a struct matrix, the third is always 0 0 1 */
+struct matrix_fixed {
+	fixed_t val[2][3]; /* [row][col] */
+};
+
+static inline void
+matrix_to_fixed(const struct matrix *m, struct matrix_fixed *out)
+{
+	int row, col;
+
+	for (row = 0; row < 2; row++) {
+		for (col = 0; col < 3; col++)
+			out->val[row][col] = fixed_from_double(m->val[row][col]);
+	}
+}
+
+static inline void
+matrix_fixed_mult_vec(const struct matrix_fixed *m, int *x, int *y)
+{
+	fixed_t tx, ty;
+
+	tx = *x * m->val[0][0] + *y * m->val[0][1] + m->val[0][2];
+	ty = *x * m->val[1][0] + *y * m->val[1][1] + m->val[1][2];
+
+	/* truncate towards zero like the float conversion does */
+	*x = tx / FIXED_ONE;
+	*y = ty / FIXED_ONE;
+}
+
 enum ratelimit_state {
 	RATELIMIT_EXCEEDED,
 	RATELIMIT_THRESHOLD,
@@ -23,6 +23,7 @@
 #include "config.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,7 +34,27 @@
 #include "libinput.h"
 #include "libinput-private.h"
 #include "evdev.h"
+#include "input-thread.h"
 #include "timer.h"
+#include "usdt.h"
+#include "worker-pool.h"
+
+#ifdef HAVE_USDT_PROBES
+/* Set by the tracer while it is attached to the probe, see usdt.h */
+#define USDT_SEMAPHORE_DEFINE(name_) \
+	unsigned short USDT_SEMAPHORE(name_) \
+	__attribute__((section(".probes")))
+
+USDT_SEMAPHORE_DEFINE(dispatch_entry);
+USDT_SEMAPHORE_DEFINE(dispatch_exit);
+USDT_SEMAPHORE_DEFINE(flush_pending);
+USDT_SEMAPHORE_DEFINE(post_event);
+USDT_SEMAPHORE_DEFINE(get_event);
+USDT_SEMAPHORE_DEFINE(timer_fire);
+USDT_SEMAPHORE_DEFINE(tap_state);
+USDT_SEMAPHORE_DEFINE(button_state);
+USDT_SEMAPHORE_DEFINE(middlebutton_state);
+#endif
 
 #define require_event_type(li_, type_, retval_, ...)	\
 	if (type_ == LIBINPUT_EVENT_NONE) abort(); \
@@ -71,10 +92,16 @@ check_event_type(struct libinput *libinput,
 	return rc;
 }
 
+/* Number of event frames a source processes per dispatch round */
+#define DISPATCH_BUDGET_FRAMES 8
+
 struct libinput_source {
 	libinput_source_dispatch_t dispatch;
 	void *user_data;
 	int fd;
+	bool priority;
+	bool disabled; /* fd is not in the epoll set */
+	struct libinput_device *device; /* NULL for non-device sources */
 	struct list link;
 };
 
@@ -84,7 +111,7 @@ struct libinput_event_device_notify {
 
 struct libinput_event_keyboard {
 	struct libinput_event base;
-	uint32_t time;
+	uint64_t time;
 	uint32_t key;
 	uint32_t seat_key_count;
 	enum libinput_key_state state;
@@ -92,9 +119,13 @@ struct libinput_event_keyboard {
 
 struct libinput_event_pointer {
 	struct libinput_event base;
-	uint32_t time;
-	struct normalized_coords delta;
-	struct normalized_coords delta_unaccel;
+	uint64_t time;
+	union {
+		struct {
+			motion_coords_t accel, unaccel;
+		} motion; /* LIBINPUT_EVENT_POINTER_MOTION */
+		struct normalized_coords scroll; /* LIBINPUT_EVENT_POINTER_AXIS */
+	} delta;
 	struct device_coords absolute;
 	struct discrete_coords discrete;
 	uint32_t button;
@@ -106,12 +137,243 @@ struct libinput_event_pointer {
 
 struct libinput_event_touch {
 	struct libinput_event base;
-	uint32_t time;
+	uint64_t time;
 	int32_t slot;
 	int32_t seat_slot;
 	struct device_coords point;
 };
 
+/* Number of events allocated at once when a pool runs dry */
+#define EVENT_POOL_SLAB_EVENTS 32
+
+struct event_pool_item {
+	struct event_pool_item *next;
+};
+
+union event_pool_slab {
+	union event_pool_slab *next;
+	long double align; /* keeps the events after the header aligned */
+};
+
+static void
+event_pool_init(struct libinput *libinput)
+{
+	static const size_t event_sizes[EVENT_POOL_COUNT] = {
+		[EVENT_POOL_DEVICE_NOTIFY] =
+			sizeof(struct libinput_event_device_notify),
+		[EVENT_POOL_KEYBOARD] = sizeof(struct libinput_event_keyboard),
+		[EVENT_POOL_POINTER] = sizeof(struct libinput_event_pointer),
+		[EVENT_POOL_TOUCH] = sizeof(struct libinput_event_touch),
+	};
+	int i;
+
+	for (i = 0; i < EVENT_POOL_COUNT; i++) {
+		struct libinput_event_pool *pool = &libinput->event_pools[i];
+
+		pool->event_size = event_sizes[i];
+		pool->free_list = NULL;
+		pool->returned = NULL;
+		pool->slabs = NULL;
+		pool->hits = 0;
+		pool->misses = 0;
+	}
+}
+
+static void
+event_pool_destroy(struct libinput *libinput)
+{
+	union event_pool_slab *slab, *next;
+	int i;
+
+	for (i = 0; i < EVENT_POOL_COUNT; i++) {
+		struct libinput_event_pool *pool = &libinput->event_pools[i];
+
+		log_debug(libinput,
+			  "event pool %d: %" PRIu64 " hits, %" PRIu64 " misses\n",
+			  i,
+			  pool->hits,
+			  pool->misses);
+
+		for (slab = pool->slabs; slab; slab = next) {
+			next = slab->next;
+			libinput_free(libinput, slab);
+		}
+		pool->slabs = NULL;
+		pool->free_list = NULL;
+		pool->returned = NULL;
+	}
+}
+
+static enum libinput_event_pool_type
+event_pool_type(enum libinput_event_type type)
+{
+	switch (type) {
+	case LIBINPUT_EVENT_NONE:
+		abort();
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		return EVENT_POOL_DEVICE_NOTIFY;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return EVENT_POOL_KEYBOARD;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		return EVENT_POOL_POINTER;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		return EVENT_POOL_TOUCH;
+	}
+
+	abort();
+}
+
+static inline enum libinput_event_group
+event_type_to_group(enum libinput_event_type type)
+{
+	switch (type) {
+	case LIBINPUT_EVENT_NONE:
+		abort();
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		return LIBINPUT_EVENT_GROUP_DEVICE;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return LIBINPUT_EVENT_GROUP_KEYBOARD;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		return LIBINPUT_EVENT_GROUP_POINTER;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		return LIBINPUT_EVENT_GROUP_TOUCH;
+	}
+
+	abort();
+}
+
+static bool
+event_pool_grow(struct libinput *libinput,
+		struct libinput_event_pool *pool)
+{
+	union event_pool_slab *slab;
+	struct event_pool_item *item;
+	char *events;
+	int i;
+
+	slab = libinput_malloc(libinput,
+			       sizeof *slab +
+			       EVENT_POOL_SLAB_EVENTS * pool->event_size);
+	if (!slab)
+		return false;
+
+	slab->next = pool->slabs;
+	pool->slabs = slab;
+
+	events = (char *)(slab + 1);
+	for (i = 0; i < EVENT_POOL_SLAB_EVENTS; i++) {
+		item = (struct event_pool_item *)(events + i * pool->event_size);
+		item->next = pool->free_list;
+		pool->free_list = item;
+	}
+
+	return true;
+}
+
+/* The pools are only shared between threads while the workers process
+ * devices in parallel */
+static inline void
+event_pool_lock(struct libinput *libinput)
+{
+	if (libinput->workers)
+		libinput_workers_lock(libinput);
+}
+
+static inline void
+event_pool_unlock(struct libinput *libinput)
+{
+	if (libinput->workers)
+		libinput_workers_unlock(libinput);
+}
+
+/* Only ever written under the pool lock, but libinput_get_stats() may
+ * read it from any thread */
+static inline void
+event_pool_count(uint64_t *counter)
+{
+	__atomic_store_n(counter, *counter + 1, __ATOMIC_RELAXED);
+}
+
+static void *
+event_pool_zalloc(struct libinput *libinput,
+		  enum libinput_event_pool_type type)
+{
+	struct libinput_event_pool *pool = &libinput->event_pools[type];
+	struct event_pool_item *item = NULL;
+
+	event_pool_lock(libinput);
+
+	if (!pool->free_list)
+		pool->free_list = __atomic_exchange_n(&pool->returned,
+						      NULL,
+						      __ATOMIC_ACQUIRE);
+
+	if (pool->free_list) {
+		event_pool_count(&pool->hits);
+	} else {
+		if (!event_pool_grow(libinput, pool))
+			goto out;
+		event_pool_count(&pool->misses);
+	}
+
+	item = pool->free_list;
+	pool->free_list = item->next;
+out:
+	event_pool_unlock(libinput);
+
+	if (item)
+		memset(item, 0, pool->event_size);
+
+	return item;
+}
+
+static void
+event_pool_release(struct libinput *libinput,
+		   struct libinput_event *event)
+{
+	struct libinput_event_pool *pool;
+	struct event_pool_item *item = (struct event_pool_item *)event;
+
+	pool = &libinput->event_pools[event_pool_type(event->type)];
+
+	/* The caller destroys events on its own thread while the input
+	 * thread allocates new ones, hand them back without a lock */
+	if (libinput->thread) {
+		item->next = __atomic_load_n(&pool->returned, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&pool->returned,
+						    &item->next,
+						    item,
+						    true,
+						    __ATOMIC_RELEASE,
+						    __ATOMIC_RELAXED))
+			;
+		return;
+	}
+
+	event_pool_lock(libinput);
+	item->next = pool->free_list;
+	pool->free_list = item;
+	event_pool_unlock(libinput);
+}
+
 static void
 libinput_default_log_func(struct libinput *libinput,
 			  enum libinput_log_priority priority,
@@ -137,8 +399,11 @@ log_msg_va(struct libinput *libinput,
 	   va_list args)
 {
 	if (libinput->log_handler &&
-	    libinput->log_priority <= priority)
+	    libinput->log_priority <= priority) {
+		libinput_workers_lock(libinput);
 		libinput->log_handler(libinput, priority, format, args);
+		libinput_workers_unlock(libinput);
+	}
 }
 
 void
@@ -175,7 +440,8 @@ libinput_log_set_handler(struct libinput *libinput,
 
 static void
 libinput_post_event(struct libinput *libinput,
-		    struct libinput_event *event);
+		    struct libinput_event *event,
+		    uint64_t time);
 
 LIBINPUT_EXPORT enum libinput_event_type
 libinput_event_get_type(struct libinput_event *event)
@@ -204,7 +470,8 @@ libinput_event_get_pointer_event(struct libinput_event *event)
 			   LIBINPUT_EVENT_POINTER_MOTION,
 			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 			   LIBINPUT_EVENT_POINTER_BUTTON,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
 	return (struct libinput_event_pointer *) event;
 }
@@ -249,6 +516,17 @@ libinput_event_get_device_notify_event(struct libinput_event *event)
 
 LIBINPUT_EXPORT uint32_t
 libinput_event_keyboard_get_time(struct libinput_event_keyboard *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_KEYBOARD_KEY);
+
+	return us2ms(event->time);
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_event_keyboard_get_time_usec(struct libinput_event_keyboard *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
@@ -301,7 +579,23 @@ libinput_event_pointer_get_time(struct libinput_event_pointer *event)
 			   LIBINPUT_EVENT_POINTER_MOTION,
 			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 			   LIBINPUT_EVENT_POINTER_BUTTON,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
+
+	return us2ms(event->time);
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_event_pointer_get_time_usec(struct libinput_event_pointer *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_MOTION,
+			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+			   LIBINPUT_EVENT_POINTER_BUTTON,
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
 	return event->time;
 }
@@ -314,7 +608,7 @@ libinput_event_pointer_get_dx(struct libinput_event_pointer *event)
 			   0,
 			   LIBINPUT_EVENT_POINTER_MOTION);
 
-	return event->delta.x;
+	return motion_to_normalized(event->delta.motion.accel).x;
 }
 
 LIBINPUT_EXPORT double
@@ -325,7 +619,7 @@ libinput_event_pointer_get_dy(struct libinput_event_pointer *event)
 			   0,
 			   LIBINPUT_EVENT_POINTER_MOTION);
 
-	return event->delta.y;
+	return motion_to_normalized(event->delta.motion.accel).y;
 }
 
 LIBINPUT_EXPORT double
@@ -337,7 +631,7 @@ libinput_event_pointer_get_dx_unaccelerated(
 			   0,
 			   LIBINPUT_EVENT_POINTER_MOTION);
 
-	return event->delta_unaccel.x;
+	return motion_to_normalized(event->delta.motion.unaccel).x;
 }
 
 LIBINPUT_EXPORT double
@@ -349,7 +643,7 @@ libinput_event_pointer_get_dy_unaccelerated(
 			   0,
 			   LIBINPUT_EVENT_POINTER_MOTION);
 
-	return event->delta_unaccel.y;
+	return motion_to_normalized(event->delta.motion.unaccel).y;
 }
 
 LIBINPUT_EXPORT double
@@ -481,10 +775,10 @@ libinput_event_pointer_get_axis_value(struct libinput_event_pointer *event,
 	} else {
 		switch (axis) {
 		case LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL:
-			value = event->delta.x;
+			value = event->delta.scroll.x;
 			break;
 		case LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL:
-			value = event->delta.y;
+			value = event->delta.scroll.y;
 			break;
 		}
 	}
@@ -532,6 +826,21 @@ libinput_event_pointer_get_axis_source(struct libinput_event_pointer *event)
 
 LIBINPUT_EXPORT uint32_t
 libinput_event_touch_get_time(struct libinput_event_touch *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_UP,
+			   LIBINPUT_EVENT_TOUCH_MOTION,
+			   LIBINPUT_EVENT_TOUCH_CANCEL,
+			   LIBINPUT_EVENT_TOUCH_FRAME);
+
+	return us2ms(event->time);
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_event_touch_get_time_usec(struct libinput_event_touch *event)
 {
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
@@ -643,8 +952,22 @@ libinput_add_fd(struct libinput *libinput,
 {
 	struct libinput_source *source;
 	struct epoll_event ep;
+	struct epoll_event *ep_events;
+	size_t len;
+
+	if (libinput->sources_count == libinput->ep_events_len) {
+		len = libinput->ep_events_len * 2;
+		ep_events = libinput_realloc(libinput,
+					     libinput->ep_events,
+					     len * sizeof *ep_events);
+		if (!ep_events)
+			return NULL;
+
+		libinput->ep_events = ep_events;
+		libinput->ep_events_len = len;
+	}
 
-	source = zalloc(sizeof *source);
+	source = libinput_zalloc(libinput, sizeof *source);
 	if (!source)
 		return NULL;
 
@@ -656,11 +979,14 @@ libinput_add_fd(struct libinput *libinput,
 	ep.events = EPOLLIN;
 	ep.data.ptr = source;
 
-	if (epoll_ctl(libinput->epoll_fd, EPOLL_CTL_ADD, fd, &ep) < 0) {
-		free(source);
+	if (epoll_ctl(libinput->sources_fd, EPOLL_CTL_ADD, fd, &ep) < 0) {
+		libinput_free(libinput, source);
 		return NULL;
 	}
 
+	list_insert(&libinput->source_list, &source->link);
+	libinput->sources_count++;
+
 	return source;
 }
 
@@ -668,39 +994,169 @@ void
 libinput_remove_source(struct libinput *libinput,
 		       struct libinput_source *source)
 {
-	epoll_ctl(libinput->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
+	epoll_ctl(libinput->sources_fd, EPOLL_CTL_DEL, source->fd, NULL);
 	source->fd = -1;
+
+	libinput_workers_lock(libinput);
+	list_remove(&source->link);
 	list_insert(&libinput->source_destroy_list, &source->link);
+	libinput->sources_count--;
+	libinput_workers_unlock(libinput);
+}
+
+int
+libinput_move_sources(struct libinput *libinput, int epoll_fd)
+{
+	struct libinput_source *source;
+	struct epoll_event ep;
+
+	list_for_each(source, &libinput->source_list, link) {
+		if (source->disabled)
+			continue;
+
+		memset(&ep, 0, sizeof ep);
+		ep.events = EPOLLIN;
+		ep.data.ptr = source;
+
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, source->fd, &ep) < 0)
+			goto err;
+	}
+
+	list_for_each(source, &libinput->source_list, link) {
+		if (!source->disabled)
+			epoll_ctl(libinput->sources_fd, EPOLL_CTL_DEL,
+				  source->fd, NULL);
+	}
+
+	libinput->sources_fd = epoll_fd;
+
+	return 0;
+
+err:
+	list_for_each(source, &libinput->source_list, link)
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
+
+	return -1;
+}
+
+void
+libinput_source_set_priority(struct libinput_source *source,
+			     bool priority)
+{
+	source->priority = priority;
+}
+
+void
+libinput_source_set_enabled(struct libinput *libinput,
+			    struct libinput_source *source,
+			    bool enabled)
+{
+	struct epoll_event ep;
+
+	if (enabled == !source->disabled)
+		return;
+
+	if (!enabled) {
+		epoll_ctl(libinput->sources_fd, EPOLL_CTL_DEL, source->fd, NULL);
+		source->disabled = true;
+		return;
+	}
+
+	memset(&ep, 0, sizeof ep);
+	ep.events = EPOLLIN;
+	ep.data.ptr = source;
+
+	if (epoll_ctl(libinput->sources_fd, EPOLL_CTL_ADD, source->fd, &ep) < 0) {
+		log_error(libinput, "failed to resume polling fd %d\n",
+			  source->fd);
+		return;
+	}
+	source->disabled = false;
+}
+
+bool
+libinput_source_get_enabled(struct libinput_source *source)
+{
+	return !source->disabled;
+}
+
+void
+libinput_source_set_device(struct libinput_source *source,
+			   struct libinput_device *device)
+{
+	source->device = device;
+}
+
+struct libinput_device *
+libinput_source_get_device(struct libinput_source *source)
+{
+	return source->device;
+}
+
+bool
+libinput_source_dispatch(struct libinput_source *source,
+			 unsigned int budget)
+{
+	if (source->fd == -1)
+		return false;
+
+	return source->dispatch(source->user_data, budget);
 }
 
 int
 libinput_init(struct libinput *libinput,
+	      const struct mem_allocator *mem,
 	      const struct libinput_interface *interface,
 	      const struct libinput_interface_backend *interface_backend,
 	      void *user_data)
 {
+	libinput->mem = *mem;
+
 	libinput->epoll_fd = epoll_create1(EPOLL_CLOEXEC);;
 	if (libinput->epoll_fd < 0)
 		return -1;
+	libinput->sources_fd = libinput->epoll_fd;
 
 	libinput->events_len = 4;
-	libinput->events = zalloc(libinput->events_len * sizeof(*libinput->events));
+	libinput->events = libinput_calloc(libinput,
+					   libinput->events_len,
+					   sizeof(*libinput->events));
 	if (!libinput->events) {
 		close(libinput->epoll_fd);
 		return -1;
 	}
 
+	libinput->ep_events_len = 32;
+	libinput->ep_events = libinput_calloc(libinput,
+					      libinput->ep_events_len,
+					      sizeof(*libinput->ep_events));
+	if (!libinput->ep_events) {
+		libinput_free(libinput, libinput->events);
+		close(libinput->epoll_fd);
+		return -1;
+	}
+
+	event_pool_init(libinput);
+
 	libinput->log_handler = libinput_default_log_func;
 	libinput->log_priority = LIBINPUT_LOG_PRIORITY_ERROR;
 	libinput->interface = interface;
 	libinput->interface_backend = interface_backend;
 	libinput->user_data = user_data;
 	libinput->refcount = 1;
+	list_init(&libinput->source_list);
 	list_init(&libinput->source_destroy_list);
 	list_init(&libinput->seat_list);
+	list_init(&libinput->staged_list);
+	list_init(&libinput->pointer_frame_list);
+	libinput->event_mask = LIBINPUT_EVENT_GROUP_DEVICE |
+			       LIBINPUT_EVENT_GROUP_KEYBOARD |
+			       LIBINPUT_EVENT_GROUP_POINTER |
+			       LIBINPUT_EVENT_GROUP_TOUCH;
 
 	if (libinput_timer_subsys_init(libinput) != 0) {
-		free(libinput->events);
+		libinput_free(libinput, libinput->ep_events);
+		libinput_free(libinput, libinput->events);
 		close(libinput->epoll_fd);
 		return -1;
 	}
@@ -720,7 +1176,7 @@ libinput_drop_destroyed_sources(struct libinput *libinput)
 	struct libinput_source *source, *next;
 
 	list_for_each_safe(source, next, &libinput->source_destroy_list, link)
-		free(source);
+		libinput_free(libinput, source);
 	list_init(&libinput->source_destroy_list);
 }
 
@@ -737,6 +1193,7 @@ libinput_unref(struct libinput *libinput)
 	struct libinput_event *event;
 	struct libinput_device *device, *next_device;
 	struct libinput_seat *seat, *next_seat;
+	struct mem_allocator mem;
 
 	if (libinput == NULL)
 		return NULL;
@@ -746,6 +1203,8 @@ libinput_unref(struct libinput *libinput)
 	if (libinput->refcount > 0)
 		return libinput;
 
+	libinput_thread_stop(libinput);
+	libinput_workers_set_count(libinput, 0);
 	libinput_suspend(libinput);
 
 	libinput->interface_backend->destroy(libinput);
@@ -753,7 +1212,7 @@ libinput_unref(struct libinput *libinput)
 	while ((event = libinput_get_event(libinput)))
 	       libinput_event_destroy(event);
 
-	free(libinput->events);
+	libinput_free(libinput, libinput->events);
 
 	list_for_each_safe(seat, next_seat, &libinput->seat_list, link) {
 		list_for_each_safe(device, next_device,
@@ -766,8 +1225,13 @@ libinput_unref(struct libinput *libinput)
 
 	libinput_timer_subsys_destroy(libinput);
 	libinput_drop_destroyed_sources(libinput);
+	event_pool_destroy(libinput);
 	close(libinput->epoll_fd);
-	free(libinput);
+	libinput_free(libinput, libinput->ep_events);
+
+	/* the context itself is the last block of its allocator */
+	mem = libinput->mem;
+	mem_free(&mem, libinput);
 
 	return NULL;
 }
@@ -775,13 +1239,16 @@ libinput_unref(struct libinput *libinput)
 LIBINPUT_EXPORT void
 libinput_event_destroy(struct libinput_event *event)
 {
+	struct libinput *libinput;
+
 	if (event == NULL)
 		return;
 
-	if (event->device)
-		libinput_device_unref(event->device);
+	/* the device may go away with the unref below, the context can't */
+	libinput = libinput_event_get_context(event);
+	libinput_device_unref(event->device);
 
-	free(event);
+	event_pool_release(libinput, event);
 }
 
 int
@@ -808,8 +1275,8 @@ libinput_seat_init(struct libinput_seat *seat,
 {
 	seat->refcount = 1;
 	seat->libinput = libinput;
-	seat->physical_name = strdup(physical_name);
-	seat->logical_name = strdup(logical_name);
+	seat->physical_name = libinput_strdup(libinput, physical_name);
+	seat->logical_name = libinput_strdup(libinput, logical_name);
 	seat->destroy = destroy;
 	list_init(&seat->devices_list);
 	list_insert(&libinput->seat_list, &seat->link);
@@ -818,6 +1285,8 @@ libinput_seat_init(struct libinput_seat *seat,
 LIBINPUT_EXPORT struct libinput_seat *
 libinput_seat_ref(struct libinput_seat *seat)
 {
+	libinput_lock_scope(seat->libinput);
+
 	seat->refcount++;
 	return seat;
 }
@@ -826,14 +1295,16 @@ static void
 libinput_seat_destroy(struct libinput_seat *seat)
 {
 	list_remove(&seat->link);
-	free(seat->logical_name);
-	free(seat->physical_name);
+	libinput_free(seat->libinput, seat->logical_name);
+	libinput_free(seat->libinput, seat->physical_name);
 	seat->destroy(seat);
 }
 
 LIBINPUT_EXPORT struct libinput_seat *
 libinput_seat_unref(struct libinput_seat *seat)
 {
+	libinput_lock_scope(seat->libinput);
+
 	assert(seat->refcount > 0);
 	seat->refcount--;
 	if (seat->refcount == 0) {
@@ -883,10 +1354,12 @@ libinput_device_init(struct libinput_device *device,
 	list_init(&device->event_listeners);
 }
 
+/* Events hold a device reference and are destroyed on the caller's
+ * thread while the input thread posts new ones, the refcount is atomic */
 LIBINPUT_EXPORT struct libinput_device *
 libinput_device_ref(struct libinput_device *device)
 {
-	device->refcount++;
+	__atomic_add_fetch(&device->refcount, 1, __ATOMIC_RELAXED);
 	return device;
 }
 
@@ -894,16 +1367,28 @@ static void
 libinput_device_destroy(struct libinput_device *device)
 {
 	assert(list_empty(&device->event_listeners));
+	libinput_free(device->seat->libinput, device->staged);
 	evdev_device_destroy((struct evdev_device *) device);
 }
 
+static void
+libinput_device_destroy_locked(struct libinput_device *device)
+{
+	libinput_lock_scope(device->seat->libinput);
+
+	libinput_device_destroy(device);
+}
+
 LIBINPUT_EXPORT struct libinput_device *
 libinput_device_unref(struct libinput_device *device)
 {
-	assert(device->refcount > 0);
-	device->refcount--;
-	if (device->refcount == 0) {
-		libinput_device_destroy(device);
+	int refcount;
+
+	refcount = __atomic_sub_fetch(&device->refcount, 1, __ATOMIC_ACQ_REL);
+	assert(refcount >= 0);
+	if (refcount == 0) {
+		/* destroying it updates the seat and the context */
+		libinput_device_destroy_locked(device);
 		return NULL;
 	} else {
 		return device;
@@ -918,30 +1403,87 @@ libinput_get_fd(struct libinput *libinput)
 
 LIBINPUT_EXPORT int
 libinput_dispatch(struct libinput *libinput)
+{
+	if (libinput->events_limit &&
+	    libinput->events_policy == LIBINPUT_EVENT_QUEUE_BLOCK &&
+	    libinput->events_count >= libinput->events_limit) {
+		/* Back-pressure only stops the devices, timeouts like
+		 * tapping or debouncing must still expire on time. The
+		 * input thread runs its timers regardless */
+		if (!libinput->thread)
+			libinput_timer_dispatch(libinput);
+		return -EAGAIN;
+	}
+
+	/* The input thread did the work already, collect its events */
+	if (libinput->thread)
+		return libinput_thread_dispatch(libinput);
+
+	return libinput_dispatch_sources(libinput);
+}
+
+int
+libinput_dispatch_sources(struct libinput *libinput)
 {
 	struct libinput_source *source;
-	struct epoll_event ep[32];
-	int i, count;
+	struct epoll_event *ep = libinput->ep_events;
+	uint64_t start = libinput_monotonic_now(libinput);
+	int i, count, pending;
+
+	/* Without the timerfd the caller wakes us up in time, see
+	 * libinput_get_next_timeout() */
+	if (!libinput->timer.source)
+		libinput_timer_dispatch(libinput);
 
-	count = epoll_wait(libinput->epoll_fd, ep, ARRAY_LENGTH(ep), 0);
+	count = epoll_wait(libinput->sources_fd, ep, libinput->ep_events_len, 0);
 	if (count < 0)
 		return -errno;
 
+	/* Priority sources are drained first, so their events end up in
+	 * the queue ahead of whatever the other sources have buffered */
+	pending = 0;
 	for (i = 0; i < count; ++i) {
 		source = ep[i].data.ptr;
-		if (source->fd == -1)
+		if (!source->priority) {
+			ep[pending++] = ep[i];
 			continue;
+		}
 
-		source->dispatch(source->user_data);
+		libinput_source_dispatch(source, 0);
+	}
+	count = pending;
+
+	/* With worker threads the devices are processed in parallel,
+	 * only the other sources are left to us */
+	if (libinput->workers)
+		count = libinput_workers_dispatch(libinput, ep, count);
+
+	/* Everything else is serviced round-robin with a per-round budget
+	 * until drained, one flooding device cannot delay the others by
+	 * more than a few frames */
+	while (count > 0) {
+		pending = 0;
+		for (i = 0; i < count; ++i) {
+			source = ep[i].data.ptr;
+			if (libinput_source_dispatch(source,
+						     DISPATCH_BUDGET_FRAMES))
+				ep[pending++] = ep[i];
+		}
+		count = pending;
 	}
 
+	libinput_flush_pointer_frames(libinput);
 	libinput_drop_destroyed_sources(libinput);
 
+	libinput_stats_add(&libinput->stats.processing_time_usec,
+			   libinput_monotonic_now(libinput) - start);
+
 	return 0;
 }
 
 void
 libinput_device_add_event_listener(struct libinput_device *device,
+				   struct libinput_device *owner,
 				   struct libinput_event_listener *listener,
 				   void (*notify_func)(
 						uint64_t time,
@@ -949,15 +1491,21 @@ libinput_device_add_event_listener(struct libinput_device *device,
 						void *notify_func_data),
 				   void *notify_func_data)
 {
+	listener->device = device;
+	listener->owner = owner;
 	listener->notify_func = notify_func;
 	listener->notify_func_data = notify_func_data;
 	list_insert(&device->event_listeners, &listener->link);
+	libinput_workers_invalidate_groups(device->seat->libinput);
+	evdev_device_update_polling((struct evdev_device *) device);
 }
 
 void
 libinput_device_remove_event_listener(struct libinput_event_listener *listener)
 {
 	list_remove(&listener->link);
+	libinput_workers_invalidate_groups(listener->device->seat->libinput);
+	evdev_device_update_polling((struct evdev_device *) listener->device);
 }
 
 static uint32_t
@@ -1018,7 +1566,7 @@ post_base_event(struct libinput_device *device,
 {
 	struct libinput *libinput = device->seat->libinput;
 	init_event_base(event, device, type);
-	libinput_post_event(libinput, event);
+	libinput_post_event(libinput, event, 0);
 }
 
 static void
@@ -1034,7 +1582,13 @@ post_device_event(struct libinput_device *device,
 	list_for_each_safe(listener, tmp, &device->event_listeners, link)
 		listener->notify_func(time, event, listener->notify_func_data);
 
-	libinput_post_event(device->seat->libinput, event);
+	/* Built for the listeners only */
+	if (!(libinput_device_event_mask(device) & event_type_to_group(type))) {
+		event_pool_release(device->seat->libinput, event);
+		return;
+	}
+
+	libinput_post_event(device->seat->libinput, event, time);
 }
 
 void
@@ -1042,7 +1596,11 @@ notify_added_device(struct libinput_device *device)
 {
 	struct libinput_event_device_notify *added_device_event;
 
-	added_device_event = zalloc(sizeof *added_device_event);
+	if (!(libinput_device_event_mask(device) & LIBINPUT_EVENT_GROUP_DEVICE))
+		return;
+
+	added_device_event = event_pool_zalloc(device->seat->libinput,
+					       EVENT_POOL_DEVICE_NOTIFY);
 	if (!added_device_event)
 		return;
 
@@ -1056,7 +1614,14 @@ notify_removed_device(struct libinput_device *device)
 {
 	struct libinput_event_device_notify *removed_device_event;
 
-	removed_device_event = zalloc(sizeof *removed_device_event);
+	/* Nothing may follow the removal event */
+	pointer_notify_frame(device);
+
+	if (!(libinput_device_event_mask(device) & LIBINPUT_EVENT_GROUP_DEVICE))
+		return;
+
+	removed_device_event = event_pool_zalloc(device->seat->libinput,
+						 EVENT_POOL_DEVICE_NOTIFY);
 	if (!removed_device_event)
 		return;
 
@@ -1065,6 +1630,50 @@ notify_removed_device(struct libinput_device *device)
 			&removed_device_event->base);
 }
 
+uint32_t
+libinput_device_event_mask(struct libinput_device *device)
+{
+	if (device->event_mask_set)
+		return device->event_mask;
+
+	return device->seat->libinput->event_mask;
+}
+
+/* Listeners see all events of a device, masked or not */
+static inline bool
+device_wants_events(struct libinput_device *device,
+		    enum libinput_event_group group)
+{
+	return (libinput_device_event_mask(device) & group) ||
+	       !list_empty(&device->event_listeners);
+}
+
+bool
+libinput_device_wants_input(struct libinput_device *device)
+{
+	uint32_t mask = libinput_device_event_mask(device);
+
+	if (!list_empty(&device->event_listeners))
+		return true;
+
+	if ((mask & LIBINPUT_EVENT_GROUP_KEYBOARD) &&
+	    libinput_device_has_capability(device,
+					   LIBINPUT_DEVICE_CAP_KEYBOARD))
+		return true;
+
+	if ((mask & LIBINPUT_EVENT_GROUP_POINTER) &&
+	    libinput_device_has_capability(device,
+					   LIBINPUT_DEVICE_CAP_POINTER))
+		return true;
+
+	if ((mask & LIBINPUT_EVENT_GROUP_TOUCH) &&
+	    libinput_device_has_capability(device,
+					   LIBINPUT_DEVICE_CAP_TOUCH))
+		return true;
+
+	return false;
+}
+
 static inline bool
 device_has_cap(struct libinput_device *device,
 	       enum libinput_device_capability cap)
@@ -1106,11 +1715,19 @@ keyboard_notify_key(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_KEYBOARD))
 		return;
 
-	key_event = zalloc(sizeof *key_event);
-	if (!key_event)
+	/* The seat count follows the keys, masked or not, so the count
+	 * does not depend on which devices have listeners */
+	libinput_workers_lock(device->seat->libinput);
+	seat_key_count = update_seat_key_count(device->seat, key, state);
+	libinput_workers_unlock(device->seat->libinput);
+
+	if (!device_wants_events(device, LIBINPUT_EVENT_GROUP_KEYBOARD))
 		return;
 
-	seat_key_count = update_seat_key_count(device->seat, key, state);
+	key_event = event_pool_zalloc(device->seat->libinput,
+				      EVENT_POOL_KEYBOARD);
+	if (!key_event)
+		return;
 
 	*key_event = (struct libinput_event_keyboard) {
 		.time = time,
@@ -1124,30 +1741,55 @@ keyboard_notify_key(struct libinput_device *device,
 			  &key_event->base);
 }
 
+static inline void
+pointer_frame_mark_pending(struct libinput_device *device, uint64_t time)
+{
+	struct libinput *libinput = device->seat->libinput;
+
+	if (!libinput->pointer_frames)
+		return;
+
+	if (!device->pointer_frame_pending) {
+		libinput_workers_lock(libinput);
+		list_insert(&libinput->pointer_frame_list,
+			    &device->pointer_frame_link);
+		libinput_workers_unlock(libinput);
+	}
+
+	device->pointer_frame_pending = true;
+	device->pointer_frame_time = time;
+}
+
 void
 pointer_notify_motion(struct libinput_device *device,
 		      uint64_t time,
-		      const struct normalized_coords *delta,
-		      const struct normalized_coords *unaccel)
+		      const motion_coords_t *delta,
+		      const motion_coords_t *unaccel)
 {
 	struct libinput_event_pointer *motion_event;
 
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	motion_event = zalloc(sizeof *motion_event);
+	if (!device_wants_events(device, LIBINPUT_EVENT_GROUP_POINTER))
+		return;
+
+	motion_event = event_pool_zalloc(device->seat->libinput,
+					 EVENT_POOL_POINTER);
 	if (!motion_event)
 		return;
 
 	*motion_event = (struct libinput_event_pointer) {
 		.time = time,
-		.delta = *delta,
-		.delta_unaccel = *unaccel,
+		.delta.motion.accel = *delta,
+		.delta.motion.unaccel = *unaccel,
 	};
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_POINTER_MOTION,
 			  &motion_event->base);
+
+	pointer_frame_mark_pending(device, time);
 }
 
 void
@@ -1160,7 +1802,11 @@ pointer_notify_motion_absolute(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	motion_absolute_event = zalloc(sizeof *motion_absolute_event);
+	if (!device_wants_events(device, LIBINPUT_EVENT_GROUP_POINTER))
+		return;
+
+	motion_absolute_event = event_pool_zalloc(device->seat->libinput,
+						  EVENT_POOL_POINTER);
 	if (!motion_absolute_event)
 		return;
 
@@ -1172,6 +1818,8 @@ pointer_notify_motion_absolute(struct libinput_device *device,
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 			  &motion_absolute_event->base);
+
+	pointer_frame_mark_pending(device, time);
 }
 
 void
@@ -1186,13 +1834,19 @@ pointer_notify_button(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	button_event = zalloc(sizeof *button_event);
-	if (!button_event)
-		return;
-
+	libinput_workers_lock(device->seat->libinput);
 	seat_button_count = update_seat_button_count(device->seat,
 						     button,
 						     state);
+	libinput_workers_unlock(device->seat->libinput);
+
+	if (!device_wants_events(device, LIBINPUT_EVENT_GROUP_POINTER))
+		return;
+
+	button_event = event_pool_zalloc(device->seat->libinput,
+					 EVENT_POOL_POINTER);
+	if (!button_event)
+		return;
 
 	*button_event = (struct libinput_event_pointer) {
 		.time = time,
@@ -1204,6 +1858,8 @@ pointer_notify_button(struct libinput_device *device,
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_POINTER_BUTTON,
 			  &button_event->base);
+
+	pointer_frame_mark_pending(device, time);
 }
 
 void
@@ -1219,13 +1875,17 @@ pointer_notify_axis(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	axis_event = zalloc(sizeof *axis_event);
+	if (!device_wants_events(device, LIBINPUT_EVENT_GROUP_POINTER))
+		return;
+
+	axis_event = event_pool_zalloc(device->seat->libinput,
+				       EVENT_POOL_POINTER);
 	if (!axis_event)
 		return;
 
 	*axis_event = (struct libinput_event_pointer) {
 		.time = time,
-		.delta = *delta,
+		.delta.scroll = *delta,
 		.source = source,
 		.axes = axes,
 		.discrete = *discrete,
@@ -1234,28 +1894,84 @@ pointer_notify_axis(struct libinput_device *device,
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_POINTER_AXIS,
 			  &axis_event->base);
+
+	pointer_frame_mark_pending(device, time);
 }
 
 void
-touch_notify_touch_down(struct libinput_device *device,
-			uint64_t time,
-			int32_t slot,
-			int32_t seat_slot,
-			const struct device_coords *point)
+pointer_notify_frame(struct libinput_device *device)
 {
-	struct libinput_event_touch *touch_event;
+	struct libinput *libinput = device->seat->libinput;
+	struct libinput_event_pointer *frame_event;
 
-	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
+	if (!device->pointer_frame_pending)
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
-	if (!touch_event)
+	device->pointer_frame_pending = false;
+	libinput_workers_lock(libinput);
+	list_remove(&device->pointer_frame_link);
+	libinput_workers_unlock(libinput);
+
+	/* Frames carry nothing the event listeners could use */
+	if (!(libinput_device_event_mask(device) & LIBINPUT_EVENT_GROUP_POINTER))
 		return;
 
-	*touch_event = (struct libinput_event_touch) {
-		.time = time,
-		.slot = slot,
-		.seat_slot = seat_slot,
+	frame_event = event_pool_zalloc(device->seat->libinput,
+					EVENT_POOL_POINTER);
+	if (!frame_event)
+		return;
+
+	*frame_event = (struct libinput_event_pointer) {
+		.time = device->pointer_frame_time,
+	};
+
+	post_device_event(device, device->pointer_frame_time,
+			  LIBINPUT_EVENT_POINTER_FRAME,
+			  &frame_event->base);
+}
+
+/*
+ * Terminate the pending pointer frames. Events posted from a timer or on
+ * behalf of another device are not followed by a SYN_REPORT of the
+ * device itself.
+ */
+void
+libinput_flush_pointer_frames(struct libinput *libinput)
+{
+	struct libinput_device *device, *tmp;
+
+	libinput_workers_lock(libinput);
+	list_for_each_safe(device, tmp,
+			   &libinput->pointer_frame_list,
+			   pointer_frame_link)
+		pointer_notify_frame(device);
+	libinput_workers_unlock(libinput);
+}
+
+void
+touch_notify_touch_down(struct libinput_device *device,
+			uint64_t time,
+			int32_t slot,
+			int32_t seat_slot,
+			const struct device_coords *point)
+{
+	struct libinput_event_touch *touch_event;
+
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
+		return;
+
+	if (!device_wants_events(device, LIBINPUT_EVENT_GROUP_TOUCH))
+		return;
+
+	touch_event = event_pool_zalloc(device->seat->libinput,
+					EVENT_POOL_TOUCH);
+	if (!touch_event)
+		return;
+
+	*touch_event = (struct libinput_event_touch) {
+		.time = time,
+		.slot = slot,
+		.seat_slot = seat_slot,
 		.point = *point,
 	};
 
@@ -1276,7 +1992,11 @@ touch_notify_touch_motion(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	if (!device_wants_events(device, LIBINPUT_EVENT_GROUP_TOUCH))
+		return;
+
+	touch_event = event_pool_zalloc(device->seat->libinput,
+					EVENT_POOL_TOUCH);
 	if (!touch_event)
 		return;
 
@@ -1303,7 +2023,11 @@ touch_notify_touch_up(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	if (!device_wants_events(device, LIBINPUT_EVENT_GROUP_TOUCH))
+		return;
+
+	touch_event = event_pool_zalloc(device->seat->libinput,
+					EVENT_POOL_TOUCH);
 	if (!touch_event)
 		return;
 
@@ -1327,7 +2051,11 @@ touch_notify_frame(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	if (!device_wants_events(device, LIBINPUT_EVENT_GROUP_TOUCH))
+		return;
+
+	touch_event = event_pool_zalloc(device->seat->libinput,
+					EVENT_POOL_TOUCH);
 	if (!touch_event)
 		return;
 
@@ -1340,23 +2068,435 @@ touch_notify_frame(struct libinput_device *device,
 			  &touch_event->base);
 }
 
+static inline bool
+axis_event_is_stop(const struct libinput_event_pointer *event)
+{
+	if ((event->axes &
+	     AS_MASK(LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL)) &&
+	    event->delta.scroll.x == 0.0)
+		return true;
+
+	if ((event->axes &
+	     AS_MASK(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL)) &&
+	    event->delta.scroll.y == 0.0)
+		return true;
+
+	return false;
+}
+
+/*
+ * Merge event into the already queued event last if both are motion or
+ * scroll events from the same device. Returns true if the event was
+ * merged, in which case the caller must discard it. A pointer frame is
+ * never merged, coalescing stops at the frame boundary.
+ */
+static bool
+libinput_merge_event(struct libinput_event *last,
+		     struct libinput_event *event)
+{
+	struct libinput_event_pointer *merged, *pointer_event;
+
+	if (last->type != event->type || last->device != event->device)
+		return false;
+
+	merged = (struct libinput_event_pointer *) last;
+	pointer_event = (struct libinput_event_pointer *) event;
+
+	switch (event->type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		merged->delta.motion.accel.x +=
+			pointer_event->delta.motion.accel.x;
+		merged->delta.motion.accel.y +=
+			pointer_event->delta.motion.accel.y;
+		merged->delta.motion.unaccel.x +=
+			pointer_event->delta.motion.unaccel.x;
+		merged->delta.motion.unaccel.y +=
+			pointer_event->delta.motion.unaccel.y;
+		break;
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		/* never swallow the terminating event of a scroll
+		 * sequence, the caller relies on it */
+		if (merged->source != pointer_event->source ||
+		    axis_event_is_stop(merged) ||
+		    axis_event_is_stop(pointer_event))
+			return false;
+
+		merged->axes |= pointer_event->axes;
+		merged->delta.scroll.x += pointer_event->delta.scroll.x;
+		merged->delta.scroll.y += pointer_event->delta.scroll.y;
+		merged->discrete.x += pointer_event->discrete.x;
+		merged->discrete.y += pointer_event->discrete.y;
+		break;
+	default:
+		return false;
+	}
+
+	merged->time = pointer_event->time;
+
+	return true;
+}
+
+static inline struct libinput_event *
+libinput_queued_event(struct libinput *libinput, size_t offset)
+{
+	return libinput->events[(libinput->events_out + offset) %
+				libinput->events_len];
+}
+
+static bool
+libinput_coalesce_event(struct libinput *libinput,
+			struct libinput_event *event)
+{
+	struct libinput_event *last;
+
+	if (libinput->events_count == 0)
+		return false;
+
+	last = libinput_queued_event(libinput, libinput->events_count - 1);
+
+	return libinput_merge_event(last, event);
+}
+
+static inline bool
+event_is_motion(enum libinput_event_type type)
+{
+	switch (type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Removes the event at offset from the queue, the older events move up
+ * by one slot
+ */
+static struct libinput_event *
+libinput_remove_queued_event(struct libinput *libinput, size_t offset)
+{
+	struct libinput_event *removed;
+	size_t len = libinput->events_len;
+	size_t idx, prev;
+
+	idx = (libinput->events_out + offset) % len;
+	removed = libinput->events[idx];
+
+	while (idx != libinput->events_out) {
+		prev = (idx + len - 1) % len;
+		libinput->events[idx] = libinput->events[prev];
+		idx = prev;
+	}
+	libinput->events_out = (libinput->events_out + 1) % len;
+	libinput->events_count--;
+
+	return removed;
+}
+
+static inline bool
+event_is_pointer(struct libinput_event *event)
+{
+	return event->device &&
+	       event_type_to_group(event->type) == LIBINPUT_EVENT_GROUP_POINTER;
+}
+
+/*
+ * A pointer motion at offset is about to be dropped. If it is the only
+ * event of its pointer frame, the frame would end up empty, drop the
+ * frame as well or remember to drop it once it is queued.
+ */
+static void
+libinput_drop_motion_frame(struct libinput *libinput,
+			   struct libinput_device *device,
+			   size_t offset)
+{
+	struct libinput_event *event;
+	bool frame_start = !device->pointer_frame_read;
+	size_t i;
+
+	for (i = offset; i > 0; i--) {
+		event = libinput_queued_event(libinput, i - 1);
+		if (event->device == device && event_is_pointer(event)) {
+			frame_start =
+				event->type == LIBINPUT_EVENT_POINTER_FRAME;
+			break;
+		}
+	}
+
+	if (!frame_start)
+		return;
+
+	for (i = offset + 1; i < libinput->events_count; i++) {
+		event = libinput_queued_event(libinput, i);
+		if (event->device != device || !event_is_pointer(event))
+			continue;
+
+		if (event->type == LIBINPUT_EVENT_POINTER_FRAME) {
+			libinput_remove_queued_event(libinput, i);
+			device->dropped_events++;
+			libinput_event_destroy(event);
+		}
+		return;
+	}
+
+	device->pointer_frame_dropped = true;
+}
+
+static bool
+libinput_drop_oldest_motion(struct libinput *libinput)
+{
+	struct libinput_event *dropped;
+	size_t i;
+
+	for (i = 0; i < libinput->events_count; i++) {
+		if (event_is_motion(libinput_queued_event(libinput, i)->type))
+			break;
+	}
+
+	if (i == libinput->events_count)
+		return false;
+
+	dropped = libinput_queued_event(libinput, i);
+	if (libinput->pointer_frames && event_is_pointer(dropped))
+		libinput_drop_motion_frame(libinput, dropped->device, i);
+
+	libinput_remove_queued_event(libinput, i);
+	dropped->device->dropped_events++;
+	libinput_event_destroy(dropped);
+
+	return true;
+}
+
+/*
+ * Drops the frame of a motion dropped on a full queue before its frame
+ * was posted, see libinput_drop_motion_frame(). Returns true if the event
+ * was that frame.
+ */
+static bool
+libinput_drop_empty_frame(struct libinput_event *event)
+{
+	struct libinput_device *device = event->device;
+
+	if (!device || !device->pointer_frame_dropped ||
+	    !event_is_pointer(event))
+		return false;
+
+	device->pointer_frame_dropped = false;
+	if (event->type != LIBINPUT_EVENT_POINTER_FRAME)
+		return false;
+
+	device->dropped_events++;
+	libinput_event_destroy(event);
+
+	return true;
+}
+
+/*
+ * Called when event is about to be queued on a full queue. Returns true
+ * if the event should be queued, false if it was merged or dropped.
+ */
+static bool
+libinput_handle_queue_overflow(struct libinput *libinput,
+			       struct libinput_event *event)
+{
+	struct libinput_event *last;
+
+	switch (libinput->events_policy) {
+	case LIBINPUT_EVENT_QUEUE_BLOCK:
+		/* libinput_dispatch() stops reading until the caller
+		 * drained the queue, queue what is already processed */
+		return true;
+	case LIBINPUT_EVENT_QUEUE_COALESCE:
+		/* Only the tail, merging into an event with other events
+		 * queued after it would move it ahead of those */
+		last = libinput_queued_event(libinput,
+					     libinput->events_count - 1);
+		if (libinput_merge_event(last, event)) {
+			event->device->dropped_events++;
+			libinput_event_destroy(event);
+			return false;
+		}
+		/* fallthrough */
+	case LIBINPUT_EVENT_QUEUE_DROP_OLDEST_MOTION:
+		if (libinput_drop_oldest_motion(libinput))
+			return true;
+
+		/* Never drop anything that changes state, rather let the
+		 * queue grow past its limit */
+		if (!event_is_motion(event->type))
+			return true;
+
+		if (libinput->pointer_frames && event_is_pointer(event))
+			libinput_drop_motion_frame(libinput,
+						   event->device,
+						   libinput->events_count);
+
+		event->device->dropped_events++;
+		libinput_event_destroy(event);
+		return false;
+	}
+
+	return true;
+}
+
+static void
+libinput_enqueue_event(struct libinput *libinput,
+		       struct libinput_event *event)
+{
+	libinput_stats_add(&libinput->stats.events_posted, 1);
+	if (event->device)
+		libinput_stats_add(&event->device->stats.events_posted, 1);
+
+	if (libinput->thread)
+		libinput_thread_post_event(libinput, event);
+	else
+		libinput_queue_event(libinput, event);
+}
+
+static void
+libinput_stage_event(struct libinput *libinput,
+		     struct libinput_event *event,
+		     uint64_t time)
+{
+	struct libinput_device *device = event->device;
+	struct libinput_staged_event *staged;
+	size_t len;
+
+	/* Coupled devices share one stream, their events stay in the order
+	 * they were posted in */
+	if (device->worker_group)
+		device = device->worker_group;
+
+	/* Events without a timestamp keep their place in the stream */
+	if (time == 0 && device->staged_count > 0)
+		time = device->staged[device->staged_count - 1].time;
+
+	if (device->staged_count == device->staged_len) {
+		len = device->staged_len ? device->staged_len * 2 : 16;
+		staged = libinput_realloc(device->seat->libinput,
+					  device->staged,
+					  len * sizeof *staged);
+		if (!staged) {
+			libinput_event_destroy(event);
+			return;
+		}
+
+		device->staged = staged;
+		device->staged_len = len;
+	}
+
+	if (device->staged_count == 0) {
+		libinput_workers_lock(libinput);
+		list_insert(&libinput->staged_list, &device->staged_link);
+		libinput_workers_unlock(libinput);
+	}
+
+	staged = &device->staged[device->staged_count++];
+	staged->event = event;
+	staged->time = time;
+}
+
+void
+libinput_flush_staged_events(struct libinput *libinput)
+{
+	struct libinput_device *device, *tmp, *next;
+	struct libinput_staged_event *staged;
+
+	/* Each stream's events are in order already, merge the streams by
+	 * timestamp */
+	while (true) {
+		next = NULL;
+		list_for_each(device, &libinput->staged_list, staged_link) {
+			if (device->staged_read == device->staged_count)
+				continue;
+
+			if (!next ||
+			    device->staged[device->staged_read].time <
+			    next->staged[next->staged_read].time)
+				next = device;
+		}
+
+		if (!next)
+			break;
+
+		staged = &next->staged[next->staged_read++];
+		libinput_enqueue_event(libinput, staged->event);
+	}
+
+	list_for_each_safe(device, tmp, &libinput->staged_list, staged_link) {
+		device->staged_count = 0;
+		device->staged_read = 0;
+		list_remove(&device->staged_link);
+	}
+}
+
+static inline const char *
+event_sysname(struct libinput_event *event)
+{
+	if (!event->device)
+		return NULL;
+
+	return ((struct evdev_device *) event->device)->sysname;
+}
+
+/* time is 0 for events that do not carry a timestamp */
 static void
 libinput_post_event(struct libinput *libinput,
-		    struct libinput_event *event)
+		    struct libinput_event *event,
+		    uint64_t time)
 {
-	struct libinput_event **events = libinput->events;
-	size_t events_len = libinput->events_len;
-	size_t events_count = libinput->events_count;
+	if (usdt_probe_enabled(post_event))
+		usdt_probe(post_event, event_sysname(event), event->type, time);
+
+	if (event->device)
+		libinput_device_ref(event->device);
+
+	if (libinput->parallel_dispatch && event->device)
+		libinput_stage_event(libinput, event, time);
+	else
+		libinput_enqueue_event(libinput, event);
+}
+
+void
+libinput_queue_event(struct libinput *libinput,
+		     struct libinput_event *event)
+{
+	struct libinput_event **events;
+	size_t events_len;
+	size_t events_count;
 	size_t move_len;
 	size_t new_out;
 
+	if (libinput_drop_empty_frame(event))
+		return;
+
+	if (libinput->coalesce_events &&
+	    libinput_coalesce_event(libinput, event)) {
+		libinput_event_destroy(event);
+		return;
+	}
+
+	if (libinput->events_limit &&
+	    libinput->events_count >= libinput->events_limit &&
+	    !libinput_handle_queue_overflow(libinput, event))
+		return;
+
+	events = libinput->events;
+	events_len = libinput->events_len;
+	events_count = libinput->events_count;
+
 	events_count++;
 	if (events_count > events_len) {
 		events_len *= 2;
-		events = realloc(events, events_len * sizeof *events);
+		events = libinput_realloc(libinput,
+					  events,
+					  events_len * sizeof *events);
 		if (!events) {
 			fprintf(stderr, "Failed to reallocate event ring "
 				"buffer");
+			libinput_event_destroy(event);
 			return;
 		}
 
@@ -1376,18 +2516,100 @@ libinput_post_event(struct libinput *libinput,
 		libinput->events_len = events_len;
 	}
 
-	if (event->device)
-		libinput_device_ref(event->device);
-
 	libinput->events_count = events_count;
+	libinput_stats_max(&libinput->stats.queue_high_water, events_count);
 	events[libinput->events_in] = event;
 	libinput->events_in = (libinput->events_in + 1) % libinput->events_len;
 }
 
+/* see libinput_drop_motion_frame() */
+static inline void
+event_track_pointer_frame(struct libinput *libinput,
+			  struct libinput_event *event)
+{
+	if (!libinput->pointer_frames || !event_is_pointer(event))
+		return;
+
+	event->device->pointer_frame_read =
+		event->type != LIBINPUT_EVENT_POINTER_FRAME;
+}
+
+/* index into libinput_device.latency, -1 for events without a time */
+static int
+latency_type_index(enum libinput_event_type type)
+{
+	switch (type) {
+	case LIBINPUT_EVENT_NONE:
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		return -1;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return 0;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		return 1;
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+		return 2;
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+		return 3;
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		return 4;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+		return 5;
+	case LIBINPUT_EVENT_TOUCH_UP:
+		return 6;
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+		return 7;
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+		return 8;
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		return 9;
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		return 10;
+	}
+
+	return -1;
+}
+
+static uint64_t
+event_get_time(struct libinput_event *event)
+{
+	switch (event_type_to_group(event->type)) {
+	case LIBINPUT_EVENT_GROUP_KEYBOARD:
+		return ((struct libinput_event_keyboard *) event)->time;
+	case LIBINPUT_EVENT_GROUP_POINTER:
+		return ((struct libinput_event_pointer *) event)->time;
+	case LIBINPUT_EVENT_GROUP_TOUCH:
+		return ((struct libinput_event_touch *) event)->time;
+	default:
+		return 0;
+	}
+}
+
+static void
+event_record_latency(struct libinput_event *event, uint64_t now)
+{
+	int index = latency_type_index(event->type);
+	uint64_t time, latency = 0;
+	int bucket = 0;
+
+	if (index == -1)
+		return;
+
+	time = event_get_time(event);
+	if (now > time)
+		latency = now - time;
+	if (latency > 0)
+		bucket = min(63 - __builtin_clzll(latency),
+			     LATENCY_BUCKETS - 1);
+
+	libinput_stats_add(&event->device->latency[index][bucket], 1);
+}
+
 LIBINPUT_EXPORT struct libinput_event *
 libinput_get_event(struct libinput *libinput)
 {
 	struct libinput_event *event;
+	uint64_t now;
 
 	if (libinput->events_count == 0)
 		return NULL;
@@ -1397,9 +2619,56 @@ libinput_get_event(struct libinput *libinput)
 		(libinput->events_out + 1) % libinput->events_len;
 	libinput->events_count--;
 
+	now = libinput_now(libinput);
+	if (usdt_probe_enabled(get_event))
+		usdt_probe(get_event, event_sysname(event), event->type,
+			   event_get_time(event), now);
+	event_record_latency(event, now);
+	event_track_pointer_frame(libinput, event);
+
 	return event;
 }
 
+LIBINPUT_EXPORT size_t
+libinput_get_events(struct libinput *libinput,
+		    struct libinput_event **events,
+		    size_t max,
+		    uint32_t group_mask)
+{
+	struct libinput_event *event;
+	size_t events_out = libinput->events_out;
+	size_t count = 0;
+	uint64_t now;
+
+	max = min(max, libinput->events_count);
+	if (max == 0)
+		return 0;
+
+	now = libinput_now(libinput);
+
+	while (count < max) {
+		event = libinput->events[events_out];
+
+		if (group_mask &&
+		    (event_type_to_group(event->type) & group_mask) == 0)
+			break;
+
+		if (usdt_probe_enabled(get_event))
+			usdt_probe(get_event, event_sysname(event),
+				   event->type, event_get_time(event), now);
+		event_record_latency(event, now);
+		event_track_pointer_frame(libinput, event);
+		events[count++] = event;
+		if (++events_out == libinput->events_len)
+			events_out = 0;
+	}
+
+	libinput->events_out = events_out;
+	libinput->events_count -= count;
+
+	return count;
+}
+
 LIBINPUT_EXPORT enum libinput_event_type
 libinput_next_event_type(struct libinput *libinput)
 {
@@ -1412,6 +2681,210 @@ libinput_next_event_type(struct libinput *libinput)
 	return event->type;
 }
 
+LIBINPUT_EXPORT void
+libinput_set_event_coalescing(struct libinput *libinput,
+			      int enabled)
+{
+	libinput->coalesce_events = !!enabled;
+}
+
+LIBINPUT_EXPORT int
+libinput_get_event_coalescing(struct libinput *libinput)
+{
+	return libinput->coalesce_events;
+}
+
+LIBINPUT_EXPORT void
+libinput_set_pointer_frames(struct libinput *libinput,
+			    int enabled)
+{
+	libinput->pointer_frames = !!enabled;
+}
+
+LIBINPUT_EXPORT int
+libinput_get_pointer_frames(struct libinput *libinput)
+{
+	return libinput->pointer_frames;
+}
+
+LIBINPUT_EXPORT int
+libinput_set_event_queue_limit(struct libinput *libinput,
+			       unsigned int limit,
+			       enum libinput_event_queue_policy policy)
+{
+	switch (policy) {
+	case LIBINPUT_EVENT_QUEUE_DROP_OLDEST_MOTION:
+	case LIBINPUT_EVENT_QUEUE_COALESCE:
+	case LIBINPUT_EVENT_QUEUE_BLOCK:
+		break;
+	default:
+		return -1;
+	}
+
+	libinput->events_limit = limit;
+	libinput->events_policy = policy;
+
+	return 0;
+}
+
+static void
+libinput_stats_snapshot(struct libinput_stats *stats,
+			const struct libinput_stats *src)
+{
+	stats->evdev_events = libinput_stats_load(&src->evdev_events);
+	stats->events_posted = libinput_stats_load(&src->events_posted);
+	stats->syn_dropped = libinput_stats_load(&src->syn_dropped);
+	stats->timers_fired = libinput_stats_load(&src->timers_fired);
+	stats->queue_high_water = libinput_stats_load(&src->queue_high_water);
+	stats->processing_time_usec = libinput_stats_load(&src->processing_time_usec);
+	stats->event_pool_hits = 0;
+	stats->event_pool_misses = 0;
+}
+
+static void
+libinput_stats_copy(struct libinput_stats *dest,
+		    struct libinput_stats *stats)
+{
+	size_t size = dest->size;
+
+	if (size <= sizeof(stats->size))
+		return;
+
+	/* Callers built against an older struct get the counters they
+	 * know about */
+	stats->size = min(size, sizeof(*stats));
+	memcpy(dest, stats, stats->size);
+}
+
+LIBINPUT_EXPORT size_t
+libinput_get_allocated_bytes(struct libinput *libinput)
+{
+	return mem_live_bytes(&libinput->mem);
+}
+
+LIBINPUT_EXPORT void
+libinput_get_stats(struct libinput *libinput,
+		   struct libinput_stats *stats)
+{
+	struct libinput_stats counters;
+	int i;
+
+	libinput_stats_snapshot(&counters, &libinput->stats);
+
+	/* The pools keep their own counters, see event_pool_count() */
+	for (i = 0; i < EVENT_POOL_COUNT; i++) {
+		counters.event_pool_hits +=
+			libinput_stats_load(&libinput->event_pools[i].hits);
+		counters.event_pool_misses +=
+			libinput_stats_load(&libinput->event_pools[i].misses);
+	}
+
+	libinput_stats_copy(stats, &counters);
+}
+
+LIBINPUT_EXPORT void
+libinput_set_event_mask(struct libinput *libinput,
+			uint32_t group_mask)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+
+	libinput_lock_scope(libinput);
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			if (!device->event_mask_set)
+				evdev_device_read_unpolled(
+					(struct evdev_device *) device);
+		}
+	}
+
+	libinput->event_mask = group_mask;
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link)
+			evdev_device_update_polling(
+					(struct evdev_device *) device);
+	}
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_get_event_mask(struct libinput *libinput)
+{
+	return libinput->event_mask;
+}
+
+LIBINPUT_EXPORT int
+libinput_set_internal_timer_enabled(struct libinput *libinput,
+				    int enabled)
+{
+	libinput_lock_scope(libinput);
+
+	return libinput_timer_set_fd_enabled(libinput, !!enabled);
+}
+
+LIBINPUT_EXPORT void
+libinput_set_clock(struct libinput *libinput,
+		   libinput_clock_func clock,
+		   void *user_data)
+{
+	libinput_lock_scope(libinput);
+
+	/* a timerfd only knows the real clock */
+	if (clock)
+		libinput_timer_set_fd_enabled(libinput, false);
+
+	libinput->clock.func = clock;
+	libinput->clock.user_data = user_data;
+}
+
+LIBINPUT_EXPORT int
+libinput_get_internal_timer_enabled(struct libinput *libinput)
+{
+	return libinput->timer.source != NULL;
+}
+
+LIBINPUT_EXPORT int
+libinput_set_input_thread_enabled(struct libinput *libinput,
+				  int enabled)
+{
+	if (!enabled) {
+		libinput_thread_stop(libinput);
+		return 0;
+	}
+
+	return libinput_thread_start(libinput);
+}
+
+LIBINPUT_EXPORT int
+libinput_get_input_thread_enabled(struct libinput *libinput)
+{
+	return libinput->thread != NULL;
+}
+
+LIBINPUT_EXPORT int
+libinput_set_worker_threads(struct libinput *libinput,
+			    unsigned int count)
+{
+	libinput_lock_scope(libinput);
+
+	return libinput_workers_set_count(libinput, count);
+}
+
+LIBINPUT_EXPORT unsigned int
+libinput_get_worker_threads(struct libinput *libinput)
+{
+	return libinput_workers_get_count(libinput);
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_get_next_timeout(struct libinput *libinput)
+{
+	libinput_lock_scope(libinput);
+
+	return libinput_timer_next_expiry(libinput);
+}
+
 LIBINPUT_EXPORT void
 libinput_set_user_data(struct libinput *libinput,
 		       void *user_data)
@@ -1428,12 +2901,16 @@ libinput_get_user_data(struct libinput *libinput)
 LIBINPUT_EXPORT int
 libinput_resume(struct libinput *libinput)
 {
+	libinput_lock_scope(libinput);
+
 	return libinput->interface_backend->resume(libinput);
 }
 
 LIBINPUT_EXPORT void
 libinput_suspend(struct libinput *libinput)
 {
+	libinput_lock_scope(libinput);
+
 	libinput->interface_backend->suspend(libinput);
 }
 
@@ -1491,6 +2968,97 @@ libinput_device_get_output_name(struct libinput_device *device)
 	return evdev_device_get_output((struct evdev_device *) device);
 }
 
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_dropped_event_count(struct libinput_device *device)
+{
+	return device->dropped_events;
+}
+
+LIBINPUT_EXPORT void
+libinput_device_get_stats(struct libinput_device *device,
+			  struct libinput_stats *stats)
+{
+	struct libinput_stats counters;
+
+	libinput_stats_snapshot(&counters, &device->stats);
+	libinput_stats_copy(stats, &counters);
+}
+
+LIBINPUT_EXPORT size_t
+libinput_device_get_latency_histogram(struct libinput_device *device,
+				      enum libinput_event_type type,
+				      uint64_t *buckets,
+				      size_t nbuckets)
+{
+	int index = latency_type_index(type);
+	size_t i;
+
+	if (index == -1)
+		return 0;
+
+	nbuckets = min(nbuckets, LATENCY_BUCKETS);
+	for (i = 0; i < nbuckets; i++)
+		buckets[i] = libinput_stats_load(&device->latency[index][i]);
+
+	return nbuckets;
+}
+
+LIBINPUT_EXPORT void
+libinput_device_reset_latency_histograms(struct libinput_device *device)
+{
+	size_t i, j;
+
+	for (i = 0; i < LATENCY_EVENT_TYPES; i++) {
+		for (j = 0; j < LATENCY_BUCKETS; j++)
+			__atomic_store_n(&device->latency[i][j], 0,
+					 __ATOMIC_RELAXED);
+	}
+}
+
+LIBINPUT_EXPORT int
+libinput_device_dump_state_trace(struct libinput_device *device, int fd)
+{
+	struct evdev_device *evdev = (struct evdev_device *) device;
+
+	libinput_lock_scope(device->seat->libinput);
+
+	return state_trace_dump(&evdev->state_trace,
+				&device->seat->libinput->mem,
+				fd);
+}
+
+LIBINPUT_EXPORT void
+libinput_device_set_event_mask(struct libinput_device *device,
+			       uint32_t group_mask)
+{
+	struct evdev_device *evdev = (struct evdev_device *) device;
+
+	libinput_lock_scope(device->seat->libinput);
+
+	evdev_device_read_unpolled(evdev);
+	device->event_mask = group_mask;
+	device->event_mask_set = true;
+	evdev_device_update_polling(evdev);
+}
+
+LIBINPUT_EXPORT void
+libinput_device_reset_event_mask(struct libinput_device *device)
+{
+	struct evdev_device *evdev = (struct evdev_device *) device;
+
+	libinput_lock_scope(device->seat->libinput);
+
+	evdev_device_read_unpolled(evdev);
+	device->event_mask_set = false;
+	evdev_device_update_polling(evdev);
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_device_get_event_mask(struct libinput_device *device)
+{
+	return libinput_device_event_mask(device);
+}
+
 LIBINPUT_EXPORT struct libinput_seat *
 libinput_device_get_seat(struct libinput_device *device)
 {
@@ -1502,6 +3070,7 @@ libinput_device_set_seat_logical_name(struct libinput_device *device,
 				      const char *name)
 {
 	struct libinput *libinput = device->seat->libinput;
+	libinput_lock_scope(libinput);
 
 	if (name == NULL)
 		return -1;
@@ -1520,6 +3089,8 @@ LIBINPUT_EXPORT void
 libinput_device_led_update(struct libinput_device *device,
 			   enum libinput_led leds)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	evdev_device_led_update((struct evdev_device *) device, leds);
 }
 
@@ -1585,7 +3156,8 @@ libinput_event_pointer_get_base_event(struct libinput_event_pointer *event)
 			   LIBINPUT_EVENT_POINTER_MOTION,
 			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 			   LIBINPUT_EVENT_POINTER_BUTTON,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
 	return &event->base;
 }
@@ -1613,19 +3185,21 @@ libinput_device_group_ref(struct libinput_device_group *group)
 }
 
 struct libinput_device_group *
-libinput_device_group_create(const char *identifier)
+libinput_device_group_create(struct libinput *libinput,
+			     const char *identifier)
 {
 	struct libinput_device_group *group;
 
-	group = zalloc(sizeof *group);
+	group = libinput_zalloc(libinput, sizeof *group);
 	if (!group)
 		return NULL;
 
+	group->libinput = libinput;
 	group->refcount = 1;
 	if (identifier) {
-		group->identifier = strdup(identifier);
+		group->identifier = libinput_strdup(libinput, identifier);
 		if (!group->identifier) {
-			free(group);
+			libinput_free(libinput, group);
 			group = NULL;
 		}
 	}
@@ -1644,8 +3218,8 @@ libinput_device_set_device_group(struct libinput_device *device,
 static void
 libinput_device_group_destroy(struct libinput_device_group *group)
 {
-	free(group->identifier);
-	free(group);
+	libinput_free(group->libinput, group->identifier);
+	libinput_free(group->libinput, group);
 }
 
 LIBINPUT_EXPORT struct libinput_device_group *
@@ -1697,6 +3271,8 @@ libinput_config_status_to_str(enum libinput_config_status status)
 LIBINPUT_EXPORT int
 libinput_device_config_tap_get_finger_count(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	return device->config.tap ? device->config.tap->count(device) : 0;
 }
 
@@ -1704,6 +3280,8 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_tap_set_enabled(struct libinput_device *device,
 				       enum libinput_config_tap_state enable)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (enable != LIBINPUT_CONFIG_TAP_ENABLED &&
 	    enable != LIBINPUT_CONFIG_TAP_DISABLED)
 		return LIBINPUT_CONFIG_STATUS_INVALID;
@@ -1719,6 +3297,8 @@ libinput_device_config_tap_set_enabled(struct libinput_device *device,
 LIBINPUT_EXPORT enum libinput_config_tap_state
 libinput_device_config_tap_get_enabled(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (libinput_device_config_tap_get_finger_count(device) == 0)
 		return LIBINPUT_CONFIG_TAP_DISABLED;
 
@@ -1728,6 +3308,8 @@ libinput_device_config_tap_get_enabled(struct libinput_device *device)
 LIBINPUT_EXPORT enum libinput_config_tap_state
 libinput_device_config_tap_get_default_enabled(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (libinput_device_config_tap_get_finger_count(device) == 0)
 		return LIBINPUT_CONFIG_TAP_DISABLED;
 
@@ -1737,6 +3319,8 @@ libinput_device_config_tap_get_default_enabled(struct libinput_device *device)
 LIBINPUT_EXPORT int
 libinput_device_config_calibration_has_matrix(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	return device->config.calibration ?
 		device->config.calibration->has_matrix(device) : 0;
 }
@@ -1745,6 +3329,8 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_calibration_set_matrix(struct libinput_device *device,
 					      const float matrix[6])
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!libinput_device_config_calibration_has_matrix(device))
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
 
@@ -1755,6 +3341,8 @@ LIBINPUT_EXPORT int
 libinput_device_config_calibration_get_matrix(struct libinput_device *device,
 					      float matrix[6])
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!libinput_device_config_calibration_has_matrix(device))
 		return 0;
 
@@ -1765,6 +3353,8 @@ LIBINPUT_EXPORT int
 libinput_device_config_calibration_get_default_matrix(struct libinput_device *device,
 						      float matrix[6])
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!libinput_device_config_calibration_has_matrix(device))
 		return 0;
 
@@ -1775,6 +3365,7 @@ LIBINPUT_EXPORT uint32_t
 libinput_device_config_send_events_get_modes(struct libinput_device *device)
 {
 	uint32_t modes = LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
+	libinput_lock_scope(device->seat->libinput);
 
 	if (device->config.sendevents)
 		modes |= device->config.sendevents->get_modes(device);
@@ -1786,6 +3377,8 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_send_events_set_mode(struct libinput_device *device,
 					    uint32_t mode)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if ((libinput_device_config_send_events_get_modes(device) & mode) != mode)
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
 
@@ -1798,6 +3391,8 @@ libinput_device_config_send_events_set_mode(struct libinput_device *device,
 LIBINPUT_EXPORT uint32_t
 libinput_device_config_send_events_get_mode(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (device->config.sendevents)
 		return device->config.sendevents->get_mode(device);
 	else
@@ -1807,12 +3402,16 @@ libinput_device_config_send_events_get_mode(struct libinput_device *device)
 LIBINPUT_EXPORT uint32_t
 libinput_device_config_send_events_get_default_mode(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	return LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
 }
 
 LIBINPUT_EXPORT int
 libinput_device_config_accel_is_available(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	return device->config.accel ?
 		device->config.accel->available(device) : 0;
 }
@@ -1821,6 +3420,8 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_accel_set_speed(struct libinput_device *device,
 				       double speed)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	/* Need the negation in case speed is NaN */
 	if (!(speed >= -1.0 && speed <= 1.0))
 		return LIBINPUT_CONFIG_STATUS_INVALID;
@@ -1834,6 +3435,8 @@ libinput_device_config_accel_set_speed(struct libinput_device *device,
 LIBINPUT_EXPORT double
 libinput_device_config_accel_get_speed(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!libinput_device_config_accel_is_available(device))
 		return 0;
 
@@ -1843,6 +3446,8 @@ libinput_device_config_accel_get_speed(struct libinput_device *device)
 LIBINPUT_EXPORT double
 libinput_device_config_accel_get_default_speed(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!libinput_device_config_accel_is_available(device))
 		return 0;
 
@@ -1852,6 +3457,8 @@ libinput_device_config_accel_get_default_speed(struct libinput_device *device)
 LIBINPUT_EXPORT int
 libinput_device_config_scroll_has_natural_scroll(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!device->config.natural_scroll)
 		return 0;
 
@@ -1862,6 +3469,8 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_scroll_set_natural_scroll_enabled(struct libinput_device *device,
 							 int enabled)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!libinput_device_config_scroll_has_natural_scroll(device))
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
 
@@ -1871,6 +3480,8 @@ libinput_device_config_scroll_set_natural_scroll_enabled(struct libinput_device
 LIBINPUT_EXPORT int
 libinput_device_config_scroll_get_natural_scroll_enabled(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!device->config.natural_scroll)
 		return 0;
 
@@ -1880,6 +3491,8 @@ libinput_device_config_scroll_get_natural_scroll_enabled(struct libinput_device
 LIBINPUT_EXPORT int
 libinput_device_config_scroll_get_default_natural_scroll_enabled(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!device->config.natural_scroll)
 		return 0;
 
@@ -1889,6 +3502,8 @@ libinput_device_config_scroll_get_default_natural_scroll_enabled(struct libinput
 LIBINPUT_EXPORT int
 libinput_device_config_left_handed_is_available(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!device->config.left_handed)
 		return 0;
 
@@ -1899,6 +3514,8 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_left_handed_set(struct libinput_device *device,
 				       int left_handed)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!libinput_device_config_left_handed_is_available(device))
 		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
 
@@ -1908,6 +3525,8 @@ libinput_device_config_left_handed_set(struct libinput_device *device,
 LIBINPUT_EXPORT int
 libinput_device_config_left_handed_get(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!libinput_device_config_left_handed_is_available(device))
 		return 0;
 
@@ -1917,6 +3536,8 @@ libinput_device_config_left_handed_get(struct libinput_device *device)
 LIBINPUT_EXPORT int
 libinput_device_config_left_handed_get_default(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!libinput_device_config_left_handed_is_available(device))
 		return 0;
 
@@ -1926,6 +3547,8 @@ libinput_device_config_left_handed_get_default(struct libinput_device *device)
 LIBINPUT_EXPORT uint32_t
 libinput_device_config_click_get_methods(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (device->config.click_method)
 		return device->config.click_method->get_methods(device);
 	else
@@ -1936,6 +3559,8 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_click_set_method(struct libinput_device *device,
 					enum libinput_config_click_method method)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	/* Check method is a single valid method */
 	switch (method) {
 	case LIBINPUT_CONFIG_CLICK_METHOD_NONE:
@@ -1958,6 +3583,8 @@ libinput_device_config_click_set_method(struct libinput_device *device,
 LIBINPUT_EXPORT enum libinput_config_click_method
 libinput_device_config_click_get_method(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (device->config.click_method)
 		return device->config.click_method->get_method(device);
 	else
@@ -1967,6 +3594,8 @@ libinput_device_config_click_get_method(struct libinput_device *device)
 LIBINPUT_EXPORT enum libinput_config_click_method
 libinput_device_config_click_get_default_method(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (device->config.click_method)
 		return device->config.click_method->get_default_method(device);
 	else
@@ -1977,6 +3606,8 @@ LIBINPUT_EXPORT int
 libinput_device_config_middle_emulation_is_available(
 		struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (device->config.middle_emulation)
 		return device->config.middle_emulation->available(device);
 	else
@@ -1988,8 +3619,10 @@ libinput_device_config_middle_emulation_set_enabled(
 		struct libinput_device *device,
 		enum libinput_config_middle_emulation_state enable)
 {
-	int available =
-		libinput_device_config_middle_emulation_is_available(device);
+	int available;
+	libinput_lock_scope(device->seat->libinput);
+
+	available = libinput_device_config_middle_emulation_is_available(device);
 
 	switch (enable) {
 	case LIBINPUT_CONFIG_MIDDLE_EMULATION_DISABLED:
@@ -2011,6 +3644,8 @@ LIBINPUT_EXPORT enum libinput_config_middle_emulation_state
 libinput_device_config_middle_emulation_get_enabled(
 		struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!libinput_device_config_middle_emulation_is_available(device))
 		return LIBINPUT_CONFIG_MIDDLE_EMULATION_DISABLED;
 
@@ -2021,6 +3656,8 @@ LIBINPUT_EXPORT enum libinput_config_middle_emulation_state
 libinput_device_config_middle_emulation_get_default_enabled(
 		struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (!libinput_device_config_middle_emulation_is_available(device))
 		return LIBINPUT_CONFIG_MIDDLE_EMULATION_DISABLED;
 
@@ -2030,6 +3667,8 @@ libinput_device_config_middle_emulation_get_default_enabled(
 LIBINPUT_EXPORT uint32_t
 libinput_device_config_scroll_get_methods(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (device->config.scroll_method)
 		return device->config.scroll_method->get_methods(device);
 	else
@@ -2040,6 +3679,8 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_scroll_set_method(struct libinput_device *device,
 					 enum libinput_config_scroll_method method)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	/* Check method is a single valid method */
 	switch (method) {
 	case LIBINPUT_CONFIG_SCROLL_NO_SCROLL:
@@ -2063,6 +3704,8 @@ libinput_device_config_scroll_set_method(struct libinput_device *device,
 LIBINPUT_EXPORT enum libinput_config_scroll_method
 libinput_device_config_scroll_get_method(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (device->config.scroll_method)
 		return device->config.scroll_method->get_method(device);
 	else
@@ -2072,6 +3715,8 @@ libinput_device_config_scroll_get_method(struct libinput_device *device)
 LIBINPUT_EXPORT enum libinput_config_scroll_method
 libinput_device_config_scroll_get_default_method(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (device->config.scroll_method)
 		return device->config.scroll_method->get_default_method(device);
 	else
@@ -2082,6 +3727,8 @@ LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_scroll_set_button(struct libinput_device *device,
 					 uint32_t button)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if (button && !libinput_device_pointer_has_button(device, button))
 		return LIBINPUT_CONFIG_STATUS_INVALID;
 
@@ -2095,6 +3742,8 @@ libinput_device_config_scroll_set_button(struct libinput_device *device,
 LIBINPUT_EXPORT uint32_t
 libinput_device_config_scroll_get_button(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if ((libinput_device_config_scroll_get_methods(device) &
 	     LIBINPUT_CONFIG_SCROLL_ON_BUTTON_DOWN) == 0)
 		return 0;
@@ -2105,6 +3754,8 @@ libinput_device_config_scroll_get_button(struct libinput_device *device)
 LIBINPUT_EXPORT uint32_t
 libinput_device_config_scroll_get_default_button(struct libinput_device *device)
 {
+	libinput_lock_scope(device->seat->libinput);
+
 	if ((libinput_device_config_scroll_get_methods(device) &
 	     LIBINPUT_CONFIG_SCROLL_ON_BUTTON_DOWN) == 0)
 		return 0;
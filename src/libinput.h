@@ -163,6 +163,13 @@ enum libinput_event_type {
 	LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 	LIBINPUT_EVENT_POINTER_BUTTON,
 	LIBINPUT_EVENT_POINTER_AXIS,
+	/**
+	 * Signals the end of a set of pointer events that were caused by
+	 * the same hardware report. This event has no information
+	 * attached other than the time of the most recent event in the
+	 * set. Only sent if enabled with libinput_set_pointer_frames().
+	 */
+	LIBINPUT_EVENT_POINTER_FRAME,
 
 	LIBINPUT_EVENT_TOUCH_DOWN = 500,
 	LIBINPUT_EVENT_TOUCH_UP,
@@ -175,6 +182,103 @@ enum libinput_event_type {
 	LIBINPUT_EVENT_TOUCH_FRAME
 };
 
+/**
+ * @ingroup base
+ *
+ * Groups of event types, used to select events by type in bulk. A
+ * bitmask of these values is accepted by libinput_get_events().
+ */
+enum libinput_event_group {
+	/**
+	 * @ref LIBINPUT_EVENT_DEVICE_ADDED and @ref
+	 * LIBINPUT_EVENT_DEVICE_REMOVED.
+	 */
+	LIBINPUT_EVENT_GROUP_DEVICE = (1 << 0),
+	/**
+	 * Events of type @ref libinput_event_keyboard.
+	 */
+	LIBINPUT_EVENT_GROUP_KEYBOARD = (1 << 1),
+	/**
+	 * Events of type @ref libinput_event_pointer.
+	 */
+	LIBINPUT_EVENT_GROUP_POINTER = (1 << 2),
+	/**
+	 * Events of type @ref libinput_event_touch.
+	 */
+	LIBINPUT_EVENT_GROUP_TOUCH = (1 << 3),
+};
+
+/**
+ * @ingroup base
+ *
+ * The behavior of the event queue once it reaches the limit set with
+ * libinput_set_event_queue_limit().
+ */
+enum libinput_event_queue_policy {
+	/**
+	 * Discard the oldest queued motion event (@ref
+	 * LIBINPUT_EVENT_POINTER_MOTION, @ref
+	 * LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE or @ref
+	 * LIBINPUT_EVENT_TOUCH_MOTION) to make room for the new event.
+	 */
+	LIBINPUT_EVENT_QUEUE_DROP_OLDEST_MOTION = 1,
+	/**
+	 * Merge the new event into the most recent queued event if that
+	 * is from the same device, see libinput_set_event_coalescing() for
+	 * the rules. Otherwise, behave like @ref
+	 * LIBINPUT_EVENT_QUEUE_DROP_OLDEST_MOTION.
+	 */
+	LIBINPUT_EVENT_QUEUE_COALESCE,
+	/**
+	 * Do not discard events, instead stop reading from the devices
+	 * until the caller has retrieved enough events. libinput_dispatch()
+	 * returns -EAGAIN while the queue is full. Internal timeouts, e.g.
+	 * for tapping, still expire and may queue events past the limit.
+	 */
+	LIBINPUT_EVENT_QUEUE_BLOCK,
+};
+
+/**
+ * @ingroup base
+ *
+ * Performance counters of a context or a device, see libinput_get_stats()
+ * and libinput_device_get_stats(). All counters start at zero and only
+ * ever increase.
+ *
+ * New counters are only ever appended. The caller sets size to the size
+ * of the struct it was compiled against, libinput fills in the counters
+ * that fit.
+ */
+struct libinput_stats {
+	/** Set by the caller to sizeof(struct libinput_stats) */
+	size_t size;
+	/** Number of kernel input events read */
+	uint64_t evdev_events;
+	/** Number of libinput events added to the event queue */
+	uint64_t events_posted;
+	/** Number of times the kernel reported lost events (SYN_DROPPED) */
+	uint64_t syn_dropped;
+	/** Number of timers that expired. Always 0 for a device */
+	uint64_t timers_fired;
+	/**
+	 * The highest number of events held in the event queue at once.
+	 * Always 0 for a device
+	 */
+	uint64_t queue_high_water;
+	/** Time spent processing input, in microseconds */
+	uint64_t processing_time_usec;
+	/**
+	 * Number of events allocated from libinput's event pools without
+	 * allocating memory. Always 0 for a device
+	 */
+	uint64_t event_pool_hits;
+	/**
+	 * Number of event allocations that had to grow an event pool.
+	 * Always 0 for a device
+	 */
+	uint64_t event_pool_misses;
+};
+
 /**
  * @ingroup base
  * @struct libinput
@@ -388,11 +492,23 @@ libinput_event_device_notify_get_base_event(struct libinput_event_device_notify
 /**
  * @ingroup event_keyboard
  *
- * @return The event time for this event
+ * @return The event time for this event in milliseconds
+ *
+ * @see libinput_event_keyboard_get_time_usec
  */
 uint32_t
 libinput_event_keyboard_get_time(struct libinput_event_keyboard *event);
 
+/**
+ * @ingroup event_keyboard
+ *
+ * @return The event time for this event in microseconds
+ *
+ * @see libinput_event_keyboard_get_time
+ */
+uint64_t
+libinput_event_keyboard_get_time_usec(struct libinput_event_keyboard *event);
+
 /**
  * @ingroup event_keyboard
  *
@@ -443,11 +559,23 @@ libinput_event_keyboard_get_seat_key_count(
 /**
  * @ingroup event_pointer
  *
- * @return The event time for this event
+ * @return The event time for this event in milliseconds
+ *
+ * @see libinput_event_pointer_get_time_usec
  */
 uint32_t
 libinput_event_pointer_get_time(struct libinput_event_pointer *event);
 
+/**
+ * @ingroup event_pointer
+ *
+ * @return The event time for this event in microseconds
+ *
+ * @see libinput_event_pointer_get_time
+ */
+uint64_t
+libinput_event_pointer_get_time_usec(struct libinput_event_pointer *event);
+
 /**
  * @ingroup event_pointer
  *
@@ -783,11 +911,23 @@ libinput_event_pointer_get_base_event(struct libinput_event_pointer *event);
 /**
  * @ingroup event_touch
  *
- * @return The event time for this event
+ * @return The event time for this event in milliseconds
+ *
+ * @see libinput_event_touch_get_time_usec
  */
 uint32_t
 libinput_event_touch_get_time(struct libinput_event_touch *event);
 
+/**
+ * @ingroup event_touch
+ *
+ * @return The event time for this event in microseconds
+ *
+ * @see libinput_event_touch_get_time
+ */
+uint64_t
+libinput_event_touch_get_time_usec(struct libinput_event_touch *event);
+
 /**
  * @ingroup event_touch
  *
@@ -956,6 +1096,32 @@ struct libinput_interface {
 	void (*close_restricted)(int fd, void *user_data);
 };
 
+/**
+ * @ingroup base
+ * @struct libinput_allocator
+ *
+ * Memory allocation hooks for a libinput context. All memory libinput
+ * allocates itself for the context, its seats, devices and events is
+ * obtained through these hooks. Memory allocated internally by libudev,
+ * libevdev and mtdev is not.
+ *
+ * The hooks have the semantics of malloc(3), realloc(3) and free(3). If
+ * worker threads or the input thread are enabled, they may be called
+ * from threads other than the caller's and must be thread-safe. A hook
+ * may fail an allocation by returning NULL, e.g. to cap the memory used
+ * by a context, see libinput_get_allocated_bytes().
+ *
+ * @see libinput_udev_create_context_with_allocator
+ * @see libinput_path_create_context_with_allocator
+ */
+struct libinput_allocator {
+	void *(*malloc_func)(size_t size, void *user_data);
+	void *(*realloc_func)(void *ptr, size_t size, void *user_data);
+	void (*free_func)(void *ptr, void *user_data);
+	/** Passed to the hooks as-is */
+	void *user_data;
+};
+
 /**
  * @ingroup base
  *
@@ -974,6 +1140,28 @@ libinput_udev_create_context(const struct libinput_interface *interface,
 			     void *user_data,
 			     struct udev *udev);
 
+/**
+ * @ingroup base
+ *
+ * Create a new libinput context from udev that allocates its memory with
+ * the given hooks, otherwise identical to libinput_udev_create_context().
+ *
+ * @param interface The callback interface
+ * @param user_data Caller-specific data passed to the various callback
+ * interfaces.
+ * @param udev An already initialized udev context
+ * @param allocator The allocation hooks, copied by libinput. If NULL,
+ * the libc allocator is used.
+ *
+ * @return An initialized, but inactive libinput context or NULL on error
+ */
+struct libinput *
+libinput_udev_create_context_with_allocator(
+				const struct libinput_interface *interface,
+				void *user_data,
+				struct udev *udev,
+				const struct libinput_allocator *allocator);
+
 /**
  * @ingroup base
  *
@@ -1022,6 +1210,27 @@ struct libinput *
 libinput_path_create_context(const struct libinput_interface *interface,
 			     void *user_data);
 
+/**
+ * @ingroup base
+ *
+ * Create a new path-based libinput context that allocates its memory
+ * with the given hooks, otherwise identical to
+ * libinput_path_create_context().
+ *
+ * @param interface The callback interface
+ * @param user_data Caller-specific data passed to the various callback
+ * interfaces.
+ * @param allocator The allocation hooks, copied by libinput. If NULL,
+ * the libc allocator is used.
+ *
+ * @return An initialized, empty libinput context.
+ */
+struct libinput *
+libinput_path_create_context_with_allocator(
+				const struct libinput_interface *interface,
+				void *user_data,
+				const struct libinput_allocator *allocator);
+
 /**
  * @ingroup base
  *
@@ -1067,6 +1276,149 @@ libinput_path_add_device(struct libinput *libinput,
 void
 libinput_path_remove_device(struct libinput_device *device);
 
+struct libevdev;
+struct input_event;
+
+/**
+ * @ingroup base
+ *
+ * Create a new libinput context for virtual devices that have neither a
+ * device node nor a udev device. Devices are added from a description
+ * with libinput_replay_add_device() and the caller supplies their input
+ * events with libinput_replay_device_push_events() or
+ * libinput_replay_device_push_fd(). No access to /dev/input, uinput or
+ * udev is required, which makes this context suitable for load tests
+ * and benchmarks of the event processing.
+ *
+ * The context's clock follows the timestamps of the events pushed, any
+ * timer that expires between two events fires at its deadline before the
+ * second event is processed, see libinput_replay_set_time(). The
+ * internal timer is disabled. A clock set with libinput_set_clock()
+ * replaces the replay clock.
+ *
+ * The reference count of the context is initialized to 1. See @ref
+ * libinput_unref.
+ *
+ * @param user_data Caller-specific data, see libinput_get_user_data()
+ * @param allocator The allocation hooks, copied by libinput. If NULL,
+ * the libc allocator is used.
+ *
+ * @return An initialized, empty libinput context or NULL on error
+ */
+struct libinput *
+libinput_replay_create_context(void *user_data,
+			       const struct libinput_allocator *allocator);
+
+/**
+ * @ingroup base
+ *
+ * Add a virtual device to a libinput context initialized with
+ * libinput_replay_create_context(). The device's capabilities and
+ * absinfo are taken from the libevdev context, which is typically
+ * created with libevdev_new() and set up with libevdev_enable_event_code()
+ * and friends. The udev properties that would otherwise be assigned by
+ * udev and the hwdb, e.g. ID_INPUT=1 and ID_INPUT_TOUCHPAD=1, are
+ * supplied as a NULL-terminated list of KEY=value strings.
+ *
+ * The device is added to the "seat0" physical seat and the "default"
+ * logical seat, the @ref LIBINPUT_EVENT_DEVICE_ADDED event is
+ * generated immediately. Devices with multitouch axes but without
+ * ABS_MT_SLOT are not supported.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param evdev The device description. On success, libinput takes
+ * ownership of the libevdev context, on failure it remains with the
+ * caller.
+ * @param udev_properties A NULL-terminated list of KEY=value udev
+ * properties, copied by libinput. May be NULL.
+ *
+ * @return The newly initiated device on success, or NULL on failure.
+ *
+ * @note It is an application bug to call this function on a libinput
+ * context not initialized with libinput_replay_create_context().
+ */
+struct libinput_device *
+libinput_replay_add_device(struct libinput *libinput,
+			   struct libevdev *evdev,
+			   const char *const *udev_properties);
+
+/**
+ * @ingroup base
+ *
+ * Remove a device from a libinput context initialized with
+ * libinput_replay_create_context(). Events already processed remain in
+ * the queue, followed by a @ref LIBINPUT_EVENT_DEVICE_REMOVED event.
+ *
+ * @param device A libinput device
+ *
+ * @note It is an application bug to call this function on a device not
+ * added with libinput_replay_add_device().
+ */
+void
+libinput_replay_remove_device(struct libinput_device *device);
+
+/**
+ * @ingroup base
+ *
+ * Process the given kernel events as if they were read from the
+ * device's node. The events are processed immediately, the resulting
+ * libinput events are available with libinput_get_event() once this
+ * function returns, events that depend on a timeout once the replay
+ * clock has passed that timeout.
+ *
+ * Event timestamps must not decrease, neither within one call nor
+ * across calls.
+ *
+ * @param device A device added with libinput_replay_add_device()
+ * @param events The kernel events, in the order the kernel would send
+ * them
+ * @param count The number of elements in events
+ *
+ * @return 0 on success, -EAGAIN if the device is suspended, or -EINVAL
+ * if the device is not a replay device.
+ */
+int
+libinput_replay_device_push_events(struct libinput_device *device,
+				   const struct input_event *events,
+				   size_t count);
+
+/**
+ * @ingroup base
+ *
+ * Read struct input_event elements from the file descriptor until the
+ * end of the file and process them as with
+ * libinput_replay_device_push_events(). The file descriptor is not
+ * closed.
+ *
+ * @param device A device added with libinput_replay_add_device()
+ * @param fd A file descriptor open for reading
+ *
+ * @return 0 on success or a negative errno on failure. Events read before
+ * a failure have been processed.
+ */
+int
+libinput_replay_device_push_fd(struct libinput_device *device, int fd);
+
+/**
+ * @ingroup base
+ *
+ * Advance the replay clock of a context initialized with
+ * libinput_replay_create_context() to the given time, firing all timers
+ * that expire until then, each at its deadline. This is needed to
+ * obtain events that depend on a timeout after the last event pushed,
+ * e.g. the button release of a single tap.
+ *
+ * @param libinput A libinput context initialized with
+ * libinput_replay_create_context()
+ * @param time The new time in microseconds, in the clock domain of the
+ * event timestamps
+ *
+ * @return 0 on success, or -1 if time is before the current replay time
+ * or the context does not use the replay clock
+ */
+int
+libinput_replay_set_time(struct libinput *libinput, uint64_t time);
+
 /**
  * @ingroup base
  *
@@ -1126,6 +1478,413 @@ libinput_get_event(struct libinput *libinput);
 enum libinput_event_type
 libinput_next_event_type(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Retrieve up to max events from libinput's internal event queue in one
+ * call. The events are returned in the same order as successive calls to
+ * libinput_get_event() would return them.
+ *
+ * If group_mask is nonzero, only events whose type is in one of the
+ * groups in the mask are retrieved. Retrieval stops at the first event
+ * not matching the mask, that event stays in the queue and is returned by
+ * the next call to libinput_get_event() or libinput_next_event_type().
+ * Events are never reordered.
+ *
+ * After handling the retrieved events, the caller must destroy each of
+ * them using libinput_event_destroy().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param events A caller-allocated array of at least max elements
+ * @param max The maximum number of events to retrieve
+ * @param group_mask A bitmask of @ref libinput_event_group, or 0 to
+ * retrieve events of any type
+ * @return The number of events stored in events, 0 if no matching event
+ * is available.
+ *
+ * @see libinput_get_event
+ */
+size_t
+libinput_get_events(struct libinput *libinput,
+		    struct libinput_event **events,
+		    size_t max,
+		    uint32_t group_mask);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable coalescing of queued events. If enabled, a @ref
+ * LIBINPUT_EVENT_POINTER_MOTION or @ref LIBINPUT_EVENT_POINTER_AXIS event
+ * is merged into the most recently queued event if that event has the
+ * same type and device and has not yet been retrieved with
+ * libinput_get_event().
+ *
+ * The deltas of merged motion events, both accelerated and
+ * unaccelerated, are summed up. Merged axis events must have the same
+ * axis source, their values and discrete values are summed up. An axis
+ * event that terminates a scroll sequence (see
+ * libinput_event_pointer_get_axis_value()) is never merged. The merged
+ * event carries the timestamp of the most recent event. With pointer
+ * frames enabled (see libinput_set_pointer_frames()), a @ref
+ * LIBINPUT_EVENT_POINTER_FRAME is never merged and no event merges
+ * across it, each frame keeps its events.
+ *
+ * Coalescing is disabled by default. Callers that read events only once
+ * per output frame may enable it to reduce the number of events they
+ * need to process.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enabled Nonzero to enable coalescing, zero to disable it
+ *
+ * @see libinput_get_event_coalescing
+ */
+void
+libinput_set_event_coalescing(struct libinput *libinput,
+			      int enabled);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Nonzero if event coalescing is enabled, zero otherwise
+ *
+ * @see libinput_set_event_coalescing
+ */
+int
+libinput_get_event_coalescing(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable pointer frames. If enabled, each hardware report
+ * that produced pointer events (@ref LIBINPUT_EVENT_POINTER_MOTION,
+ * @ref LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE, @ref
+ * LIBINPUT_EVENT_POINTER_BUTTON or @ref LIBINPUT_EVENT_POINTER_AXIS) is
+ * terminated by a @ref LIBINPUT_EVENT_POINTER_FRAME of the same device.
+ * Events generated internally, e.g. by tapping or button emulation
+ * timeouts, are terminated by a frame too.
+ *
+ * Pointer frames are disabled by default. Callers that forward pointer
+ * events to clients may enable them to group their updates per
+ * hardware report.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enabled Nonzero to enable pointer frames, zero to disable them
+ *
+ * @see libinput_get_pointer_frames
+ */
+void
+libinput_set_pointer_frames(struct libinput *libinput,
+			    int enabled);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Nonzero if pointer frames are enabled, zero otherwise
+ *
+ * @see libinput_set_pointer_frames
+ */
+int
+libinput_get_pointer_frames(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Limit the number of events held in libinput's internal event queue.
+ * Once the queue holds limit events, the policy decides what happens to
+ * further events. By default, the queue is unlimited.
+ *
+ * Events that change a device's state (e.g. button or key events, touch
+ * down and up events) are never discarded. If no motion event can be
+ * discarded to make room for such an event, the queue grows beyond the
+ * limit. Events discarded or merged because of the limit are counted per
+ * device, see libinput_device_get_dropped_event_count().
+ *
+ * If pointer frames are enabled, a @ref LIBINPUT_EVENT_POINTER_FRAME
+ * that would terminate nothing but a discarded motion event is discarded
+ * with it, see libinput_set_pointer_frames().
+ *
+ * The limit does not affect events that are already queued.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param limit The maximum number of queued events, or 0 for no limit
+ * @param policy The behavior once the limit is reached
+ * @return 0 on success or -1 if the policy is invalid
+ */
+int
+libinput_set_event_queue_limit(struct libinput *libinput,
+			       unsigned int limit,
+			       enum libinput_event_queue_policy policy);
+
+/**
+ * @ingroup base
+ *
+ * Retrieve the performance counters of this context. The counters of a
+ * context cover all devices, including devices that were removed since.
+ * The processing time includes timers and device discovery.
+ *
+ * The counters are always enabled and may be read from any thread. The
+ * snapshot is not atomic as a whole, each counter is read individually.
+ *
+ * The caller must set stats->size before calling this function, counters
+ * beyond that size are not written.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param stats Set to the current counters
+ *
+ * @see libinput_device_get_stats
+ */
+void
+libinput_get_stats(struct libinput *libinput,
+		   struct libinput_stats *stats);
+
+/**
+ * @ingroup base
+ *
+ * Return the number of bytes currently allocated by this context through
+ * its @ref libinput_allocator, excluding the allocator's own overhead.
+ * Memory allocated by libudev, libevdev and mtdev is not included.
+ *
+ * This function may be called from any thread.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The number of bytes allocated and not yet freed
+ */
+size_t
+libinput_get_allocated_bytes(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Select the events the caller is interested in. Events whose type is not
+ * in one of the groups in the mask are discarded before they are created,
+ * the caller never sees them. By default, all events are delivered.
+ *
+ * A device whose capabilities are all masked out is not read at all
+ * until the mask changes, unless libinput needs its events internally
+ * (e.g. a keyboard that a touchpad disables itself for while typing).
+ * Input that the kernel buffered in the meantime is processed under the
+ * old mask when the mask changes: it updates the device state, e.g. the
+ * keys and buttons that are down, but its events are not delivered.
+ * Keys and buttons count towards the seat key and button counts whether
+ * their events are masked or not, see
+ * libinput_event_keyboard_get_seat_key_count() and
+ * libinput_event_pointer_get_seat_button_count().
+ *
+ * Devices with a mask of their own, see libinput_device_set_event_mask(),
+ * are not affected. The mask does not affect events that are already
+ * queued.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param group_mask A bitmask of @ref libinput_event_group
+ *
+ * @see libinput_get_event_mask
+ */
+void
+libinput_set_event_mask(struct libinput *libinput,
+			uint32_t group_mask);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The bitmask of @ref libinput_event_group set with
+ * libinput_set_event_mask()
+ *
+ * @see libinput_set_event_mask
+ */
+uint32_t
+libinput_get_event_mask(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable libinput's internal timer. libinput uses timers for
+ * a number of timing-sensitive features (e.g. tap-to-click). By default,
+ * these timers are driven by a timerfd that is part of the file
+ * descriptor returned by libinput_get_fd().
+ *
+ * The internal timer cannot be enabled while a custom clock is set, see
+ * libinput_set_clock().
+ *
+ * If the internal timer is disabled, the caller is responsible for
+ * calling libinput_dispatch() once the deadline returned by
+ * libinput_get_next_timeout() has passed, even if no data is available
+ * on libinput's file descriptor. Timers that expired are handled at the
+ * start of libinput_dispatch().
+ *
+ * The internal timer is enabled by default.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enabled Nonzero to enable the internal timer, zero to disable it
+ * @return 0 on success or -1 if the timer could not be enabled
+ *
+ * @see libinput_get_internal_timer_enabled
+ * @see libinput_get_next_timeout
+ */
+int
+libinput_set_internal_timer_enabled(struct libinput *libinput,
+				    int enabled);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Nonzero if the internal timer is enabled, zero otherwise
+ *
+ * @see libinput_set_internal_timer_enabled
+ */
+int
+libinput_get_internal_timer_enabled(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * A clock source, see libinput_set_clock().
+ *
+ * @param user_data The user_data passed to libinput_set_clock()
+ * @return The current time in microseconds. The time must not go
+ * backwards.
+ */
+typedef uint64_t (*libinput_clock_func)(void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Replace the clock of this context, e.g. to replay recorded input with
+ * simulated time. By default libinput uses CLOCK_MONOTONIC. The clock
+ * should be set before any device is added, timers that are pending when
+ * the clock changes expire against the new clock.
+ *
+ * A custom clock disables the internal timer (see
+ * libinput_set_internal_timer_enabled()), time only passes when the
+ * caller advances its clock. Timers that expired by then are handled at
+ * the start of the next call to libinput_dispatch(), in order of their
+ * deadline and each with its deadline as the current time. The result
+ * thus does not depend on how far the clock is advanced at once.
+ *
+ * Event timestamps are still taken from the devices, a caller that
+ * replays input must advance its clock in step with them.
+ *
+ * The clock may be called from any thread libinput runs on.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param clock The clock source, or NULL to restore CLOCK_MONOTONIC.
+ * Restoring the default clock does not re-enable the internal timer.
+ * @param user_data Passed to the clock as-is
+ *
+ * @see libinput_get_next_timeout
+ */
+void
+libinput_set_clock(struct libinput *libinput,
+		   libinput_clock_func clock,
+		   void *user_data);
+
+/**
+ * @ingroup base
+ *
+ * Return the deadline of the earliest pending internal timer. Callers
+ * that disabled the internal timer with
+ * libinput_set_internal_timer_enabled() must call libinput_dispatch()
+ * once this deadline has passed.
+ *
+ * The deadline may change with every call to libinput_dispatch(), the
+ * caller should query it again after each call.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The deadline in microseconds, in absolute CLOCK_MONOTONIC
+ * time or the time of the clock set with libinput_set_clock(), or 0 if
+ * no timer is pending
+ */
+uint64_t
+libinput_get_next_timeout(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable the input thread. By default, all input devices are
+ * read and their events processed inside libinput_dispatch(), on
+ * whichever thread calls it.
+ *
+ * If the input thread is enabled, libinput reads and processes device
+ * events on a thread of its own as soon as they arrive. The file
+ * descriptor returned by libinput_get_fd() stays the same, it becomes
+ * readable whenever the input thread has events ready. The caller must
+ * still call libinput_dispatch() to move these events into the event
+ * queue, but that call no longer does any device processing.
+ *
+ * While the input thread runs, the callbacks in struct
+ * libinput_interface and the log handler are called on the input
+ * thread. All other functions must be called from a single thread;
+ * calls that change or query device state are serialized with the
+ * input thread. libinput_dispatch(), libinput_get_event() and
+ * libinput_event_destroy() never wait for the input thread.
+ *
+ * Disabling the input thread waits for the thread to finish, events it
+ * processed already are added to the event queue.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enabled Nonzero to enable the input thread, zero to disable it
+ * @return 0 on success or -1 if the input thread could not be started
+ *
+ * @see libinput_get_input_thread_enabled
+ */
+int
+libinput_set_input_thread_enabled(struct libinput *libinput,
+				  int enabled);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Nonzero if the input thread is enabled, zero otherwise
+ *
+ * @see libinput_set_input_thread_enabled
+ */
+int
+libinput_get_input_thread_enabled(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Set the number of worker threads used to process devices. By default,
+ * no worker threads are used and all devices are processed one after the
+ * other by the thread that reads them, see
+ * libinput_set_input_thread_enabled().
+ *
+ * With worker threads, devices that have events pending at the same time
+ * are processed in parallel. Devices that depend on each other, e.g. a
+ * touchpad and the keyboard it disables itself for while typing, are
+ * always processed together on the same thread. The events of all devices
+ * are merged into the event queue in timestamp order, the order of the
+ * events of a single device never changes.
+ *
+ * The reading thread takes part in the processing too, a count of n uses
+ * n + 1 threads in total.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param count The number of worker threads, 0 to disable
+ * @return 0 on success or -1 if the threads could not be started or count
+ * is too large. On failure, the previous setting stays in effect.
+ *
+ * @see libinput_get_worker_threads
+ */
+int
+libinput_set_worker_threads(struct libinput *libinput,
+			    unsigned int count);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The number of worker threads, 0 if disabled
+ *
+ * @see libinput_set_worker_threads
+ */
+unsigned int
+libinput_get_worker_threads(struct libinput *libinput);
+
 /**
  * @ingroup base
  *
@@ -1581,6 +2340,136 @@ libinput_device_get_id_vendor(struct libinput_device *device);
 const char *
 libinput_device_get_output_name(struct libinput_device *device);
 
+/**
+ * @ingroup device
+ *
+ * Return the number of events from this device that were discarded or
+ * merged into other events because the event queue was full. See
+ * libinput_set_event_queue_limit().
+ *
+ * @param device A previously obtained device
+ * @return The number of events dropped for this device
+ */
+uint64_t
+libinput_device_get_dropped_event_count(struct libinput_device *device);
+
+/**
+ * @ingroup device
+ *
+ * Retrieve the performance counters of this device, see
+ * libinput_get_stats() for details. The processing time only includes the
+ * time spent reading and processing this device's input.
+ *
+ * @param device A previously obtained device
+ * @param stats Set to the current counters, the caller must set
+ * stats->size first
+ */
+void
+libinput_device_get_stats(struct libinput_device *device,
+			  struct libinput_stats *stats);
+
+/**
+ * @ingroup device
+ *
+ * Retrieve the latency histogram of this device for the given event
+ * type. The latency of an event is the time between the kernel
+ * timestamp of the input that caused it and the moment the caller
+ * retrieved it with libinput_get_event() or libinput_get_events().
+ *
+ * Bucket n counts the events with a latency of at least 2^n and less
+ * than 2^(n+1) microseconds. Bucket 0 also counts events with no
+ * measurable latency, the last bucket counts all events above its lower
+ * bound. At most 32 buckets are used.
+ *
+ * Histograms are always recorded, they may be read from any thread.
+ *
+ * @param device A previously obtained device
+ * @param type The event type, events without a timestamp (e.g. @ref
+ * LIBINPUT_EVENT_DEVICE_ADDED) have no histogram
+ * @param buckets A caller-allocated array of at least nbuckets elements
+ * @param nbuckets The number of elements in buckets
+ * @return The number of buckets filled in, 0 if the event type has no
+ * histogram
+ *
+ * @see libinput_device_reset_latency_histograms
+ */
+size_t
+libinput_device_get_latency_histogram(struct libinput_device *device,
+				      enum libinput_event_type type,
+				      uint64_t *buckets,
+				      size_t nbuckets);
+
+/**
+ * @ingroup device
+ *
+ * Reset the latency histograms of all event types of this device to
+ * zero.
+ *
+ * @param device A previously obtained device
+ *
+ * @see libinput_device_get_latency_histogram
+ */
+void
+libinput_device_reset_latency_histograms(struct libinput_device *device);
+
+/**
+ * @ingroup device
+ *
+ * Write the most recent internal state machine transitions of this
+ * device (tapping, software buttons, middle button emulation) to a file
+ * descriptor. The transitions are always recorded into a small ring
+ * buffer, this call is intended for bug reports where debug logging was
+ * not enabled when the issue occurred.
+ *
+ * The data is in a binary format and not stable across libinput
+ * versions, the state-trace-decode tool shipped in libinput's source
+ * tree prints it as text.
+ *
+ * @param device A previously obtained device
+ * @param fd A file descriptor open for writing
+ * @return 0 on success or a negative errno on failure
+ */
+int
+libinput_device_dump_state_trace(struct libinput_device *device, int fd);
+
+/**
+ * @ingroup device
+ *
+ * Set the event mask for this device, overriding the context's mask set
+ * with libinput_set_event_mask(). See libinput_set_event_mask() for
+ * details.
+ *
+ * @param device A previously obtained device
+ * @param group_mask A bitmask of @ref libinput_event_group
+ *
+ * @see libinput_device_reset_event_mask
+ * @see libinput_device_get_event_mask
+ */
+void
+libinput_device_set_event_mask(struct libinput_device *device,
+			       uint32_t group_mask);
+
+/**
+ * @ingroup device
+ *
+ * Remove the event mask set with libinput_device_set_event_mask(), the
+ * device uses the context's mask again.
+ *
+ * @param device A previously obtained device
+ */
+void
+libinput_device_reset_event_mask(struct libinput_device *device);
+
+/**
+ * @ingroup device
+ *
+ * @param device A previously obtained device
+ * @return The bitmask of @ref libinput_event_group in effect for this
+ * device, either its own or the context's
+ */
+uint32_t
+libinput_device_get_event_mask(struct libinput_device *device);
+
 /**
  * @ingroup device
  *
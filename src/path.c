@@ -29,6 +29,7 @@
 
 #include "path.h"
 #include "evdev.h"
+#include "input-thread.h"
 
 static const char default_seat[] = "seat0";
 static const char default_seat_name[] = "default";
@@ -73,7 +74,7 @@ static void
 path_seat_destroy(struct libinput_seat *seat)
 {
 	struct path_seat *pseat = (struct path_seat*)seat;
-	free(pseat);
+	libinput_free(seat->libinput, pseat);
 }
 
 static struct path_seat*
@@ -83,7 +84,7 @@ path_seat_create(struct path_input *input,
 {
 	struct path_seat *seat;
 
-	seat = zalloc(sizeof(*seat));
+	seat = libinput_zalloc(&input->base, sizeof(*seat));
 	if (!seat)
 		return NULL;
 
@@ -123,16 +124,19 @@ path_device_enable(struct path_input *input,
 	devnode = udev_device_get_devnode(udev_device);
 
 	seat_prop = udev_device_get_property_value(udev_device, "ID_SEAT");
-	seat_name = strdup(seat_prop ? seat_prop : default_seat);
+	seat_name = libinput_strdup(&input->base,
+				    seat_prop ? seat_prop : default_seat);
 
 	if (seat_logical_name_override) {
-		seat_logical_name = strdup(seat_logical_name_override);
+		seat_logical_name = libinput_strdup(&input->base,
+						    seat_logical_name_override);
 	} else {
 		seat_prop = udev_device_get_property_value(udev_device, "WL_SEAT");
-		seat_logical_name = strdup(seat_prop ? seat_prop : default_seat_name);
+		seat_logical_name = libinput_strdup(&input->base,
+						    seat_prop ? seat_prop : default_seat_name);
 	}
 
-	if (!seat_logical_name) {
+	if (!seat_name || !seat_logical_name) {
 		log_error(&input->base,
 			  "failed to create seat name for device '%s'.\n",
 			  devnode);
@@ -170,8 +174,8 @@ path_device_enable(struct path_input *input,
 	}
 
 out:
-	free(seat_name);
-	free(seat_logical_name);
+	libinput_free(&input->base, seat_name);
+	libinput_free(&input->base, seat_logical_name);
 
 	return device ? &device->base : NULL;
 }
@@ -202,7 +206,7 @@ path_input_destroy(struct libinput *input)
 
 	list_for_each_safe(dev, tmp, &path_input->path_list, link) {
 		udev_device_unref(dev->udev_device);
-		free(dev);
+		libinput_free(input, dev);
 	}
 
 }
@@ -216,7 +220,7 @@ path_create_device(struct libinput *libinput,
 	struct path_device *dev;
 	struct libinput_device *device;
 
-	dev = zalloc(sizeof *dev);
+	dev = libinput_zalloc(libinput, sizeof *dev);
 	if (!dev)
 		return NULL;
 
@@ -229,7 +233,7 @@ path_create_device(struct libinput *libinput,
 	if (!device) {
 		udev_device_unref(dev->udev_device);
 		list_remove(&dev->link);
-		free(dev);
+		libinput_free(libinput, dev);
 	}
 
 	return device;
@@ -264,8 +268,20 @@ static const struct libinput_interface_backend interface_backend = {
 LIBINPUT_EXPORT struct libinput *
 libinput_path_create_context(const struct libinput_interface *interface,
 			     void *user_data)
+{
+	return libinput_path_create_context_with_allocator(interface,
+							   user_data,
+							   NULL);
+}
+
+LIBINPUT_EXPORT struct libinput *
+libinput_path_create_context_with_allocator(
+				const struct libinput_interface *interface,
+				void *user_data,
+				const struct libinput_allocator *allocator)
 {
 	struct path_input *input;
+	struct mem_allocator mem;
 	struct udev *udev;
 
 	if (!interface)
@@ -275,12 +291,13 @@ libinput_path_create_context(const struct libinput_interface *interface,
 	if (!udev)
 		return NULL;
 
-	input = zalloc(sizeof *input);
+	mem_allocator_init(&mem, allocator);
+	input = mem_zalloc(&mem, sizeof *input);
 	if (!input ||
-	    libinput_init(&input->base, interface,
+	    libinput_init(&input->base, &mem, interface,
 			  &interface_backend, user_data) != 0) {
 		udev_unref(udev);
-		free(input);
+		mem_free(&mem, input);
 		return NULL;
 	}
 
@@ -329,6 +346,7 @@ libinput_path_add_device(struct libinput *libinput,
 	struct udev *udev = input->udev;
 	struct udev_device *udev_device;
 	struct libinput_device *device;
+	libinput_lock_scope(libinput);
 
 	if (libinput->interface_backend != &interface_backend) {
 		log_bug_client(libinput, "Mismatching backends.\n");
@@ -354,6 +372,7 @@ libinput_path_remove_device(struct libinput_device *device)
 	struct libinput_seat *seat;
 	struct evdev_device *evdev = (struct evdev_device*)device;
 	struct path_device *dev;
+	libinput_lock_scope(libinput);
 
 	if (libinput->interface_backend != &interface_backend) {
 		log_bug_client(libinput, "Mismatching backends.\n");
@@ -364,7 +383,7 @@ libinput_path_remove_device(struct libinput_device *device)
 		if (dev->udev_device == evdev->udev_device) {
 			list_remove(&dev->link);
 			udev_device_unref(dev->udev_device);
-			free(dev);
+			libinput_free(libinput, dev);
 			break;
 		}
 	}
@@ -0,0 +1,334 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <libevdev/libevdev.h>
+
+#include "replay.h"
+#include "evdev.h"
+#include "input-thread.h"
+
+static const char default_seat[] = "seat0";
+static const char default_seat_name[] = "default";
+
+/* No device is ever opened, these exist to satisfy libinput_init() */
+static int
+replay_open_restricted(const char *path, int flags, void *user_data)
+{
+	return -ENODEV;
+}
+
+static void
+replay_close_restricted(int fd, void *user_data)
+{
+}
+
+static const struct libinput_interface replay_interface = {
+	.open_restricted = replay_open_restricted,
+	.close_restricted = replay_close_restricted,
+};
+
+static uint64_t
+replay_clock(void *user_data)
+{
+	struct replay_input *input = user_data;
+
+	return input->now;
+}
+
+static void
+replay_advance(struct replay_input *input, uint64_t time)
+{
+	struct libinput *libinput = &input->base;
+
+	if (libinput->clock.func != replay_clock || time <= input->now)
+		return;
+
+	/* fires every timer due until then at its own deadline */
+	input->now = time;
+	libinput_timer_dispatch(libinput);
+}
+
+static void
+replay_input_suspend(struct libinput *libinput)
+{
+	struct libinput_seat *seat;
+	struct evdev_device *device;
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, base.link)
+			evdev_device_suspend(device);
+	}
+}
+
+static int
+replay_input_resume(struct libinput *libinput)
+{
+	struct libinput_seat *seat;
+	struct evdev_device *device;
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, base.link)
+			evdev_device_resume(device);
+	}
+
+	return 0;
+}
+
+static void
+replay_input_destroy(struct libinput *libinput)
+{
+	struct libinput_seat *seat, *tmp;
+	struct evdev_device *device, *next;
+
+	/* There is nothing to re-create the devices from, so unlike the
+	 * other backends suspend keeps them and they go away here */
+	list_for_each_safe(seat, tmp, &libinput->seat_list, link) {
+		libinput_seat_ref(seat);
+		list_for_each_safe(device, next,
+				   &seat->devices_list, base.link)
+			evdev_device_remove(device);
+		libinput_seat_unref(seat);
+	}
+}
+
+static int
+replay_device_change_seat(struct libinput_device *device,
+			  const char *seat_name)
+{
+	return -1;
+}
+
+static const struct libinput_interface_backend interface_backend = {
+	.resume = replay_input_resume,
+	.suspend = replay_input_suspend,
+	.destroy = replay_input_destroy,
+	.device_change_seat = replay_device_change_seat,
+};
+
+static void
+replay_seat_destroy(struct libinput_seat *seat)
+{
+	struct replay_seat *rseat = (struct replay_seat*)seat;
+	libinput_free(seat->libinput, rseat);
+}
+
+static struct replay_seat *
+replay_seat_get(struct replay_input *input)
+{
+	struct replay_seat *seat;
+
+	/* all devices share the one seat */
+	if (!list_empty(&input->base.seat_list)) {
+		seat = container_of(input->base.seat_list.next, seat,
+				    base.link);
+		libinput_seat_ref(&seat->base);
+		return seat;
+	}
+
+	seat = libinput_zalloc(&input->base, sizeof(*seat));
+	if (!seat)
+		return NULL;
+
+	libinput_seat_init(&seat->base, &input->base, default_seat,
+			   default_seat_name, replay_seat_destroy);
+
+	return seat;
+}
+
+static bool
+replay_check_device(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct evdev_device *evdev = (struct evdev_device*)device;
+
+	if (libinput->interface_backend != &interface_backend ||
+	    !evdev->replay.enabled) {
+		log_bug_client(libinput, "Mismatching backends.\n");
+		return false;
+	}
+
+	return true;
+}
+
+LIBINPUT_EXPORT struct libinput *
+libinput_replay_create_context(void *user_data,
+			       const struct libinput_allocator *allocator)
+{
+	struct replay_input *input;
+	struct mem_allocator mem;
+
+	mem_allocator_init(&mem, allocator);
+	input = mem_zalloc(&mem, sizeof *input);
+	if (!input ||
+	    libinput_init(&input->base, &mem, &replay_interface,
+			  &interface_backend, user_data) != 0) {
+		mem_free(&mem, input);
+		return NULL;
+	}
+
+	libinput_set_clock(&input->base, replay_clock, input);
+
+	return &input->base;
+}
+
+LIBINPUT_EXPORT struct libinput_device *
+libinput_replay_add_device(struct libinput *libinput,
+			   struct libevdev *evdev,
+			   const char *const *udev_properties)
+{
+	struct replay_input *input = (struct replay_input *)libinput;
+	struct replay_seat *seat;
+	struct evdev_device *device;
+	char sysname[32];
+	libinput_lock_scope(libinput);
+
+	if (libinput->interface_backend != &interface_backend) {
+		log_bug_client(libinput, "Mismatching backends.\n");
+		return NULL;
+	}
+
+	seat = replay_seat_get(input);
+	if (!seat)
+		return NULL;
+
+	snprintf(sysname, sizeof(sysname), "replay%u", input->next_id++);
+
+	device = evdev_device_create_replay(&seat->base, evdev, sysname,
+					    udev_properties);
+	libinput_seat_unref(&seat->base);
+
+	if (device == NULL) {
+		log_info(libinput,
+			 "failed to create replay device '%s'.\n",
+			 libevdev_get_name(evdev));
+		return NULL;
+	}
+
+	return &device->base;
+}
+
+LIBINPUT_EXPORT void
+libinput_replay_remove_device(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct libinput_seat *seat;
+	libinput_lock_scope(libinput);
+
+	if (!replay_check_device(device))
+		return;
+
+	seat = device->seat;
+	libinput_seat_ref(seat);
+	evdev_device_remove((struct evdev_device*)device);
+	libinput_seat_unref(seat);
+}
+
+LIBINPUT_EXPORT int
+libinput_replay_device_push_events(struct libinput_device *device,
+				   const struct input_event *events,
+				   size_t count)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct replay_input *input = (struct replay_input *)libinput;
+	struct evdev_device *evdev = (struct evdev_device*)device;
+	struct input_event ev;
+	uint64_t start;
+	size_t i;
+	libinput_lock_scope(libinput);
+
+	if (!replay_check_device(device))
+		return -EINVAL;
+
+	if (evdev->suspended)
+		return -EAGAIN;
+
+	start = libinput_monotonic_now(libinput);
+
+	for (i = 0; i < count; i++) {
+		ev = events[i];
+		replay_advance(input,
+			       ev.time.tv_sec * 1000000ULL + ev.time.tv_usec);
+		evdev_device_replay_event(evdev, &ev);
+	}
+
+	libinput_flush_pointer_frames(libinput);
+	evdev_device_update_stats(evdev, count, 0, start);
+
+	return 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_replay_device_push_fd(struct libinput_device *device, int fd)
+{
+	struct input_event events[64];
+	size_t have = 0, n;
+	ssize_t len;
+	int rc;
+
+	while (true) {
+		len = read(fd, (char *)events + have, sizeof(events) - have);
+		if (len < 0 && errno == EINTR)
+			continue;
+		else if (len < 0)
+			return -errno;
+		else if (len == 0)
+			break;
+
+		have += len;
+		n = have / sizeof(*events);
+		rc = libinput_replay_device_push_events(device, events, n);
+		if (rc != 0)
+			return rc;
+
+		have -= n * sizeof(*events);
+		memmove(events, events + n, have);
+	}
+
+	/* a truncated event at the end of the file */
+	return have ? -EINVAL : 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_replay_set_time(struct libinput *libinput, uint64_t time)
+{
+	struct replay_input *input = (struct replay_input *)libinput;
+	libinput_lock_scope(libinput);
+
+	if (libinput->interface_backend != &interface_backend) {
+		log_bug_client(libinput, "Mismatching backends.\n");
+		return -1;
+	}
+
+	if (libinput->clock.func != replay_clock || time < input->now)
+		return -1;
+
+	replay_advance(input, time);
+
+	return 0;
+}
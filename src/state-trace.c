@@ -0,0 +1,133 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libinput-util.h"
+#include "state-trace.h"
+
+struct string_table {
+	const char **strings;
+	size_t count;
+};
+
+static uint16_t
+string_table_add(struct string_table *table, const char *str)
+{
+	size_t i;
+
+	if (!str)
+		str = "?";
+
+	for (i = 0; i < table->count; i++) {
+		if (table->strings[i] == str ||
+		    strcmp(table->strings[i], str) == 0)
+			return i;
+	}
+
+	table->strings[table->count] = str;
+
+	return table->count++;
+}
+
+static int
+write_all(int fd, const void *data, size_t len)
+{
+	const char *p = data;
+	ssize_t rc;
+
+	while (len > 0) {
+		rc = write(fd, p, len);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		p += rc;
+		len -= rc;
+	}
+
+	return 0;
+}
+
+int
+state_trace_dump(const struct state_trace *trace,
+		 struct mem_allocator *mem,
+		 int fd)
+{
+	struct state_trace_file_header header;
+	struct state_trace_file_record *records;
+	const struct state_trace_entry *e;
+	struct string_table table = {0};
+	uint64_t first, i;
+	size_t n, nrecords;
+	int rc = -ENOMEM;
+
+	first = trace->count > STATE_TRACE_SIZE ?
+		trace->count - STATE_TRACE_SIZE : 0;
+	nrecords = trace->count - first;
+
+	/* at most machine, from, event and to are new for each record */
+	table.strings = mem_calloc(mem, nrecords * 4 + 1, sizeof *table.strings);
+	records = mem_calloc(mem, nrecords + 1, sizeof *records);
+	if (!table.strings || !records)
+		goto out;
+
+	for (i = first, n = 0; i < trace->count; i++, n++) {
+		e = &trace->entries[i % STATE_TRACE_SIZE];
+
+		records[n].time = e->time;
+		records[n].touch = e->touch;
+		records[n].machine = string_table_add(&table, e->machine->name);
+		records[n].from = string_table_add(&table,
+				e->machine->state_to_str(e->from));
+		records[n].event = string_table_add(&table,
+				e->machine->event_to_str(e->event));
+		records[n].to = string_table_add(&table,
+				e->machine->state_to_str(e->to));
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, STATE_TRACE_MAGIC, sizeof(header.magic));
+	header.nstrings = table.count;
+	header.nrecords = nrecords;
+
+	rc = write_all(fd, &header, sizeof(header));
+	for (n = 0; rc == 0 && n < table.count; n++)
+		rc = write_all(fd, table.strings[n],
+			       strlen(table.strings[n]) + 1);
+	if (rc == 0)
+		rc = write_all(fd, records, nrecords * sizeof *records);
+
+out:
+	mem_free(mem, records);
+	mem_free(mem, table.strings);
+
+	return rc;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef STATE_TRACE_H
+#define STATE_TRACE_H
+
+#include <stdint.h>
+
+/*
+ * A fixed-size ring of the most recent state machine transitions of a
+ * device. Recording is a plain store, names are only looked up when the
+ * ring is dumped with libinput_device_dump_state_trace(). The dump is
+ * turned back into text by tools/state-trace-decode.
+ */
+
+#define STATE_TRACE_SIZE 256		/* power of two */
+#define STATE_TRACE_NO_TOUCH 0xffff
+
+struct state_trace_machine {
+	const char *name;
+	const char *(*state_to_str)(int state);
+	const char *(*event_to_str)(int event);
+};
+
+struct state_trace_entry {
+	uint64_t time;
+	const struct state_trace_machine *machine;
+	uint8_t from;
+	uint8_t event;
+	uint8_t to;
+	uint16_t touch;
+};
+
+struct state_trace {
+	struct state_trace_entry entries[STATE_TRACE_SIZE];
+	uint64_t count;
+};
+
+static inline void
+state_trace_record(struct state_trace *trace,
+		   const struct state_trace_machine *machine,
+		   uint64_t time,
+		   unsigned int touch,
+		   int from,
+		   int event,
+		   int to)
+{
+	struct state_trace_entry *e;
+
+	e = &trace->entries[trace->count++ % STATE_TRACE_SIZE];
+	e->time = time;
+	e->machine = machine;
+	e->from = from;
+	e->event = event;
+	e->to = to;
+	e->touch = touch;
+}
+
+struct mem_allocator;
+
+int
+state_trace_dump(const struct state_trace *trace,
+		 struct mem_allocator *mem,
+		 int fd);
+
+/*
+ * Dump format, host byte order: the header, nstrings NUL-terminated
+ * strings, then nrecords records oldest first. The name fields of a
+ * record are indices into the string table.
+ */
+
+#define STATE_TRACE_MAGIC "LISTATE1"
+
+struct state_trace_file_header {
+	char magic[8];
+	uint32_t nstrings;
+	uint32_t nrecords;
+};
+
+struct state_trace_file_record {
+	uint64_t time;		/* µs */
+	uint16_t machine;
+	uint16_t from;
+	uint16_t event;
+	uint16_t to;
+	uint16_t touch;		/* STATE_TRACE_NO_TOUCH if not per-touch */
+	uint16_t padding[3];
+};
+
+#endif
@@ -29,6 +29,8 @@
 
 #include "libinput-private.h"
 #include "timer.h"
+#include "usdt.h"
+#include "worker-pool.h"
 
 void
 libinput_timer_init(struct libinput_timer *timer, struct libinput *libinput,
@@ -40,36 +42,147 @@ libinput_timer_init(struct libinput_timer *timer, struct libinput *libinput,
 	timer->timer_func_data = timer_func_data;
 }
 
+/*
+ * Pending timers are kept in a binary min-heap ordered by expiry, the
+ * earliest timer is always heap[0]. Each timer knows its own slot so
+ * it can be removed without searching.
+ */
+
+static inline void
+timer_heap_place(struct libinput *libinput,
+		 struct libinput_timer *timer,
+		 size_t index)
+{
+	libinput->timer.heap[index] = timer;
+	timer->heap_index = index;
+}
+
+static void
+timer_heap_sift_up(struct libinput *libinput, size_t index)
+{
+	struct libinput_timer **heap = libinput->timer.heap;
+	struct libinput_timer *timer = heap[index];
+	size_t parent;
+
+	while (index > 0) {
+		parent = (index - 1) / 2;
+		if (heap[parent]->expire <= timer->expire)
+			break;
+
+		timer_heap_place(libinput, heap[parent], index);
+		index = parent;
+	}
+
+	timer_heap_place(libinput, timer, index);
+}
+
+static void
+timer_heap_sift_down(struct libinput *libinput, size_t index)
+{
+	struct libinput_timer **heap = libinput->timer.heap;
+	struct libinput_timer *timer = heap[index];
+	size_t count = libinput->timer.count;
+	size_t child;
+
+	while ((child = index * 2 + 1) < count) {
+		if (child + 1 < count &&
+		    heap[child + 1]->expire < heap[child]->expire)
+			child++;
+
+		if (timer->expire <= heap[child]->expire)
+			break;
+
+		timer_heap_place(libinput, heap[child], index);
+		index = child;
+	}
+
+	timer_heap_place(libinput, timer, index);
+}
+
+static int
+timer_heap_insert(struct libinput *libinput, struct libinput_timer *timer)
+{
+	struct libinput_timer **heap;
+	size_t len;
+
+	if (libinput->timer.count == libinput->timer.heap_len) {
+		len = libinput->timer.heap_len * 2;
+		heap = libinput_realloc(libinput,
+					libinput->timer.heap,
+					len * sizeof(*heap));
+		if (!heap)
+			return -1;
+
+		libinput->timer.heap = heap;
+		libinput->timer.heap_len = len;
+	}
+
+	timer_heap_place(libinput, timer, libinput->timer.count++);
+	timer_heap_sift_up(libinput, timer->heap_index);
+
+	return 0;
+}
+
+static void
+timer_heap_remove(struct libinput *libinput, struct libinput_timer *timer)
+{
+	size_t index = timer->heap_index;
+	struct libinput_timer *last;
+
+	last = libinput->timer.heap[--libinput->timer.count];
+	if (last == timer)
+		return;
+
+	timer_heap_place(libinput, last, index);
+	if (index > 0 &&
+	    libinput->timer.heap[(index - 1) / 2]->expire > last->expire)
+		timer_heap_sift_up(libinput, index);
+	else
+		timer_heap_sift_down(libinput, index);
+}
+
 static void
 libinput_timer_arm_timer_fd(struct libinput *libinput)
 {
 	int r;
-	struct libinput_timer *timer;
 	struct itimerspec its = { { 0, 0 }, { 0, 0 } };
-	uint64_t earliest_expire = UINT64_MAX;
+	uint64_t earliest_expire = 0;
 
-	list_for_each(timer, &libinput->timer.list, link) {
-		if (timer->expire < earliest_expire)
-			earliest_expire = timer->expire;
-	}
+	/* The timer handler re-arms once after all due timers fired */
+	if (libinput->timer.dispatching || libinput->timer.fd == -1)
+		return;
+
+	if (libinput->timer.count > 0)
+		earliest_expire = libinput->timer.heap[0]->expire;
+
+	/* Only touch the timerfd if the earliest expiry changed */
+	if (earliest_expire == libinput->timer.armed)
+		return;
 
-	if (earliest_expire != UINT64_MAX) {
-		its.it_value.tv_sec = earliest_expire / 1000;
-		its.it_value.tv_nsec = (earliest_expire % 1000) * 1000 * 1000;
+	if (earliest_expire != 0) {
+		its.it_value.tv_sec = earliest_expire / ms2us(1000);
+		its.it_value.tv_nsec = (earliest_expire % ms2us(1000)) * 1000;
 	}
 
 	r = timerfd_settime(libinput->timer.fd, TFD_TIMER_ABSTIME, &its, NULL);
-	if (r)
+	if (r) {
 		log_error(libinput, "timerfd_settime error: %s\n", strerror(errno));
+		return;
+	}
+
+	libinput->timer.armed = earliest_expire;
 }
 
 void
 libinput_timer_set(struct libinput_timer *timer, uint64_t expire)
 {
+	struct libinput *libinput = timer->libinput;
+
 #ifndef NDEBUG
-	uint64_t now = libinput_now(timer->libinput);
-	if (abs(expire - now) > 5000)
-		log_bug_libinput(timer->libinput,
+	/* a simulated clock may be far ahead of a timer firing late */
+	uint64_t now = libinput_now(libinput);
+	if (!libinput->clock.func && abs(expire - now) > ms2us(5000))
+		log_bug_libinput(libinput,
 				 "timer offset more than 5s, now %"
 				 PRIu64 " expire %" PRIu64 "\n",
 				 now, expire);
@@ -77,11 +190,30 @@ libinput_timer_set(struct libinput_timer *timer, uint64_t expire)
 
 	assert(expire);
 
-	if (!timer->expire)
-		list_insert(&timer->libinput->timer.list, &timer->link);
+	libinput_workers_lock(libinput);
 
-	timer->expire = expire;
-	libinput_timer_arm_timer_fd(timer->libinput);
+	/* goes back into the heap when the dispatch round ends */
+	if (timer->deferred) {
+		timer->expire = expire;
+		goto out;
+	}
+
+	if (timer->expire) {
+		timer->expire = expire;
+		timer_heap_sift_up(libinput, timer->heap_index);
+		timer_heap_sift_down(libinput, timer->heap_index);
+	} else {
+		timer->expire = expire;
+		if (timer_heap_insert(libinput, timer) != 0) {
+			log_error(libinput, "failed to allocate timer\n");
+			timer->expire = 0;
+			goto out;
+		}
+	}
+
+	libinput_timer_arm_timer_fd(libinput);
+out:
+	libinput_workers_unlock(libinput);
 }
 
 void
@@ -90,17 +222,110 @@ libinput_timer_cancel(struct libinput_timer *timer)
 	if (!timer->expire)
 		return;
 
+	libinput_workers_lock(timer->libinput);
 	timer->expire = 0;
-	list_remove(&timer->link);
+	if (timer->deferred) {
+		list_remove(&timer->deferred_link);
+		timer->deferred = false;
+		libinput_workers_unlock(timer->libinput);
+		return;
+	}
+	timer_heap_remove(timer->libinput, timer);
 	libinput_timer_arm_timer_fd(timer->libinput);
+	libinput_workers_unlock(timer->libinput);
 }
 
-static void
-libinput_timer_handler(void *data)
+uint64_t
+libinput_timer_next_expiry(struct libinput *libinput)
+{
+	if (libinput->timer.count == 0)
+		return 0;
+
+	return libinput->timer.heap[0]->expire;
+}
+
+void
+libinput_timer_dispatch(struct libinput *libinput)
 {
-	struct libinput *libinput = data;
 	struct libinput_timer *timer, *tmp;
-	uint64_t now;
+	uint64_t now, fire_time;
+	size_t count;
+	bool simulated = libinput->clock.func != NULL;
+
+	now = libinput_now(libinput);
+	if (now == 0)
+		return;
+
+	/* Timers re-armed by their own timer_func go back into the heap,
+	 * only fire as many as were pending when we started. With a
+	 * simulated clock every timer fires at its deadline instead, so
+	 * a re-armed timer that is due again fires in this round too, as
+	 * long as its deadline moved forward. One that didn't is set aside
+	 * until the round ends, the other due timers still fire. */
+	libinput->timer.dispatching = true;
+	libinput->timer.round++;
+	count = libinput->timer.count;
+	while ((simulated || count-- > 0) && libinput->timer.count > 0) {
+		timer = libinput->timer.heap[0];
+		if (timer->expire > now)
+			break;
+
+		fire_time = simulated ? timer->expire : now;
+
+		if (simulated) {
+			if (timer->fired_round == libinput->timer.round &&
+			    timer->expire <= timer->fired) {
+				log_bug_libinput(libinput,
+						 "timer re-armed at %" PRIu64
+						 " after firing at %" PRIu64
+						 ", deferred\n",
+						 timer->expire,
+						 timer->fired);
+				libinput_workers_lock(libinput);
+				timer_heap_remove(libinput, timer);
+				timer->deferred = true;
+				list_insert(&libinput->timer.deferred,
+					    &timer->deferred_link);
+				libinput_workers_unlock(libinput);
+				continue;
+			}
+
+			timer->fired = fire_time;
+			timer->fired_round = libinput->timer.round;
+		}
+
+		usdt_probe(timer_fire, timer->expire, fire_time);
+
+		/* Clear the timer before calling timer_func,
+		   as timer_func may re-arm it */
+		libinput_timer_cancel(timer);
+		timer->timer_func(fire_time, timer->timer_func_data);
+		libinput_flush_pointer_frames(libinput);
+		libinput_stats_add(&libinput->stats.timers_fired, 1);
+	}
+
+	libinput_workers_lock(libinput);
+	list_for_each_safe(timer, tmp, &libinput->timer.deferred,
+			   deferred_link) {
+		list_remove(&timer->deferred_link);
+		timer->deferred = false;
+
+		if (timer_heap_insert(libinput, timer) != 0) {
+			log_error(libinput, "failed to allocate timer\n");
+			timer->expire = 0;
+		}
+	}
+	libinput_workers_unlock(libinput);
+
+	libinput->timer.dispatching = false;
+
+	libinput_timer_arm_timer_fd(libinput);
+}
+
+static bool
+libinput_timer_handler(void *data, unsigned int budget)
+{
+	struct libinput *libinput = data;
 	uint64_t discard;
 	int r;
 
@@ -111,36 +336,80 @@ libinput_timer_handler(void *data)
 				 errno,
 				 strerror(errno));
 
-	now = libinput_now(libinput);
-	if (now == 0)
-		return;
+	/* A one-shot timerfd is disarmed once it expired */
+	if (r > 0)
+		libinput->timer.armed = 0;
 
-	list_for_each_safe(timer, tmp, &libinput->timer.list, link) {
-		if (timer->expire <= now) {
-			/* Clear the timer before calling timer_func,
-			   as timer_func may re-arm it */
-			libinput_timer_cancel(timer);
-			timer->timer_func(now, timer->timer_func_data);
-		}
-	}
+	libinput_timer_dispatch(libinput);
+
+	return false;
 }
 
-int
-libinput_timer_subsys_init(struct libinput *libinput)
+static int
+libinput_timer_fd_init(struct libinput *libinput)
 {
 	libinput->timer.fd = timerfd_create(CLOCK_MONOTONIC,
 					    TFD_CLOEXEC | TFD_NONBLOCK);
 	if (libinput->timer.fd < 0)
 		return -1;
 
-	list_init(&libinput->timer.list);
-
 	libinput->timer.source = libinput_add_fd(libinput,
 						 libinput->timer.fd,
 						 libinput_timer_handler,
 						 libinput);
 	if (!libinput->timer.source) {
 		close(libinput->timer.fd);
+		libinput->timer.fd = -1;
+		return -1;
+	}
+
+	libinput->timer.armed = 0;
+	libinput_timer_arm_timer_fd(libinput);
+
+	return 0;
+}
+
+static void
+libinput_timer_fd_destroy(struct libinput *libinput)
+{
+	libinput_remove_source(libinput, libinput->timer.source);
+	libinput->timer.source = NULL;
+	close(libinput->timer.fd);
+	libinput->timer.fd = -1;
+	libinput->timer.armed = 0;
+}
+
+int
+libinput_timer_set_fd_enabled(struct libinput *libinput, bool enabled)
+{
+	if (enabled == (libinput->timer.fd != -1))
+		return 0;
+
+	if (enabled && libinput->clock.func)
+		return -1;
+
+	if (!enabled) {
+		libinput_timer_fd_destroy(libinput);
+		return 0;
+	}
+
+	return libinput_timer_fd_init(libinput);
+}
+
+int
+libinput_timer_subsys_init(struct libinput *libinput)
+{
+	list_init(&libinput->timer.deferred);
+
+	libinput->timer.heap_len = 16;
+	libinput->timer.heap = libinput_calloc(libinput,
+					       libinput->timer.heap_len,
+					       sizeof(*libinput->timer.heap));
+	if (!libinput->timer.heap)
+		return -1;
+
+	if (libinput_timer_fd_init(libinput) != 0) {
+		libinput_free(libinput, libinput->timer.heap);
 		return -1;
 	}
 
@@ -151,8 +420,9 @@ void
 libinput_timer_subsys_destroy(struct libinput *libinput)
 {
 	/* All timer users should have destroyed their timers now */
-	assert(list_empty(&libinput->timer.list));
+	assert(libinput->timer.count == 0);
 
-	libinput_remove_source(libinput, libinput->timer.source);
-	close(libinput->timer.fd);
+	if (libinput->timer.fd != -1)
+		libinput_timer_fd_destroy(libinput);
+	libinput_free(libinput, libinput->timer.heap);
 }
@@ -23,6 +23,7 @@
 #ifndef TIMER_H
 #define TIMER_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "libinput-util.h"
@@ -31,8 +32,14 @@ struct libinput;
 
 struct libinput_timer {
 	struct libinput *libinput;
-	struct list link;
-	uint64_t expire; /* in absolute ms CLOCK_MONOTONIC */
+	size_t heap_index;
+	uint64_t expire; /* in absolute us CLOCK_MONOTONIC */
+	/* last fire time and dispatch round, simulated clock only */
+	uint64_t fired;
+	unsigned int fired_round;
+	/* out of the heap until the end of the round, simulated clock only */
+	bool deferred;
+	struct list deferred_link;
 	void (*timer_func)(uint64_t now, void *timer_func_data);
 	void *timer_func_data;
 };
@@ -42,13 +49,24 @@ libinput_timer_init(struct libinput_timer *timer, struct libinput *libinput,
 		    void (*timer_func)(uint64_t now, void *timer_func_data),
 		    void *timer_func_data);
 
-/* Set timer expire time, in absolute ms CLOCK_MONOTONIC */
+/* Set timer expire time, in absolute us CLOCK_MONOTONIC */
 void
 libinput_timer_set(struct libinput_timer *timer, uint64_t expire);
 
 void
 libinput_timer_cancel(struct libinput_timer *timer);
 
+/* Fire all timers that expired */
+void
+libinput_timer_dispatch(struct libinput *libinput);
+
+/* Earliest expiry in absolute us CLOCK_MONOTONIC, or 0 if none is set */
+uint64_t
+libinput_timer_next_expiry(struct libinput *libinput);
+
+int
+libinput_timer_set_fd_enabled(struct libinput *libinput, bool enabled);
+
 int
 libinput_timer_subsys_init(struct libinput *libinput);
 
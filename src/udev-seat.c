@@ -29,6 +29,7 @@
 #include <fcntl.h>
 
 #include "evdev.h"
+#include "input-thread.h"
 #include "udev-seat.h"
 
 static const char default_seat[] = "seat0";
@@ -115,7 +116,8 @@ device_added(struct udev_device *udev_device,
 
 	output_name = udev_device_get_property_value(udev_device, "WL_OUTPUT");
 	if (output_name)
-		device->output_name = strdup(output_name);
+		device->output_name = libinput_strdup(&input->base,
+						      output_name);
 
 	return 0;
 }
@@ -180,8 +182,8 @@ udev_input_add_devices(struct udev_input *input, struct udev *udev)
 	return 0;
 }
 
-static void
-evdev_udev_handler(void *data)
+static bool
+evdev_udev_handler(void *data, unsigned int budget)
 {
 	struct udev_input *input = data;
 	struct udev_device *udev_device;
@@ -189,7 +191,7 @@ evdev_udev_handler(void *data)
 
 	udev_device = udev_monitor_receive_device(input->udev_monitor);
 	if (!udev_device)
-		return;
+		return false;
 
 	action = udev_device_get_action(udev_device);
 	if (!action)
@@ -205,6 +207,8 @@ evdev_udev_handler(void *data)
 
 out:
 	udev_device_unref(udev_device);
+
+	return false;
 }
 
 static void
@@ -294,14 +298,14 @@ udev_input_destroy(struct libinput *input)
 		return;
 
 	udev_unref(udev_input->udev);
-	free(udev_input->seat_id);
+	libinput_free(input, udev_input->seat_id);
 }
 
 static void
 udev_seat_destroy(struct libinput_seat *seat)
 {
 	struct udev_seat *useat = (struct udev_seat*)seat;
-	free(useat);
+	libinput_free(seat->libinput, useat);
 }
 
 static struct udev_seat *
@@ -311,7 +315,7 @@ udev_seat_create(struct udev_input *input,
 {
 	struct udev_seat *seat;
 
-	seat = zalloc(sizeof *seat);
+	seat = libinput_zalloc(&input->base, sizeof *seat);
 	if (!seat)
 		return NULL;
 
@@ -364,20 +368,34 @@ LIBINPUT_EXPORT struct libinput *
 libinput_udev_create_context(const struct libinput_interface *interface,
 			     void *user_data,
 			     struct udev *udev)
+{
+	return libinput_udev_create_context_with_allocator(interface,
+							   user_data,
+							   udev,
+							   NULL);
+}
+
+LIBINPUT_EXPORT struct libinput *
+libinput_udev_create_context_with_allocator(
+				const struct libinput_interface *interface,
+				void *user_data,
+				struct udev *udev,
+				const struct libinput_allocator *allocator)
 {
 	struct udev_input *input;
+	struct mem_allocator mem;
 
 	if (!interface || !udev)
 		return NULL;
 
-	input = zalloc(sizeof *input);
+	mem_allocator_init(&mem, allocator);
+	input = mem_zalloc(&mem, sizeof *input);
 	if (!input)
 		return NULL;
 
-	if (libinput_init(&input->base, interface,
+	if (libinput_init(&input->base, &mem, interface,
 			  &interface_backend, user_data) != 0) {
-		libinput_unref(&input->base);
-		free(input);
+		mem_free(&mem, input);
 		return NULL;
 	}
 
@@ -391,6 +409,7 @@ libinput_udev_assign_seat(struct libinput *libinput,
 			  const char *seat_id)
 {
 	struct udev_input *input = (struct udev_input*)libinput;
+	libinput_lock_scope(libinput);
 
 	if (!seat_id)
 		return -1;
@@ -402,7 +421,7 @@ libinput_udev_assign_seat(struct libinput *libinput,
 		return -1;
 	}
 
-	input->seat_id = strdup(seat_id);
+	input->seat_id = libinput_strdup(libinput, seat_id);
 
 	if (udev_input_enable(&input->base) < 0)
 		return -1;
@@ -0,0 +1,76 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef LIBINPUT_USDT_H
+#define LIBINPUT_USDT_H
+
+/*
+ * USDT static tracepoints for perf, bpftrace and systemtap, e.g.
+ *   bpftrace -e 'usdt:.libs/libinput.so:libinput:post_event {
+ *                    printf("%s %d\n", str(arg0), arg1); }'
+ *
+ * A disabled probe is a single nop, but its arguments are computed
+ * regardless. Where that is more than a load, guard the probe with
+ * usdt_probe_enabled(), which reads the probe's semaphore and is only
+ * true while a tracer is attached. Without sys/sdt.h (see configure's
+ * --enable-usdt-probes) the probes compile to nothing.
+ *
+ * Probes, all times in microseconds on CLOCK_MONOTONIC:
+ *   dispatch_entry(sysname, budget)
+ *   dispatch_exit(sysname, evdev_events, yielded)
+ *   flush_pending(sysname, pending_event, time)
+ *   post_event(sysname, event_type, time)
+ *   get_event(sysname, event_type, time, now)
+ *   timer_fire(expire, now)
+ *   tap_state(sysname, from, event, to)
+ *   button_state(sysname, touch_index, from, event, to)
+ *   middlebutton_state(sysname, from, event, to)
+ * sysname is NULL for events that have no device.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_USDT_PROBES
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+/* One per probe, defined in libinput.c */
+#define USDT_SEMAPHORE(name_) libinput_##name_##_semaphore
+extern unsigned short USDT_SEMAPHORE(dispatch_entry);
+extern unsigned short USDT_SEMAPHORE(dispatch_exit);
+extern unsigned short USDT_SEMAPHORE(flush_pending);
+extern unsigned short USDT_SEMAPHORE(post_event);
+extern unsigned short USDT_SEMAPHORE(get_event);
+extern unsigned short USDT_SEMAPHORE(timer_fire);
+extern unsigned short USDT_SEMAPHORE(tap_state);
+extern unsigned short USDT_SEMAPHORE(button_state);
+extern unsigned short USDT_SEMAPHORE(middlebutton_state);
+
+#define usdt_probe(name_, ...) STAP_PROBEV(libinput, name_, __VA_ARGS__)
+#define usdt_probe_enabled(name_) \
+	__builtin_expect(USDT_SEMAPHORE(name_) != 0, 0)
+#else
+#define usdt_probe(name_, ...) do { } while (0)
+#define usdt_probe_enabled(name_) 0
+#endif
+
+#endif
@@ -0,0 +1,489 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+
+#include "libinput-private.h"
+#include "worker-pool.h"
+
+/* Upper limit for libinput_set_worker_threads() */
+#define WORKERS_MAX 64
+
+/* A set of devices that must be processed on the same thread, because
+ * the events of one are fed to another through an event listener */
+struct worker_task {
+	size_t first;	/* index into workers->sources */
+	size_t count;
+};
+
+/* The tasks of one participant, others steal from here once their own
+ * queue is empty */
+struct worker_queue {
+	size_t next;	/* accessed atomically */
+	size_t end;
+};
+
+/* A ready source and the group of its device, sorted to form the tasks */
+struct worker_slot {
+	struct libinput_device *group;
+	struct libinput_source *source;
+	size_t index;	/* position in ep, keeps the dispatch order */
+};
+
+struct worker_thread {
+	struct libinput_workers *workers;
+	pthread_t thread;
+	unsigned int index;
+};
+
+struct libinput_workers {
+	struct libinput *libinput;
+	struct worker_thread *threads;
+	unsigned int nthreads;
+
+	pthread_mutex_t round_lock;
+	pthread_cond_t round_start;
+	pthread_cond_t round_done;
+	unsigned int generation;
+	unsigned int busy;
+	bool stop;
+
+	/* Shared state, see libinput_workers_lock() */
+	pthread_mutex_t lock;
+
+	/* device->worker_group is up to date */
+	bool groups_valid;
+
+	/* The current round. The dispatching thread participates as
+	 * index nthreads, so there are nthreads + 1 queues */
+	struct libinput_source **sources;
+	struct worker_slot *slots;
+	struct worker_task *tasks;
+	size_t len;
+	size_t ntasks;
+	struct worker_queue *queues;
+};
+
+static __thread bool in_worker;
+
+bool
+libinput_workers_in_worker(void)
+{
+	return in_worker;
+}
+
+void
+libinput_workers_lock(struct libinput *libinput)
+{
+	if (libinput->parallel_dispatch)
+		pthread_mutex_lock(&libinput->workers->lock);
+}
+
+void
+libinput_workers_unlock(struct libinput *libinput)
+{
+	if (libinput->parallel_dispatch)
+		pthread_mutex_unlock(&libinput->workers->lock);
+}
+
+static void
+workers_run_task(struct libinput_workers *workers,
+		 struct worker_task *task)
+{
+	size_t i;
+
+	for (i = task->first; i < task->first + task->count; i++)
+		libinput_source_dispatch(workers->sources[i], 0);
+}
+
+static void
+workers_participate(struct libinput_workers *workers, unsigned int index)
+{
+	unsigned int nqueues = workers->nthreads + 1;
+	struct worker_queue *queue;
+	unsigned int q;
+	size_t task;
+
+	/* Own queue first, then steal from the others */
+	for (q = 0; q < nqueues; q++) {
+		queue = &workers->queues[(index + q) % nqueues];
+
+		while (true) {
+			task = __atomic_fetch_add(&queue->next, 1,
+						  __ATOMIC_RELAXED);
+			if (task >= queue->end)
+				break;
+
+			workers_run_task(workers, &workers->tasks[task]);
+		}
+	}
+}
+
+static void *
+workers_thread_main(void *data)
+{
+	struct worker_thread *thread = data;
+	struct libinput_workers *workers = thread->workers;
+	unsigned int generation = 0;
+
+	in_worker = true;
+
+	pthread_mutex_lock(&workers->round_lock);
+	while (true) {
+		while (!workers->stop && workers->generation == generation)
+			pthread_cond_wait(&workers->round_start,
+					  &workers->round_lock);
+		if (workers->stop)
+			break;
+
+		generation = workers->generation;
+		pthread_mutex_unlock(&workers->round_lock);
+
+		workers_participate(workers, thread->index);
+
+		pthread_mutex_lock(&workers->round_lock);
+		if (--workers->busy == 0)
+			pthread_cond_signal(&workers->round_done);
+	}
+	pthread_mutex_unlock(&workers->round_lock);
+
+	return NULL;
+}
+
+static bool
+workers_reserve(struct libinput_workers *workers, size_t count)
+{
+	struct libinput_source **sources;
+	struct worker_task *tasks;
+	struct worker_slot *slots;
+	size_t len = workers->len;
+
+	if (count <= len)
+		return true;
+
+	while (len < count)
+		len = len ? len * 2 : 16;
+
+	sources = libinput_realloc(workers->libinput,
+				   workers->sources,
+				   len * sizeof *sources);
+	if (!sources)
+		return false;
+	workers->sources = sources;
+
+	slots = libinput_realloc(workers->libinput,
+				 workers->slots,
+				 len * sizeof *slots);
+	if (!slots)
+		return false;
+	workers->slots = slots;
+
+	tasks = libinput_realloc(workers->libinput,
+				 workers->tasks,
+				 len * sizeof *tasks);
+	if (!tasks)
+		return false;
+	workers->tasks = tasks;
+
+	workers->len = len;
+
+	return true;
+}
+
+static struct libinput_device *
+workers_find(struct libinput_device *device)
+{
+	while (device->worker_group != device) {
+		device->worker_group = device->worker_group->worker_group;
+		device = device->worker_group;
+	}
+
+	return device;
+}
+
+static void
+workers_union(struct libinput_device *a, struct libinput_device *b)
+{
+	a = workers_find(a);
+	b = workers_find(b);
+	if (a != b)
+		b->worker_group = a;
+}
+
+/* A device is linked to the owner of each of its event listeners, the
+ * events of one may end up in the state of the other. Only rebuilt after
+ * libinput_workers_invalidate_groups() */
+static void
+workers_build_groups(struct libinput_workers *workers)
+{
+	struct libinput *libinput = workers->libinput;
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	struct libinput_event_listener *listener;
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link)
+			device->worker_group = device;
+	}
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			list_for_each(listener,
+				      &device->event_listeners,
+				      link)
+				workers_union(device, listener->owner);
+		}
+	}
+
+	/* Flatten, worker_group is the group's first device from here */
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link)
+			device->worker_group = workers_find(device);
+	}
+
+	workers->groups_valid = true;
+}
+
+static int
+workers_slot_cmp(const void *pa, const void *pb)
+{
+	const struct worker_slot *a = pa, *b = pb;
+
+	if (a->group != b->group)
+		return (uintptr_t)a->group < (uintptr_t)b->group ? -1 : 1;
+
+	return a->index < b->index ? -1 : a->index > b->index;
+}
+
+static void
+workers_build_tasks(struct libinput_workers *workers, size_t count)
+{
+	struct worker_slot *slots = workers->slots;
+	struct worker_task *task = NULL;
+	size_t i;
+	unsigned int q, nqueues = workers->nthreads + 1;
+
+	/* Sort the sources by group, each group becomes one task. Sources
+	 * of the same group keep their dispatch order */
+	qsort(slots, count, sizeof *slots, workers_slot_cmp);
+
+	workers->ntasks = 0;
+	for (i = 0; i < count; i++) {
+		workers->sources[i] = slots[i].source;
+
+		if (!task || slots[i].group != slots[i - 1].group) {
+			task = &workers->tasks[workers->ntasks++];
+			task->first = i;
+			task->count = 0;
+		}
+		task->count++;
+	}
+
+	for (q = 0; q < nqueues; q++) {
+		workers->queues[q].next = q * workers->ntasks / nqueues;
+		workers->queues[q].end = (q + 1) * workers->ntasks / nqueues;
+	}
+}
+
+void
+libinput_workers_invalidate_groups(struct libinput *libinput)
+{
+	if (libinput->workers)
+		libinput->workers->groups_valid = false;
+}
+
+int
+libinput_workers_dispatch(struct libinput *libinput,
+			  struct epoll_event *ep,
+			  int count)
+{
+	struct libinput_workers *workers = libinput->workers;
+	struct libinput_source *source;
+	struct libinput_device *device;
+	struct worker_slot *slot;
+	size_t ndevices = 0;
+	int i, remaining = 0;
+
+	if (!workers_reserve(workers, count))
+		return count;
+
+	if (!workers->groups_valid)
+		workers_build_groups(workers);
+
+	for (i = 0; i < count; i++) {
+		source = ep[i].data.ptr;
+		device = libinput_source_get_device(source);
+		if (!device)
+			continue;
+
+		slot = &workers->slots[ndevices++];
+		slot->group = device->worker_group;
+		slot->source = source;
+		slot->index = i;
+	}
+
+	/* Not worth waking anyone up for a single device */
+	if (ndevices < 2)
+		return count;
+
+	for (i = 0; i < count; i++) {
+		source = ep[i].data.ptr;
+		if (!libinput_source_get_device(source))
+			ep[remaining++] = ep[i];
+	}
+
+	workers_build_tasks(workers, ndevices);
+
+	libinput->parallel_dispatch = true;
+
+	pthread_mutex_lock(&workers->round_lock);
+	workers->generation++;
+	workers->busy = workers->nthreads;
+	pthread_cond_broadcast(&workers->round_start);
+	pthread_mutex_unlock(&workers->round_lock);
+
+	workers_participate(workers, workers->nthreads);
+
+	pthread_mutex_lock(&workers->round_lock);
+	while (workers->busy > 0)
+		pthread_cond_wait(&workers->round_done, &workers->round_lock);
+	pthread_mutex_unlock(&workers->round_lock);
+
+	libinput->parallel_dispatch = false;
+
+	libinput_flush_staged_events(libinput);
+
+	return remaining;
+}
+
+static void
+libinput_workers_destroy(struct libinput_workers *workers,
+			 unsigned int nthreads)
+{
+	struct libinput *libinput = workers->libinput;
+	unsigned int i;
+
+	pthread_mutex_lock(&workers->round_lock);
+	workers->stop = true;
+	pthread_cond_broadcast(&workers->round_start);
+	pthread_mutex_unlock(&workers->round_lock);
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(workers->threads[i].thread, NULL);
+
+	pthread_cond_destroy(&workers->round_done);
+	pthread_cond_destroy(&workers->round_start);
+	pthread_mutex_destroy(&workers->round_lock);
+	pthread_mutex_destroy(&workers->lock);
+
+	libinput_free(libinput, workers->queues);
+	libinput_free(libinput, workers->tasks);
+	libinput_free(libinput, workers->slots);
+	libinput_free(libinput, workers->sources);
+	libinput_free(libinput, workers->threads);
+	libinput_free(libinput, workers);
+}
+
+static struct libinput_workers *
+libinput_workers_create(struct libinput *libinput, unsigned int count)
+{
+	struct libinput_workers *workers;
+	pthread_mutexattr_t attr;
+	unsigned int i;
+
+	workers = libinput_zalloc(libinput, sizeof *workers);
+	if (!workers)
+		return NULL;
+
+	workers->libinput = libinput;
+	workers->nthreads = count;
+	workers->threads = libinput_calloc(libinput,
+					   count,
+					   sizeof *workers->threads);
+	workers->queues = libinput_calloc(libinput,
+					  count + 1,
+					  sizeof *workers->queues);
+	if (!workers->threads || !workers->queues) {
+		libinput_free(libinput, workers->threads);
+		libinput_free(libinput, workers->queues);
+		libinput_free(libinput, workers);
+		return NULL;
+	}
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&workers->lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	pthread_mutex_init(&workers->round_lock, NULL);
+	pthread_cond_init(&workers->round_start, NULL);
+	pthread_cond_init(&workers->round_done, NULL);
+
+	for (i = 0; i < count; i++) {
+		workers->threads[i].workers = workers;
+		workers->threads[i].index = i;
+		if (pthread_create(&workers->threads[i].thread, NULL,
+				   workers_thread_main,
+				   &workers->threads[i]) != 0) {
+			libinput_workers_destroy(workers, i);
+			return NULL;
+		}
+	}
+
+	return workers;
+}
+
+int
+libinput_workers_set_count(struct libinput *libinput, unsigned int count)
+{
+	struct libinput_workers *workers = NULL;
+
+	if (count > WORKERS_MAX)
+		return -1;
+
+	if (libinput_workers_get_count(libinput) == count)
+		return 0;
+
+	if (count > 0) {
+		workers = libinput_workers_create(libinput, count);
+		if (!workers)
+			return -1;
+	}
+
+	if (libinput->workers)
+		libinput_workers_destroy(libinput->workers,
+					 libinput->workers->nthreads);
+	libinput->workers = workers;
+
+	return 0;
+}
+
+unsigned int
+libinput_workers_get_count(struct libinput *libinput)
+{
+	return libinput->workers ? libinput->workers->nthreads : 0;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <stdbool.h>
+
+struct epoll_event;
+struct libinput;
+struct libinput_source;
+
+int
+libinput_workers_set_count(struct libinput *libinput, unsigned int count);
+
+unsigned int
+libinput_workers_get_count(struct libinput *libinput);
+
+/*
+ * Dispatch the ready device sources in ep on the worker pool. The
+ * remaining sources are moved to the front of ep, returns their number.
+ */
+int
+libinput_workers_dispatch(struct libinput *libinput,
+			  struct epoll_event *ep,
+			  int count);
+
+/*
+ * Drop the cached grouping of the devices, called whenever a device is
+ * added or removed or an event listener couples two devices.
+ */
+void
+libinput_workers_invalidate_groups(struct libinput *libinput);
+
+/* true if called from one of the pool's worker threads */
+bool
+libinput_workers_in_worker(void);
+
+/*
+ * Protects state shared between devices while the pool processes them
+ * in parallel. Both are no-ops outside of a parallel round. The lock is
+ * recursive.
+ */
+void
+libinput_workers_lock(struct libinput *libinput);
+
+void
+libinput_workers_unlock(struct libinput *libinput);
+
+#endif
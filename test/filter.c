@@ -0,0 +1,434 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <check.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter.h"
+#include "litest.h"
+
+/* A copy of the pointer accelerator as it was before the trackers were
+ * rearranged into arrays. Every tracker accumulates the deltas on its
+ * own, the accelerator has to match this bit for bit. The profile comes from
+ * the filter's lookup table, that's tested separately. */
+#define REF_MAX_VELOCITY_DIFF	1.0 /* units/ms */
+#define REF_MOTION_TIMEOUT	ms2us(300)
+#define REF_NUM_TRACKERS	16
+
+struct ref_tracker {
+	struct normalized_coords delta;
+	uint64_t time;
+	int dir;
+};
+
+struct ref_accelerator {
+	struct motion_filter *params; /* for the profile only */
+	double last_velocity;
+	struct ref_tracker trackers[REF_NUM_TRACKERS];
+	int cur_tracker;
+
+	/* how close the last two velocity calculations came to stopping
+	 * at a different tracker, in units/ms */
+	double margin, last_margin;
+};
+
+static void
+ref_feed_trackers(struct ref_accelerator *accel,
+		  const struct normalized_coords *delta,
+		  uint64_t time)
+{
+	struct ref_tracker *trackers = accel->trackers;
+	int i, current;
+
+	for (i = 0; i < REF_NUM_TRACKERS; i++) {
+		trackers[i].delta.x += delta->x;
+		trackers[i].delta.y += delta->y;
+	}
+
+	current = (accel->cur_tracker + 1) % REF_NUM_TRACKERS;
+	accel->cur_tracker = current;
+
+	trackers[current].delta.x = 0.0;
+	trackers[current].delta.y = 0.0;
+	trackers[current].time = time;
+	trackers[current].dir = normalized_get_direction(*delta);
+}
+
+static struct ref_tracker *
+ref_tracker_by_offset(struct ref_accelerator *accel, unsigned int offset)
+{
+	unsigned int index =
+		(accel->cur_tracker + REF_NUM_TRACKERS - offset)
+		% REF_NUM_TRACKERS;
+	return &accel->trackers[index];
+}
+
+static double
+ref_calculate_velocity(struct ref_accelerator *accel, uint64_t time)
+{
+	struct ref_tracker *tracker;
+	double velocity;
+	double result = 0.0;
+	double initial_velocity = 0.0;
+	unsigned int offset;
+	unsigned int dir = ref_tracker_by_offset(accel, 0)->dir;
+
+	accel->last_margin = accel->margin;
+	accel->margin = HUGE_VAL;
+
+	for (offset = 1; offset < REF_NUM_TRACKERS; offset++) {
+		tracker = ref_tracker_by_offset(accel, offset);
+
+		if (time - tracker->time > REF_MOTION_TIMEOUT ||
+		    tracker->time > time)
+			break;
+
+		dir &= tracker->dir;
+		if (dir == 0)
+			break;
+
+		velocity = normalized_length(tracker->delta) /
+			   (double)(time - tracker->time + 1) * 1000;
+
+		if (initial_velocity == 0.0) {
+			accel->margin = fmin(accel->margin, velocity);
+			result = initial_velocity = velocity;
+		} else {
+			accel->margin = fmin(accel->margin,
+					     fabs(fabs(initial_velocity - velocity) -
+						  REF_MAX_VELOCITY_DIFF));
+			if (fabs(initial_velocity - velocity) >
+			    REF_MAX_VELOCITY_DIFF)
+				break;
+
+			result = velocity;
+		}
+	}
+
+	return result;
+}
+
+static struct normalized_coords
+ref_filter(struct ref_accelerator *accel,
+	   const struct normalized_coords *unaccelerated,
+	   uint64_t time)
+{
+	struct motion_filter *params = accel->params;
+	struct normalized_coords accelerated;
+	double velocity, factor;
+
+	ref_feed_trackers(accel, unaccelerated, time);
+	velocity = ref_calculate_velocity(accel, time);
+
+	factor = pointer_accel_lookup(params, NULL, velocity, time);
+	factor += pointer_accel_lookup(params, NULL,
+				       accel->last_velocity, time);
+	factor += 4.0 *
+		pointer_accel_lookup(params, NULL,
+				     (accel->last_velocity + velocity) / 2,
+				     time);
+	factor = factor / 6.0;
+
+	accelerated.x = factor * unaccelerated->x;
+	accelerated.y = factor * unaccelerated->y;
+
+	accel->last_velocity = velocity;
+
+	return accelerated;
+}
+
+struct deviation {
+	bool identical;	/* bitwise */
+	double max;	/* largest relative difference */
+	int over;	/* deltas with a factor more than 12/65536 off */
+	int ambiguous;	/* deltas left out, see compare_to_reference() */
+};
+
+/* Feeds the same motion to the accelerator and the reference, with
+ * integer deltas multiplied by scale */
+static void
+compare_to_reference(double speed, double scale, unsigned int seed,
+		     struct deviation *dev)
+{
+	struct motion_filter *filter, *params;
+	struct ref_accelerator ref;
+	struct normalized_coords delta, out, expected;
+	uint64_t time = ms2us(1000);
+	double diff;
+	int dx = 1, dy = 0;
+	int i;
+
+	filter = create_pointer_accelerator_filter(pointer_accel_profile_linear,
+						   NULL);
+	params = create_pointer_accelerator_filter(pointer_accel_profile_linear,
+						   NULL);
+	ck_assert_notnull(filter);
+	ck_assert_notnull(params);
+	ck_assert(filter_set_speed(filter, speed));
+	ck_assert(filter_set_speed(params, speed));
+
+	memset(&ref, 0, sizeof(ref));
+	ref.params = params;
+	ref.margin = HUGE_VAL;
+
+	dev->identical = true;
+	dev->max = 0.0;
+	dev->over = 0;
+	dev->ambiguous = 0;
+
+	srand(seed);
+
+	for (i = 0; i < 20000; i++) {
+		/* long strokes in one direction with the odd turn, change in
+		 * speed and pause */
+		if (rand() % 32 == 0) {
+			dx = rand() % 41 - 20;
+			dy = rand() % 41 - 20;
+		}
+		if (rand() % 100 == 0)
+			time += ms2us(100 + rand() % 300);
+		time += ms2us(1 + rand() % 8) + rand() % 500;
+
+		delta.x = (dx + rand() % 3 - 1) * scale;
+		delta.y = (dy + rand() % 3 - 1) * scale;
+
+		out = filter_dispatch(filter, &delta, NULL, time);
+		expected = ref_filter(&ref, &delta, time);
+
+#ifdef HAVE_FIXED_POINT
+		/* A velocity this close to a limit of the tracker scan may
+		 * round to the other side of it. The scan then stops at a
+		 * different tracker and the delta, and the next one that
+		 * uses it as last velocity, are accelerated differently */
+		if (fmin(ref.margin, ref.last_margin) < 1e-3) {
+			dev->ambiguous++;
+			continue;
+		}
+#endif
+
+		if (memcmp(&out, &expected, sizeof(out)) == 0)
+			continue;
+
+		dev->identical = false;
+		diff = fmax(fabs(out.x - expected.x) /
+			    fmax(fabs(expected.x), 1e-6),
+			    fabs(out.y - expected.y) /
+			    fmax(fabs(expected.y), 1e-6));
+		dev->max = fmax(dev->max, diff);
+		if (fabs(out.x - expected.x) >
+		    (12 * fabs(delta.x) + 2) / FIXED_ONE ||
+		    fabs(out.y - expected.y) >
+		    (12 * fabs(delta.y) + 2) / FIXED_ONE)
+			dev->over++;
+	}
+
+	filter_destroy(params);
+	filter_destroy(filter);
+}
+
+#ifndef HAVE_FIXED_POINT
+START_TEST(filter_matches_reference)
+{
+	/* 1000, 1600, 800, 400, 3200 and 1200 dpi and a touchpad-like
+	 * scale, the output must be bitwise identical for all of them */
+	const double scales[] = { 1.0, 0.625, 1.25, 2.5, 0.3125,
+				  1000.0/1200.0, 0.0719 };
+	const double speeds[] = { -1.0, -0.5, 0.0, 0.3, 1.0 };
+	struct deviation dev;
+	unsigned int i, j;
+
+	for (i = 0; i < ARRAY_LENGTH(scales); i++) {
+		for (j = 0; j < ARRAY_LENGTH(speeds); j++) {
+			compare_to_reference(speeds[j], scales[i],
+					     i * 10 + j, &dev);
+			ck_assert(dev.identical);
+		}
+	}
+}
+END_TEST
+#else
+START_TEST(filter_fixed_point_deviation)
+{
+	const double scales[] = { 1.0, 0.625, 1.25, 2.5, 0.3125,
+				  1000.0/1200.0, 0.0719 };
+	const double speeds[] = { -1.0, -0.5, 0.0, 0.3, 1.0 };
+	struct deviation dev;
+	unsigned int i, j;
+
+	/* The velocities are within 2/65536 units/ms. The steepest profile
+	 * slope is 5 per unit/ms, Simpson's rule weighs the velocity with
+	 * 1/2, so the factor is within 10/65536 plus the rounding of the
+	 * profile and the sum. The output adds the rounding of the delta
+	 * and of the product.
+	 *
+	 * That's no relative bound, a slow delta has a factor close to 0.
+	 * For a factor of 0.2 and up and deltas of a unit and up, it's
+	 * about 1e-3 */
+	for (i = 0; i < ARRAY_LENGTH(scales); i++) {
+		for (j = 0; j < ARRAY_LENGTH(speeds); j++) {
+			compare_to_reference(speeds[j], scales[i],
+					     i * 10 + j, &dev);
+			ck_assert_int_eq(dev.over, 0);
+			ck_assert_int_le(dev.ambiguous, 200);
+		}
+	}
+}
+END_TEST
+#endif
+
+START_TEST(filter_lookup_table)
+{
+	const accel_profile_func_t profiles[] = {
+		pointer_accel_profile_linear,
+		touchpad_accel_profile_linear,
+		touchpad_lenovo_x230_accel_profile,
+	};
+	const double speeds[] = { -1.0, -0.5, 0.0, 0.3, 1.0 };
+	struct motion_filter *filter;
+	double velocity, expected, factor;
+	unsigned int i, j;
+	int outliers;
+
+	for (i = 0; i < ARRAY_LENGTH(profiles); i++) {
+		filter = create_pointer_accelerator_filter(profiles[i], NULL);
+		ck_assert_notnull(filter);
+
+		for (j = 0; j < ARRAY_LENGTH(speeds); j++) {
+			ck_assert(filter_set_speed(filter, speeds[j]));
+
+			/* The x230 profile has a step, the interpolation
+			 * smoothes it over one table interval. Everywhere
+			 * else the error must stay small */
+			outliers = 0;
+			for (velocity = 0.0; velocity < 20.0; velocity += 0.001) {
+				expected = profiles[i](filter, NULL, velocity, 0);
+				factor = pointer_accel_lookup(filter, NULL,
+							      velocity, 0);
+				if (fabs(factor - expected) >= 0.01)
+					outliers++;
+			}
+			ck_assert_int_le(outliers, 10);
+		}
+
+		filter_destroy(filter);
+	}
+}
+END_TEST
+
+START_TEST(filter_batch_matches_scalar)
+{
+	const accel_profile_func_t profiles[] = {
+		pointer_accel_profile_linear,
+		touchpad_accel_profile_linear,
+		touchpad_lenovo_x230_accel_profile,
+	};
+	const size_t batch_sizes[] = { 1, 7, 64 };
+	struct motion_filter *filter, *batch_filter;
+	struct normalized_coords in[64], out[64], expected;
+	uint64_t times[64], time = ms2us(1000);
+	unsigned int i, j, round;
+	size_t k, n;
+
+	for (i = 0; i < ARRAY_LENGTH(profiles); i++) {
+		for (j = 0; j < ARRAY_LENGTH(batch_sizes); j++) {
+			n = batch_sizes[j];
+			filter = create_pointer_accelerator_filter(profiles[i],
+								   NULL);
+			batch_filter = create_pointer_accelerator_filter(profiles[i],
+									 NULL);
+			ck_assert_notnull(filter);
+			ck_assert_notnull(batch_filter);
+
+			srand(i * 10 + j);
+
+			for (round = 0; round < 200; round++) {
+				for (k = 0; k < n; k++) {
+					time += ms2us(1 + rand() % 12);
+					times[k] = time;
+					in[k].x = (rand() % 41 - 20) * 0.37;
+					in[k].y = (rand() % 41 - 20) * 0.37;
+				}
+
+				filter_dispatch_batch(batch_filter, in, out,
+						      times, n, NULL);
+
+				for (k = 0; k < n; k++) {
+					expected = filter_dispatch(filter,
+								   &in[k],
+								   NULL,
+								   times[k]);
+					ck_assert(memcmp(&out[k],
+							 &expected,
+							 sizeof(expected)) == 0);
+				}
+			}
+
+			filter_destroy(batch_filter);
+			filter_destroy(filter);
+		}
+	}
+}
+END_TEST
+
+START_TEST(filter_fixed_point_direction)
+{
+	struct normalized_coords norm;
+	double r;
+	int x, y;
+
+	for (x = -60; x <= 60; x++) {
+		for (y = -60; y <= 60; y++) {
+			norm.x = x * 0.37;
+			norm.y = y * 0.53;
+
+			/* skip anything right on an octant boundary, see
+			 * normalized_get_direction() */
+			r = atan2(norm.y, norm.x);
+			r = fmod(r + 2.5*M_PI, 2*M_PI) * 4*M_1_PI;
+			r -= floor(r);
+			if (fabs(r - 0.1) < 1e-3 || fabs(r - 0.9) < 1e-3)
+				continue;
+
+			ck_assert_int_eq(normalized_fixed_get_direction(
+						normalized_to_fixed(norm)),
+					 normalized_get_direction(norm));
+		}
+	}
+}
+END_TEST
+
+void
+litest_setup_tests(void)
+{
+#ifndef HAVE_FIXED_POINT
+	litest_add_no_device("filter:accelerator", filter_matches_reference);
+#else
+	litest_add_no_device("filter:accelerator", filter_fixed_point_deviation);
+#endif
+	litest_add_no_device("filter:accelerator", filter_lookup_table);
+	litest_add_no_device("filter:accelerator", filter_batch_matches_scalar);
+	litest_add_no_device("filter:accelerator", filter_fixed_point_direction);
+}
@@ -1531,6 +1531,9 @@ litest_event_type_str(struct libinput_event *event)
 	case LIBINPUT_EVENT_POINTER_AXIS:
 		str = "AXIS";
 		break;
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		str = "FRAME";
+		break;
 	case LIBINPUT_EVENT_TOUCH_DOWN:
 		str = "TOUCH DOWN";
 		break;
@@ -1841,6 +1844,17 @@ litest_assert_button_event(struct libinput *li, unsigned int button,
 	libinput_event_destroy(event);
 }
 
+struct libinput_event_pointer *
+litest_is_pointer_frame_event(struct libinput_event *event)
+{
+	enum libinput_event_type type = LIBINPUT_EVENT_POINTER_FRAME;
+
+	litest_assert(event != NULL);
+	litest_assert_int_eq(libinput_event_get_type(event), type);
+
+	return libinput_event_get_pointer_event(event);
+}
+
 struct libinput_event_touch *
 litest_is_touch_event(struct libinput_event *event,
 		      enum libinput_event_type type)
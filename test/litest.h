@@ -344,6 +344,8 @@ struct libinput_event_pointer * litest_is_axis_event(
 		       enum libinput_pointer_axis_source source);
 struct libinput_event_pointer * litest_is_motion_event(
 		       struct libinput_event *event);
+struct libinput_event_pointer * litest_is_pointer_frame_event(
+		       struct libinput_event *event);
 struct libinput_event_touch * litest_is_touch_event(
 		       struct libinput_event *event,
 		       enum libinput_event_type type);
@@ -25,6 +25,8 @@
 #include <check.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <stddef.h>
 #include <libinput.h>
 #include <libinput-util.h>
 #include <unistd.h>
@@ -330,6 +332,1134 @@ START_TEST(event_conversion_touch)
 }
 END_TEST
 
+START_TEST(event_recycling)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	void *first;
+	int i;
+
+	litest_drain_events(li);
+
+	litest_keyboard_key(dev, KEY_A, true);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	ck_assert_notnull(event);
+	first = event;
+	libinput_event_destroy(event);
+
+	/* A destroyed event goes back to the context and the next event of
+	 * the same kind re-uses its memory */
+	for (i = 0; i < 5; i++) {
+		litest_keyboard_key(dev, KEY_A, i % 2);
+		libinput_dispatch(li);
+
+		event = libinput_get_event(li);
+		litest_is_keyboard_event(event,
+					 KEY_A,
+					 i % 2 ?
+					 LIBINPUT_KEY_STATE_PRESSED :
+					 LIBINPUT_KEY_STATE_RELEASED);
+		ck_assert_ptr_eq(event, first);
+		libinput_event_destroy(event);
+	}
+}
+END_TEST
+
+START_TEST(event_pool_stats)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_stats before, after;
+	int i;
+
+	before.size = sizeof(before);
+	after.size = sizeof(after);
+
+	/* the first key event may need to grow the keyboard pool */
+	litest_keyboard_key(dev, KEY_A, true);
+	litest_keyboard_key(dev, KEY_A, false);
+	litest_drain_events(li);
+
+	libinput_get_stats(li, &before);
+	ck_assert_int_gt(before.event_pool_misses, 0);
+
+	/* Events destroyed before the next one is posted are always
+	 * served from the pool */
+	for (i = 0; i < 40; i++) {
+		litest_keyboard_key(dev, KEY_A, i % 2 == 0);
+		litest_drain_events(li);
+	}
+
+	libinput_get_stats(li, &after);
+	ck_assert_int_eq(after.event_pool_hits - before.event_pool_hits, 40);
+	ck_assert_int_eq(after.event_pool_misses, before.event_pool_misses);
+}
+END_TEST
+
+START_TEST(event_bulk_retrieval)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *events[8];
+	size_t count, i;
+
+	litest_drain_events(li);
+
+	count = libinput_get_events(li, events, ARRAY_LENGTH(events), 0);
+	ck_assert_int_eq(count, 0);
+
+	for (i = 0; i < 3; i++) {
+		litest_keyboard_key(dev, KEY_A, true);
+		litest_keyboard_key(dev, KEY_A, false);
+	}
+	libinput_dispatch(li);
+
+	count = libinput_get_events(li, events, 4, 0);
+	ck_assert_int_eq(count, 4);
+	for (i = 0; i < count; i++) {
+		litest_is_keyboard_event(events[i],
+					 KEY_A,
+					 i % 2 ?
+					 LIBINPUT_KEY_STATE_RELEASED :
+					 LIBINPUT_KEY_STATE_PRESSED);
+		libinput_event_destroy(events[i]);
+	}
+
+	count = libinput_get_events(li, events, ARRAY_LENGTH(events), 0);
+	ck_assert_int_eq(count, 2);
+	for (i = 0; i < count; i++)
+		libinput_event_destroy(events[i]);
+
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(event_bulk_retrieval_mask)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *events[8];
+	size_t count, i;
+
+	litest_drain_events(li);
+
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	libinput_dispatch(li);
+
+	/* the first event doesn't match, nothing is retrieved */
+	count = libinput_get_events(li, events, ARRAY_LENGTH(events),
+				    LIBINPUT_EVENT_GROUP_TOUCH |
+				    LIBINPUT_EVENT_GROUP_KEYBOARD);
+	ck_assert_int_eq(count, 0);
+	ck_assert_int_eq(libinput_next_event_type(li),
+			 LIBINPUT_EVENT_POINTER_BUTTON);
+
+	count = libinput_get_events(li, events, ARRAY_LENGTH(events),
+				    LIBINPUT_EVENT_GROUP_POINTER);
+	ck_assert_int_eq(count, 2);
+	for (i = 0; i < count; i++) {
+		litest_is_button_event(events[i],
+				       BTN_LEFT,
+				       i == 0 ?
+				       LIBINPUT_BUTTON_STATE_PRESSED :
+				       LIBINPUT_BUTTON_STATE_RELEASED);
+		libinput_event_destroy(events[i]);
+	}
+
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+static void
+queue_motion_events(struct litest_device *dev, int nevents)
+{
+	int i;
+
+	for (i = 0; i < nevents; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_REL, REL_Y, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+}
+
+START_TEST(event_queue_limit_drop_motion)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	int rc;
+
+	litest_drain_events(li);
+
+	rc = libinput_set_event_queue_limit(li, 2,
+				LIBINPUT_EVENT_QUEUE_DROP_OLDEST_MOTION);
+	ck_assert_int_eq(rc, 0);
+
+	queue_motion_events(dev, 5);
+	litest_button_click(dev, BTN_LEFT, true);
+	libinput_dispatch(li);
+
+	/* the button event pushes out a motion event, it never gets
+	 * dropped itself */
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+	ck_assert_int_eq(libinput_device_get_dropped_event_count(dev->libinput_device),
+			 4);
+}
+END_TEST
+
+START_TEST(event_queue_limit_drop_motion_frames)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	int rc;
+
+	litest_drain_events(li);
+
+	libinput_set_pointer_frames(li, 1);
+	rc = libinput_set_event_queue_limit(li, 2,
+				LIBINPUT_EVENT_QUEUE_DROP_OLDEST_MOTION);
+	ck_assert_int_eq(rc, 0);
+
+	/* every motion is alone in its frame, its frame goes with it */
+	queue_motion_events(dev, 5);
+	litest_button_click(dev, BTN_LEFT, true);
+	queue_motion_events(dev, 1);
+
+	/* the motion is dropped, the frame still ends the release */
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_KEY, BTN_LEFT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_pointer_frame_event(event);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_RELEASED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_pointer_frame_event(event);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+	ck_assert_int_eq(libinput_device_get_dropped_event_count(dev->libinput_device),
+			 13);
+
+	libinput_set_pointer_frames(li, 0);
+}
+END_TEST
+
+START_TEST(event_queue_limit_coalesce)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	double dx;
+	int rc;
+
+	litest_drain_events(li);
+
+	queue_motion_events(dev, 1);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	dx = libinput_event_pointer_get_dx_unaccelerated(ptrev);
+	libinput_event_destroy(event);
+
+	rc = libinput_set_event_queue_limit(li, 2,
+					    LIBINPUT_EVENT_QUEUE_COALESCE);
+	ck_assert_int_eq(rc, 0);
+
+	queue_motion_events(dev, 5);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert(libinput_event_pointer_get_dx_unaccelerated(ptrev) == dx);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert(libinput_event_pointer_get_dx_unaccelerated(ptrev) == 4 * dx);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+	ck_assert_int_eq(libinput_device_get_dropped_event_count(dev->libinput_device),
+			 3);
+}
+END_TEST
+
+START_TEST(event_queue_limit_coalesce_order)
+{
+	struct libinput *li;
+	struct litest_device *mouse1, *mouse2;
+	struct libinput_event *event;
+	int rc;
+
+	li = litest_create_context();
+	mouse1 = litest_add_device(li, LITEST_MOUSE);
+	mouse2 = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	rc = libinput_set_event_queue_limit(li, 2,
+					    LIBINPUT_EVENT_QUEUE_COALESCE);
+	ck_assert_int_eq(rc, 0);
+
+	queue_motion_events(mouse1, 1);
+	libinput_dispatch(li);
+	queue_motion_events(mouse2, 1);
+	libinput_dispatch(li);
+
+	/* mouse1's queued motion is not the tail, merging into it would
+	 * move the new motion ahead of mouse2's */
+	queue_motion_events(mouse1, 1);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	ck_assert(libinput_event_get_device(event) == mouse2->libinput_device);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	ck_assert(libinput_event_get_device(event) == mouse1->libinput_device);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+	ck_assert_int_eq(libinput_device_get_dropped_event_count(mouse1->libinput_device),
+			 1);
+
+	libinput_set_event_queue_limit(li, 0, LIBINPUT_EVENT_QUEUE_COALESCE);
+	litest_delete_device(mouse1);
+	litest_delete_device(mouse2);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(event_queue_limit_block)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	int i, rc;
+
+	litest_drain_events(li);
+
+	rc = libinput_set_event_queue_limit(li, 2,
+					    LIBINPUT_EVENT_QUEUE_BLOCK);
+	ck_assert_int_eq(rc, 0);
+
+	queue_motion_events(dev, 3);
+	ck_assert_int_eq(libinput_dispatch(li), 0);
+
+	/* queue is full, dispatch refuses to read any more */
+	queue_motion_events(dev, 1);
+	ck_assert_int_eq(libinput_dispatch(li), -EAGAIN);
+
+	for (i = 0; i < 3; i++) {
+		event = libinput_get_event(li);
+		litest_is_motion_event(event);
+		libinput_event_destroy(event);
+	}
+
+	ck_assert_int_eq(libinput_dispatch(li), 0);
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	ck_assert_int_eq(libinput_device_get_dropped_event_count(dev->libinput_device),
+			 0);
+}
+END_TEST
+
+START_TEST(event_queue_limit_block_timers)
+{
+	struct libinput *li;
+	struct litest_device *mouse, *keyboard;
+	struct libinput_event *event;
+	enum libinput_config_status status;
+	int rc;
+
+	li = litest_create_context();
+	mouse = litest_add_device(li, LITEST_MOUSE);
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+
+	status = libinput_device_config_middle_emulation_set_enabled(
+					mouse->libinput_device,
+					LIBINPUT_CONFIG_MIDDLE_EMULATION_ENABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	rc = libinput_set_event_queue_limit(li, 1,
+					    LIBINPUT_EVENT_QUEUE_BLOCK);
+	ck_assert_int_eq(rc, 0);
+
+	/* held back until the middle button emulation times out */
+	litest_button_click(mouse, BTN_LEFT, true);
+	ck_assert_int_eq(libinput_dispatch(li), 0);
+
+	litest_keyboard_key(keyboard, KEY_A, true);
+	ck_assert_int_eq(libinput_dispatch(li), 0);
+
+	/* the queue is full, the timeout still expires */
+	litest_timeout_middlebutton();
+	ck_assert_int_eq(libinput_dispatch(li), -EAGAIN);
+
+	event = libinput_get_event(li);
+	litest_is_keyboard_event(event, KEY_A, LIBINPUT_KEY_STATE_PRESSED);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	litest_is_button_event(event, BTN_LEFT, LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+
+	libinput_set_event_queue_limit(li, 0, LIBINPUT_EVENT_QUEUE_BLOCK);
+	litest_delete_device(keyboard);
+	litest_delete_device(mouse);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(event_queue_limit_invalid)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	int rc;
+
+	rc = libinput_set_event_queue_limit(li, 2, 0);
+	ck_assert_int_eq(rc, -1);
+	rc = libinput_set_event_queue_limit(li, 2,
+					    LIBINPUT_EVENT_QUEUE_BLOCK + 1);
+	ck_assert_int_eq(rc, -1);
+}
+END_TEST
+
+static void
+queue_mouse_frames(struct litest_device *dev, int nframes)
+{
+	int i;
+
+	for (i = 0; i < nframes; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+}
+
+START_TEST(dispatch_keyboard_priority)
+{
+	struct libinput *li;
+	struct litest_device *mouse, *keyboard;
+	struct libinput_event *event;
+
+	li = litest_create_context();
+	mouse = litest_add_device(li, LITEST_MOUSE);
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+
+	queue_mouse_frames(mouse, 20);
+	litest_keyboard_key(keyboard, KEY_A, true);
+
+	/* the key is queued ahead of the pointer flood */
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	litest_is_keyboard_event(event, KEY_A, LIBINPUT_KEY_STATE_PRESSED);
+	libinput_event_destroy(event);
+
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	litest_delete_device(mouse);
+	litest_delete_device(keyboard);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(dispatch_round_robin)
+{
+	struct libinput *li;
+	struct litest_device *mouse1, *mouse2;
+	struct libinput_event *event;
+	struct libinput_device *first = NULL;
+	bool interleaved = false;
+	int i;
+
+	li = litest_create_context();
+	mouse1 = litest_add_device(li, LITEST_MOUSE);
+	mouse2 = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	queue_mouse_frames(mouse1, 20);
+	queue_mouse_frames(mouse2, 20);
+
+	/* Both devices are ready, neither may process all its frames
+	 * before the other one gets its turn */
+	libinput_dispatch(li);
+	for (i = 0; i < 20; i++) {
+		event = libinput_get_event(li);
+		litest_is_motion_event(event);
+
+		if (!first)
+			first = libinput_event_get_device(event);
+		else if (libinput_event_get_device(event) != first)
+			interleaved = true;
+
+		libinput_event_destroy(event);
+	}
+	ck_assert(interleaved);
+
+	litest_drain_events(li);
+
+	litest_delete_device(mouse1);
+	litest_delete_device(mouse2);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(input_thread_events)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct pollfd fds;
+	enum libinput_config_status status;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_set_input_thread_enabled(li, 1), 0);
+	ck_assert_int_eq(libinput_get_input_thread_enabled(li), 1);
+
+	/* the context fd wakes us up once the thread processed events */
+	fds.fd = libinput_get_fd(li);
+	fds.events = POLLIN;
+	fds.revents = 0;
+
+	litest_button_click(dev, BTN_LEFT, true);
+	ck_assert_int_eq(poll(&fds, 1, 1000), 1);
+
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+
+	/* config calls are safe while the thread runs */
+	status = libinput_device_config_left_handed_set(dev->libinput_device, 1);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	status = libinput_device_config_left_handed_set(dev->libinput_device, 0);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	/* events still pending in the thread are handed over on stop */
+	litest_button_click(dev, BTN_LEFT, false);
+	ck_assert_int_eq(poll(&fds, 1, 1000), 1);
+	ck_assert_int_eq(libinput_set_input_thread_enabled(li, 0), 0);
+	ck_assert_int_eq(libinput_get_input_thread_enabled(li), 0);
+
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+
+	/* and the context works as before */
+	litest_button_click(dev, BTN_RIGHT, true);
+	litest_button_click(dev, BTN_RIGHT, false);
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_RIGHT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_button_event(li, BTN_RIGHT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(input_thread_event_pool)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_stats before, after;
+	struct pollfd fds;
+	int i;
+
+	before.size = sizeof(before);
+	after.size = sizeof(after);
+
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_set_input_thread_enabled(li, 1), 0);
+
+	fds.fd = libinput_get_fd(li);
+	fds.events = POLLIN;
+	fds.revents = 0;
+
+	litest_button_click(dev, BTN_LEFT, true);
+	ck_assert_int_eq(poll(&fds, 1, 1000), 1);
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+
+	libinput_get_stats(li, &before);
+
+	/* Events destroyed on this thread go back to the pool the input
+	 * thread allocates from */
+	for (i = 0; i < 40; i++) {
+		litest_button_click(dev, BTN_LEFT, i % 2 == 1);
+		ck_assert_int_eq(poll(&fds, 1, 1000), 1);
+		libinput_dispatch(li);
+		litest_assert_button_event(li, BTN_LEFT,
+					   i % 2 == 1 ?
+					   LIBINPUT_BUTTON_STATE_PRESSED :
+					   LIBINPUT_BUTTON_STATE_RELEASED);
+	}
+
+	libinput_get_stats(li, &after);
+	ck_assert_int_eq(after.event_pool_misses, before.event_pool_misses);
+
+	ck_assert_int_eq(libinput_set_input_thread_enabled(li, 0), 0);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(input_thread_caller_events)
+{
+	struct libinput *li;
+	struct litest_device *mouse;
+	struct libinput_event *event;
+	struct pollfd fds;
+
+	li = litest_create_context();
+	ck_assert_int_eq(libinput_set_input_thread_enabled(li, 1), 0);
+
+	fds.fd = libinput_get_fd(li);
+	fds.events = POLLIN;
+	fds.revents = 0;
+
+	/* the device added event is posted on this thread, the context
+	 * fd must be readable right away */
+	mouse = litest_add_device(li, LITEST_MOUSE);
+	ck_assert_int_eq(poll(&fds, 1, 0), 1);
+
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	ck_assert_notnull(event);
+	ck_assert_int_eq(libinput_event_get_type(event),
+			 LIBINPUT_EVENT_DEVICE_ADDED);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	/* The press is handed over by the input thread, the release and
+	 * the removal are posted on this thread. They must not overtake
+	 * the press */
+	litest_button_click(mouse, BTN_LEFT, true);
+	ck_assert_int_eq(poll(&fds, 1, 1000), 1);
+	litest_delete_device(mouse);
+	ck_assert_int_eq(poll(&fds, 1, 0), 1);
+
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+	event = libinput_get_event(li);
+	ck_assert_notnull(event);
+	ck_assert_int_eq(libinput_event_get_type(event),
+			 LIBINPUT_EVENT_DEVICE_REMOVED);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(worker_threads_events)
+{
+	struct libinput *li;
+	struct litest_device *mouse1, *mouse2, *mouse3;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	uint64_t time, last = 0;
+	int i;
+
+	li = litest_create_context();
+	mouse1 = litest_add_device(li, LITEST_MOUSE);
+	mouse2 = litest_add_device(li, LITEST_MOUSE);
+	mouse3 = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_set_worker_threads(li, 2), 0);
+	ck_assert_int_eq(libinput_get_worker_threads(li), 2);
+
+	queue_mouse_frames(mouse1, 20);
+	queue_mouse_frames(mouse2, 20);
+	queue_mouse_frames(mouse3, 20);
+
+	/* all events arrive, merged by timestamp */
+	libinput_dispatch(li);
+	for (i = 0; i < 60; i++) {
+		event = libinput_get_event(li);
+		ptrev = litest_is_motion_event(event);
+
+		time = libinput_event_pointer_get_time_usec(ptrev);
+		ck_assert_int_ge(time, last);
+		last = time;
+
+		libinput_event_destroy(event);
+	}
+	litest_assert_empty_queue(li);
+
+	ck_assert_int_eq(libinput_set_worker_threads(li, 0), 0);
+	ck_assert_int_eq(libinput_get_worker_threads(li), 0);
+
+	queue_mouse_frames(mouse1, 1);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	litest_delete_device(mouse1);
+	litest_delete_device(mouse2);
+	litest_delete_device(mouse3);
+	libinput_unref(li);
+}
+END_TEST
+
+struct coupled_event {
+	enum libinput_event_type type;
+	struct libinput_device *device;
+	uint32_t button;
+	enum libinput_button_state state;
+};
+
+/* Trackpoint motion around a touchpad soft-button click, the two are
+ * coupled through the touchpad's trackpoint listener. Records the
+ * events of both, returns their number */
+static int
+coupled_devices_round(struct litest_device *touchpad,
+		      struct litest_device *trackpoint,
+		      struct litest_device *mouse,
+		      struct coupled_event *recorded,
+		      int max)
+{
+	struct libinput *li = touchpad->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	struct libinput_device *device;
+	int count = 0;
+
+	litest_touch_down(touchpad, 0, 95, 90);
+	litest_drain_events(li);
+
+	litest_event(trackpoint, EV_REL, REL_X, 2);
+	litest_event(trackpoint, EV_SYN, SYN_REPORT, 0);
+	litest_button_click(touchpad, BTN_LEFT, true);
+	litest_event(trackpoint, EV_REL, REL_X, 2);
+	litest_event(trackpoint, EV_SYN, SYN_REPORT, 0);
+	litest_button_click(touchpad, BTN_LEFT, false);
+	queue_mouse_frames(mouse, 1);
+
+	libinput_dispatch(li);
+	while ((event = libinput_get_event(li))) {
+		device = libinput_event_get_device(event);
+		if (device == mouse->libinput_device) {
+			libinput_event_destroy(event);
+			continue;
+		}
+
+		ck_assert_int_lt(count, max);
+		recorded[count].type = libinput_event_get_type(event);
+		recorded[count].device = device;
+		if (recorded[count].type == LIBINPUT_EVENT_POINTER_BUTTON) {
+			ptrev = libinput_event_get_pointer_event(event);
+			recorded[count].button =
+				libinput_event_pointer_get_button(ptrev);
+			recorded[count].state =
+				libinput_event_pointer_get_button_state(ptrev);
+		}
+		count++;
+		libinput_event_destroy(event);
+	}
+
+	litest_touch_up(touchpad, 0);
+	litest_drain_events(li);
+
+	return count;
+}
+
+START_TEST(worker_threads_coupled_devices)
+{
+	struct libinput *li;
+	struct litest_device *touchpad, *trackpoint, *mouse;
+	struct libinput_event *event;
+	struct coupled_event serial[16], parallel[16];
+	int nserial, nparallel, i, j;
+
+	li = litest_create_context();
+	touchpad = litest_add_device(li,
+				     LITEST_SYNAPTICS_TRACKPOINT_BUTTONS);
+	trackpoint = litest_add_device(li, LITEST_TRACKPOINT);
+	mouse = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	memset(serial, 0, sizeof(serial));
+	memset(parallel, 0, sizeof(parallel));
+
+	nserial = coupled_devices_round(touchpad, trackpoint, mouse,
+					serial, ARRAY_LENGTH(serial));
+	ck_assert_int_eq(nserial, 4);
+
+	/* The touchpad and the trackpoint are processed by the same
+	 * worker, their events come out in the order they do without
+	 * workers, not re-sorted by timestamp */
+	ck_assert_int_eq(libinput_set_worker_threads(li, 2), 0);
+	for (i = 0; i < 3; i++) {
+		nparallel = coupled_devices_round(touchpad, trackpoint, mouse,
+						  parallel,
+						  ARRAY_LENGTH(parallel));
+		ck_assert_int_eq(nparallel, nserial);
+
+		for (j = 0; j < nserial; j++) {
+			ck_assert_int_eq(parallel[j].type, serial[j].type);
+			ck_assert_ptr_eq(parallel[j].device,
+					 serial[j].device);
+			ck_assert_int_eq(parallel[j].button,
+					 serial[j].button);
+			ck_assert_int_eq(parallel[j].state, serial[j].state);
+		}
+	}
+
+	/* Unplugging the trackpoint regroups the remaining devices */
+	litest_delete_device(trackpoint);
+	litest_drain_events(li);
+	litest_button_click(touchpad, BTN_LEFT, true);
+	litest_button_click(touchpad, BTN_LEFT, false);
+	queue_mouse_frames(mouse, 1);
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+	ck_assert_int_eq(libinput_set_worker_threads(li, 0), 0);
+
+	litest_delete_device(touchpad);
+	litest_delete_device(mouse);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(event_mask_context)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint32_t all = libinput_get_event_mask(li);
+
+	litest_drain_events(li);
+
+	libinput_set_event_mask(li, LIBINPUT_EVENT_GROUP_TOUCH);
+	ck_assert_int_eq(libinput_get_event_mask(li),
+			 LIBINPUT_EVENT_GROUP_TOUCH);
+	ck_assert_int_eq(libinput_device_get_event_mask(dev->libinput_device),
+			 LIBINPUT_EVENT_GROUP_TOUCH);
+
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	/* input from while the mask was set is not delivered */
+	libinput_set_event_mask(li, all);
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	litest_button_click(dev, BTN_RIGHT, true);
+	litest_button_click(dev, BTN_RIGHT, false);
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_RIGHT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_button_event(li, BTN_RIGHT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(event_mask_device)
+{
+	struct libinput *li;
+	struct litest_device *mouse1, *mouse2;
+	struct libinput_event *event;
+	uint32_t all;
+
+	li = litest_create_context();
+	mouse1 = litest_add_device(li, LITEST_MOUSE);
+	mouse2 = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	all = libinput_get_event_mask(li);
+
+	libinput_device_set_event_mask(mouse1->libinput_device,
+				       LIBINPUT_EVENT_GROUP_DEVICE);
+	ck_assert_int_eq(libinput_device_get_event_mask(mouse1->libinput_device),
+			 LIBINPUT_EVENT_GROUP_DEVICE);
+	ck_assert_int_eq(libinput_device_get_event_mask(mouse2->libinput_device),
+			 all);
+
+	queue_mouse_frames(mouse1, 5);
+	queue_mouse_frames(mouse2, 5);
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		litest_is_motion_event(event);
+		ck_assert(libinput_event_get_device(event) ==
+			  mouse2->libinput_device);
+		libinput_event_destroy(event);
+	}
+
+	/* the context mask applies once the override is gone */
+	libinput_set_event_mask(li, LIBINPUT_EVENT_GROUP_KEYBOARD);
+	libinput_device_reset_event_mask(mouse1->libinput_device);
+	ck_assert_int_eq(libinput_device_get_event_mask(mouse1->libinput_device),
+			 LIBINPUT_EVENT_GROUP_KEYBOARD);
+
+	queue_mouse_frames(mouse1, 5);
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	libinput_set_event_mask(li, all);
+	queue_mouse_frames(mouse1, 1);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	ck_assert(libinput_event_get_device(event) == mouse1->libinput_device);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	litest_delete_device(mouse1);
+	litest_delete_device(mouse2);
+	libinput_unref(li);
+}
+END_TEST
+
+static void
+assert_seat_key_event(struct libinput *li,
+		      struct litest_device *dev,
+		      enum libinput_key_state state,
+		      uint32_t seat_key_count)
+{
+	struct libinput_event *event;
+	struct libinput_event_keyboard *kev;
+
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	kev = litest_is_keyboard_event(event, KEY_A, state);
+	ck_assert(libinput_event_get_device(event) == dev->libinput_device);
+	ck_assert_int_eq(libinput_event_keyboard_get_seat_key_count(kev),
+			 seat_key_count);
+	libinput_event_destroy(event);
+}
+
+START_TEST(event_mask_transition)
+{
+	struct libinput *li;
+	struct litest_device *kbd1, *kbd2;
+	uint32_t all;
+
+	li = litest_create_context();
+	kbd1 = litest_add_device(li, LITEST_KEYBOARD);
+	kbd2 = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+
+	all = libinput_get_event_mask(li);
+
+	/* the keyboards are not read while masked, the press stays
+	 * buffered in the kernel */
+	libinput_set_event_mask(li, LIBINPUT_EVENT_GROUP_POINTER);
+	litest_keyboard_key(kbd1, KEY_A, true);
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	/* it is processed under the old mask and not delivered */
+	libinput_set_event_mask(li, all);
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	/* but the key is down and counts towards the seat */
+	litest_keyboard_key(kbd2, KEY_A, true);
+	assert_seat_key_event(li, kbd2, LIBINPUT_KEY_STATE_PRESSED, 2);
+	litest_keyboard_key(kbd2, KEY_A, false);
+	assert_seat_key_event(li, kbd2, LIBINPUT_KEY_STATE_RELEASED, 1);
+	litest_keyboard_key(kbd1, KEY_A, false);
+	assert_seat_key_event(li, kbd1, LIBINPUT_KEY_STATE_RELEASED, 0);
+	litest_assert_empty_queue(li);
+
+	litest_delete_device(kbd1);
+	litest_delete_device(kbd2);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(stats_counters)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_stats before, after, dbefore, dafter;
+
+	litest_drain_events(li);
+
+	before.size = sizeof(before);
+	after.size = sizeof(after);
+	dbefore.size = sizeof(dbefore);
+	dafter.size = sizeof(dafter);
+
+	libinput_get_stats(li, &before);
+	libinput_device_get_stats(dev->libinput_device, &dbefore);
+	ck_assert_int_ge(before.evdev_events, dbefore.evdev_events);
+	ck_assert_int_ge(before.events_posted, dbefore.events_posted);
+	ck_assert_int_eq(dbefore.timers_fired, 0);
+	ck_assert_int_eq(dbefore.queue_high_water, 0);
+
+	/* button press and release, each with its SYN_REPORT */
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	libinput_dispatch(li);
+
+	libinput_get_stats(li, &after);
+	libinput_device_get_stats(dev->libinput_device, &dafter);
+
+	ck_assert_int_eq(dafter.evdev_events - dbefore.evdev_events, 4);
+	ck_assert_int_eq(dafter.events_posted - dbefore.events_posted, 2);
+	ck_assert_int_eq(after.evdev_events - before.evdev_events, 4);
+	ck_assert_int_eq(after.events_posted - before.events_posted, 2);
+	ck_assert_int_eq(dafter.syn_dropped, 0);
+	ck_assert_int_ge(after.queue_high_water, 2);
+	ck_assert_int_ge(dafter.processing_time_usec,
+			 dbefore.processing_time_usec);
+
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(stats_size)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_stats stats;
+	const uint64_t marker = 0xdeadbeef;
+
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	litest_drain_events(li);
+
+	/* a caller that only knows the first two counters */
+	memset(&stats, 0, sizeof(stats));
+	stats.size = offsetof(struct libinput_stats, syn_dropped);
+	stats.syn_dropped = marker;
+	stats.processing_time_usec = marker;
+	libinput_get_stats(li, &stats);
+
+	ck_assert_int_eq(stats.size, offsetof(struct libinput_stats,
+					      syn_dropped));
+	ck_assert_int_gt(stats.evdev_events, 0);
+	ck_assert_int_gt(stats.events_posted, 0);
+	ck_assert_int_eq(stats.syn_dropped, marker);
+	ck_assert_int_eq(stats.processing_time_usec, marker);
+
+	/* size 0 is left untouched */
+	memset(&stats, 0, sizeof(stats));
+	stats.evdev_events = marker;
+	libinput_device_get_stats(dev->libinput_device, &stats);
+	ck_assert_int_eq(stats.size, 0);
+	ck_assert_int_eq(stats.evdev_events, marker);
+}
+END_TEST
+
+static uint64_t
+latency_histogram_total(struct libinput_device *device,
+			enum libinput_event_type type)
+{
+	uint64_t buckets[32];
+	uint64_t total = 0;
+	size_t i, n;
+
+	n = libinput_device_get_latency_histogram(device, type, buckets,
+						  ARRAY_LENGTH(buckets));
+	for (i = 0; i < n; i++)
+		total += buckets[i];
+
+	return total;
+}
+
+START_TEST(latency_histogram)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput *li = dev->libinput;
+	uint64_t buckets[64];
+
+	litest_drain_events(li);
+	libinput_device_reset_latency_histograms(device);
+
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_EVENT_POINTER_BUTTON),
+			 0);
+	ck_assert_int_eq(libinput_device_get_latency_histogram(device,
+						LIBINPUT_EVENT_POINTER_BUTTON,
+						buckets,
+						ARRAY_LENGTH(buckets)),
+			 32);
+	ck_assert_int_eq(libinput_device_get_latency_histogram(device,
+						LIBINPUT_EVENT_DEVICE_ADDED,
+						buckets,
+						ARRAY_LENGTH(buckets)),
+			 0);
+
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	libinput_dispatch(li);
+
+	/* recorded when the events are retrieved */
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_EVENT_POINTER_BUTTON),
+			 0);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_EVENT_POINTER_BUTTON),
+			 2);
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_EVENT_POINTER_MOTION),
+			 0);
+
+	libinput_device_reset_latency_histograms(device);
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_EVENT_POINTER_BUTTON),
+			 0);
+}
+END_TEST
+
 START_TEST(context_ref_counting)
 {
 	struct libinput *li;
@@ -349,6 +1479,99 @@ START_TEST(context_ref_counting)
 }
 END_TEST
 
+struct counting_allocator {
+	int blocks;
+	bool fail;
+};
+
+static void *
+counting_malloc(size_t size, void *user_data)
+{
+	struct counting_allocator *a = user_data;
+
+	if (a->fail)
+		return NULL;
+
+	a->blocks++;
+	return malloc(size);
+}
+
+static void *
+counting_realloc(void *ptr, size_t size, void *user_data)
+{
+	struct counting_allocator *a = user_data;
+
+	if (a->fail)
+		return NULL;
+
+	if (!ptr)
+		a->blocks++;
+	return realloc(ptr, size);
+}
+
+static void
+counting_free(void *ptr, void *user_data)
+{
+	struct counting_allocator *a = user_data;
+
+	if (ptr)
+		a->blocks--;
+	free(ptr);
+}
+
+START_TEST(context_allocator)
+{
+	struct counting_allocator a = { 0, false };
+	const struct libinput_allocator allocator = {
+		.malloc_func = counting_malloc,
+		.realloc_func = counting_realloc,
+		.free_func = counting_free,
+		.user_data = &a,
+	};
+	struct libevdev_uinput *uinput;
+	struct libinput *li;
+	struct libinput_device *device;
+	size_t empty;
+
+	uinput = create_simple_test_device("litest test device",
+					   EV_REL, REL_X,
+					   EV_REL, REL_Y,
+					   EV_KEY, BTN_LEFT,
+					   EV_KEY, BTN_RIGHT,
+					   -1, -1);
+
+	a.fail = true;
+	li = libinput_path_create_context_with_allocator(&simple_interface,
+							 NULL,
+							 &allocator);
+	ck_assert(li == NULL);
+	ck_assert_int_eq(a.blocks, 0);
+	a.fail = false;
+
+	li = libinput_path_create_context_with_allocator(&simple_interface,
+							 NULL,
+							 &allocator);
+	ck_assert_notnull(li);
+	ck_assert_int_gt(a.blocks, 0);
+	empty = libinput_get_allocated_bytes(li);
+	ck_assert_int_gt(empty, 0);
+
+	device = libinput_path_add_device(li,
+					  libevdev_uinput_get_devnode(uinput));
+	ck_assert_notnull(device);
+	ck_assert_int_gt(libinput_get_allocated_bytes(li), empty);
+
+	libinput_path_remove_device(device);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	ck_assert_ptr_eq(libinput_unref(li), NULL);
+	ck_assert_int_eq(a.blocks, 0);
+
+	libevdev_uinput_destroy(uinput);
+}
+END_TEST
+
 START_TEST(config_status_string)
 {
 	const char *strs[3];
@@ -447,6 +1670,81 @@ START_TEST(matrix_helpers)
 }
 END_TEST
 
+START_TEST(fixed_point_helpers)
+{
+	/* a 90 degree rotation of a 0..4095 device, in device coordinates */
+	const float f[6] = { 0, -1, 4096, 1, 0, 0 };
+	struct matrix m;
+	struct matrix_fixed mf;
+	double a, b;
+	int x, y, fx, fy;
+	int i;
+
+	ck_assert_int_eq(fixed_from_int(3), 3 * FIXED_ONE);
+	ck_assert_int_eq(fixed_from_double(-1.5), -3 * FIXED_ONE / 2);
+	ck_assert(fixed_to_double(fixed_from_double(0.25)) == 0.25);
+	ck_assert_int_eq(fixed_mul(fixed_from_double(1.5),
+				   fixed_from_double(-2.5)),
+			 fixed_from_double(-3.75));
+
+	for (i = 0; i < 1000; i++) {
+		a = (i % 37 - 18) * 17.3;
+		b = (i % 11 - 5) * 0.731;
+		ck_assert(fabs(fixed_to_double(fixed_hypot(fixed_from_double(a),
+							   fixed_from_double(b))) -
+			       hypot(a, b)) < 0.001);
+	}
+	ck_assert(fabs(fixed_to_double(fixed_hypot(fixed_from_int(60000),
+						   fixed_from_int(-80000))) -
+		       100000) < 1);
+
+	matrix_from_farray6(&m, f);
+	matrix_to_fixed(&m, &mf);
+	for (i = 0; i < 4096; i += 7) {
+		x = fx = i;
+		y = fy = 4095 - i;
+		matrix_mult_vec(&m, &x, &y);
+		matrix_fixed_mult_vec(&mf, &fx, &fy);
+		ck_assert_int_eq(x, fx);
+		ck_assert_int_eq(y, fy);
+	}
+}
+END_TEST
+
+START_TEST(fixed_point_calibration)
+{
+	/* scaled, sheared and offset, none of it in integers */
+	const float f[6] = { 0.7431, 0.1173, 12.37, -0.0519, 1.2087, 30.61 };
+	struct matrix m;
+	struct matrix_fixed mf;
+	double ex, ey;
+	int x, y, fx, fy;
+	int i;
+
+	matrix_from_farray6(&m, f);
+	matrix_to_fixed(&m, &mf);
+	for (i = 0; i < 4096; i += 7) {
+		x = fx = i;
+		y = fy = 4095 - i;
+		ex = i * (double)f[0] + (4095 - i) * (double)f[1] + f[2];
+		ey = i * (double)f[3] + (4095 - i) * (double)f[4] + f[5];
+		matrix_mult_vec(&m, &x, &y);
+		matrix_fixed_mult_vec(&mf, &fx, &fy);
+
+		/* The coefficients are rounded to 1/131072, that adds up
+		 * to 1/32 at most here, plus the rounding of the float
+		 * math. Both truncate, so the results may only differ
+		 * close to an integer */
+		ck_assert_int_le(abs(x - fx), 1);
+		ck_assert_int_le(abs(y - fy), 1);
+		if (x != fx)
+			ck_assert(fabs(ex - round(ex)) < 0.0625);
+		if (y != fy)
+			ck_assert(fabs(ey - round(ey)) < 0.0625);
+	}
+}
+END_TEST
+
 START_TEST(ratelimit_helpers)
 {
 	struct ratelimit rl;
@@ -592,11 +1890,38 @@ litest_setup_tests(void)
 	litest_add_for_device("events:conversion", event_conversion_pointer_abs, LITEST_XEN_VIRTUAL_POINTER);
 	litest_add_for_device("events:conversion", event_conversion_key, LITEST_KEYBOARD);
 	litest_add_for_device("events:conversion", event_conversion_touch, LITEST_WACOM_TOUCH);
+	litest_add_for_device("events:pool", event_recycling, LITEST_KEYBOARD);
+	litest_add_for_device("events:pool", event_pool_stats, LITEST_KEYBOARD);
+	litest_add_for_device("events:bulk", event_bulk_retrieval, LITEST_KEYBOARD);
+	litest_add_for_device("events:bulk", event_bulk_retrieval_mask, LITEST_MOUSE);
+	litest_add_for_device("events:queue limit", event_queue_limit_drop_motion, LITEST_MOUSE);
+	litest_add_for_device("events:queue limit", event_queue_limit_drop_motion_frames, LITEST_MOUSE);
+	litest_add_for_device("events:queue limit", event_queue_limit_coalesce, LITEST_MOUSE);
+	litest_add_no_device("events:queue limit", event_queue_limit_coalesce_order);
+	litest_add_for_device("events:queue limit", event_queue_limit_block, LITEST_MOUSE);
+	litest_add_no_device("events:queue limit", event_queue_limit_block_timers);
+	litest_add_for_device("events:queue limit", event_queue_limit_invalid, LITEST_MOUSE);
+	litest_add_no_device("events:dispatch", dispatch_keyboard_priority);
+	litest_add_no_device("events:dispatch", dispatch_round_robin);
+	litest_add_for_device("events:input thread", input_thread_events, LITEST_MOUSE);
+	litest_add_for_device("events:input thread", input_thread_event_pool, LITEST_MOUSE);
+	litest_add_no_device("events:input thread", input_thread_caller_events);
+	litest_add_no_device("events:worker threads", worker_threads_events);
+	litest_add_no_device("events:worker threads", worker_threads_coupled_devices);
+	litest_add_for_device("events:mask", event_mask_context, LITEST_MOUSE);
+	litest_add_no_device("events:mask", event_mask_device);
+	litest_add_no_device("events:mask", event_mask_transition);
+	litest_add_for_device("events:stats", stats_counters, LITEST_MOUSE);
+	litest_add_for_device("events:stats", stats_size, LITEST_MOUSE);
+	litest_add_for_device("events:latency", latency_histogram, LITEST_MOUSE);
 
 	litest_add_no_device("context:refcount", context_ref_counting);
+	litest_add_no_device("context:allocator", context_allocator);
 	litest_add_no_device("config:status string", config_status_string);
 
 	litest_add_no_device("misc:matrix", matrix_helpers);
+	litest_add_no_device("misc:fixed point", fixed_point_helpers);
+	litest_add_no_device("misc:fixed point", fixed_point_calibration);
 	litest_add_no_device("misc:ratelimit", ratelimit_helpers);
 	litest_add_no_device("misc:dpi parser", dpi_parser);
 	litest_add_no_device("misc:wheel click parser", wheel_click_parser);
@@ -273,6 +273,181 @@ START_TEST(pointer_motion_unaccel)
 }
 END_TEST
 
+static void
+send_relative_motion(struct litest_device *dev, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_REL, REL_Y, 2);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+}
+
+START_TEST(pointer_motion_coalesced)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	double dx = 0, dy = 0;
+	int nevents = 0;
+
+	ck_assert(!libinput_get_event_coalescing(li));
+
+	litest_drain_events(li);
+
+	send_relative_motion(dev, 3);
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		ptrev = litest_is_motion_event(event);
+		dx += libinput_event_pointer_get_dx_unaccelerated(ptrev);
+		dy += libinput_event_pointer_get_dy_unaccelerated(ptrev);
+		nevents++;
+		libinput_event_destroy(event);
+	}
+	ck_assert_int_eq(nevents, 3);
+
+	libinput_set_event_coalescing(li, 1);
+	ck_assert(libinput_get_event_coalescing(li));
+
+	send_relative_motion(dev, 3);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert(libinput_event_pointer_get_dx_unaccelerated(ptrev) == dx);
+	ck_assert(libinput_event_pointer_get_dy_unaccelerated(ptrev) == dy);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+
+	libinput_set_event_coalescing(li, 0);
+}
+END_TEST
+
+START_TEST(pointer_frame)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	uint64_t time;
+
+	disable_button_scrolling(dev);
+
+	ck_assert(!libinput_get_pointer_frames(li));
+
+	litest_drain_events(li);
+
+	send_relative_motion(dev, 2);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	libinput_set_pointer_frames(li, 1);
+	ck_assert(libinput_get_pointer_frames(li));
+
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_REL, REL_Y, 2);
+	litest_event(dev, EV_KEY, BTN_LEFT, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_button_event(event,
+				       BTN_LEFT,
+				       LIBINPUT_BUTTON_STATE_PRESSED);
+	time = libinput_event_pointer_get_time_usec(ptrev);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_pointer_frame_event(event);
+	ck_assert_int_eq(libinput_event_pointer_get_time_usec(ptrev), time);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+
+	/* one frame per report */
+	send_relative_motion(dev, 2);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_pointer_frame_event(event);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_pointer_frame_event(event);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+
+	/* reports without pointer events have no frame */
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	litest_button_click(dev, BTN_LEFT, false);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_RELEASED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_pointer_frame_event(event);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+
+	libinput_set_pointer_frames(li, 0);
+}
+END_TEST
+
+START_TEST(pointer_frame_coalesced)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	int i;
+
+	libinput_set_pointer_frames(li, 1);
+	libinput_set_event_coalescing(li, 1);
+
+	litest_drain_events(li);
+
+	/* coalescing stops at the frame boundary, every motion keeps
+	 * its frame */
+	send_relative_motion(dev, 3);
+	libinput_dispatch(li);
+
+	for (i = 0; i < 3; i++) {
+		event = libinput_get_event(li);
+		litest_is_motion_event(event);
+		libinput_event_destroy(event);
+
+		event = libinput_get_event(li);
+		litest_is_pointer_frame_event(event);
+		libinput_event_destroy(event);
+	}
+
+	litest_assert_empty_queue(li);
+
+	libinput_set_event_coalescing(li, 0);
+	libinput_set_pointer_frames(li, 0);
+}
+END_TEST
+
 static void
 test_button_event(struct litest_device *dev, unsigned int button, int state)
 {
@@ -760,6 +935,58 @@ START_TEST(pointer_left_handed_during_click_multiple_buttons)
 }
 END_TEST
 
+START_TEST(pointer_scroll_wheel_coalesced)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	enum libinput_pointer_axis axis = LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL;
+	double value;
+	int discrete = 3;
+
+	libinput_set_event_coalescing(li, 1);
+	litest_drain_events(li);
+
+	/* one event to get the value of a single click */
+	litest_event(dev, EV_REL, REL_WHEEL, -1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_axis_event(event,
+				     axis,
+				     LIBINPUT_POINTER_AXIS_SOURCE_WHEEL);
+	value = libinput_event_pointer_get_axis_value(ptrev, axis);
+	libinput_event_destroy(event);
+
+	if (libinput_device_config_scroll_get_natural_scroll_enabled(dev->libinput_device))
+		discrete *= -1;
+
+	litest_event(dev, EV_REL, REL_WHEEL, -1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_event(dev, EV_REL, REL_WHEEL, -1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_event(dev, EV_REL, REL_WHEEL, -1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_axis_event(event,
+				     axis,
+				     LIBINPUT_POINTER_AXIS_SOURCE_WHEEL);
+	ck_assert(libinput_event_pointer_get_axis_value(ptrev, axis) ==
+		  3 * value);
+	litest_assert_int_eq(libinput_event_pointer_get_axis_value_discrete(ptrev, axis),
+			     discrete);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+
+	libinput_set_event_coalescing(li, 0);
+}
+END_TEST
+
 START_TEST(pointer_scroll_button)
 {
 	struct litest_device *dev = litest_current_device();
@@ -1028,6 +1255,57 @@ START_TEST(middlebutton_timeout)
 }
 END_TEST
 
+START_TEST(middlebutton_timeout_frame)
+{
+	struct litest_device *device = litest_current_device();
+	struct libinput *li = device->libinput;
+	struct libinput_event *event;
+	enum libinput_config_status status;
+
+	disable_button_scrolling(device);
+
+	status = libinput_device_config_middle_emulation_set_enabled(
+					    device->libinput_device,
+					    LIBINPUT_CONFIG_MIDDLE_EMULATION_ENABLED);
+	if (status == LIBINPUT_CONFIG_STATUS_UNSUPPORTED)
+		return;
+
+	libinput_set_pointer_frames(li, 1);
+
+	litest_drain_events(li);
+	litest_button_click(device, BTN_LEFT, true);
+	litest_assert_empty_queue(li);
+	litest_timeout_middlebutton();
+	libinput_dispatch(li);
+
+	/* the button is posted by the timer, not the report */
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_pointer_frame_event(event);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	litest_button_click(device, BTN_LEFT, false);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_RELEASED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_pointer_frame_event(event);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	libinput_set_pointer_frames(li, 0);
+}
+END_TEST
+
 START_TEST(middlebutton_doubleclick)
 {
 	struct litest_device *device = litest_current_device();
@@ -1326,10 +1604,14 @@ litest_setup_tests(void)
 	litest_add("pointer:motion", pointer_motion_relative, LITEST_RELATIVE, LITEST_ANY);
 	litest_add("pointer:motion", pointer_motion_absolute, LITEST_ABSOLUTE, LITEST_ANY);
 	litest_add("pointer:motion", pointer_motion_unaccel, LITEST_RELATIVE, LITEST_ANY);
+	litest_add("pointer:motion", pointer_motion_coalesced, LITEST_RELATIVE, LITEST_ANY);
+	litest_add("pointer:frame", pointer_frame, LITEST_RELATIVE|LITEST_BUTTON, LITEST_ANY);
+	litest_add("pointer:frame", pointer_frame_coalesced, LITEST_RELATIVE, LITEST_ANY);
 	litest_add("pointer:button", pointer_button, LITEST_BUTTON, LITEST_CLICKPAD);
 	litest_add_no_device("pointer:button", pointer_button_auto_release);
 	litest_add_no_device("pointer:button", pointer_seat_button_count);
 	litest_add("pointer:scroll", pointer_scroll_wheel, LITEST_WHEEL, LITEST_ANY);
+	litest_add("pointer:scroll", pointer_scroll_wheel_coalesced, LITEST_WHEEL, LITEST_ANY);
 	litest_add("pointer:scroll", pointer_scroll_button, LITEST_RELATIVE|LITEST_BUTTON, LITEST_ANY);
 	litest_add("pointer:scroll", pointer_scroll_nowheel_defaults, LITEST_RELATIVE|LITEST_BUTTON, LITEST_WHEEL);
 	litest_add("pointer:scroll", pointer_scroll_natural_defaults, LITEST_WHEEL, LITEST_ANY);
@@ -1352,6 +1634,7 @@ litest_setup_tests(void)
 
 	litest_add("pointer:middlebutton", middlebutton, LITEST_BUTTON, LITEST_ANY);
 	litest_add("pointer:middlebutton", middlebutton_timeout, LITEST_BUTTON, LITEST_ANY);
+	litest_add("pointer:middlebutton", middlebutton_timeout_frame, LITEST_BUTTON, LITEST_ANY);
 	litest_add("pointer:middlebutton", middlebutton_doubleclick, LITEST_BUTTON, LITEST_ANY);
 	litest_add("pointer:middlebutton", middlebutton_middleclick, LITEST_BUTTON, LITEST_ANY);
 	litest_add("pointer:middlebutton", middlebutton_middleclick_during, LITEST_BUTTON, LITEST_ANY);
@@ -0,0 +1,307 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <check.h>
+#include <errno.h>
+#include <libevdev/libevdev.h>
+#include <libinput.h>
+#include <libinput-util.h>
+#include <unistd.h>
+
+#include "litest.h"
+
+#define EV(t_, type_, code_, value_) \
+	{ .time = { (t_) / 1000000, (t_) % 1000000 }, \
+	  .type = (type_), .code = (code_), .value = (value_) }
+
+static const char *mouse_properties[] = {
+	"ID_INPUT=1",
+	"ID_INPUT_MOUSE=1",
+	NULL,
+};
+
+static const char *touchpad_properties[] = {
+	"ID_INPUT=1",
+	"ID_INPUT_TOUCHPAD=1",
+	NULL,
+};
+
+static struct libevdev *
+replay_mouse_description(void)
+{
+	struct libevdev *evdev = libevdev_new();
+
+	ck_assert_notnull(evdev);
+	libevdev_set_name(evdev, "replay test mouse");
+	libevdev_set_id_bustype(evdev, BUS_USB);
+	libevdev_enable_event_code(evdev, EV_REL, REL_X, NULL);
+	libevdev_enable_event_code(evdev, EV_REL, REL_Y, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_LEFT, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_RIGHT, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_MIDDLE, NULL);
+
+	return evdev;
+}
+
+static struct libevdev *
+replay_touchpad_description(void)
+{
+	struct libevdev *evdev = libevdev_new();
+	struct input_absinfo x = { .minimum = 0, .maximum = 4000,
+				   .resolution = 40 };
+	struct input_absinfo y = { .minimum = 0, .maximum = 3000,
+				   .resolution = 40 };
+	struct input_absinfo slot = { .minimum = 0, .maximum = 1 };
+	struct input_absinfo tracking_id = { .minimum = 0,
+					     .maximum = 65535 };
+
+	ck_assert_notnull(evdev);
+	libevdev_set_name(evdev, "replay test touchpad");
+	libevdev_set_id_bustype(evdev, BUS_I8042);
+	libevdev_enable_property(evdev, INPUT_PROP_POINTER);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_X, &x);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_Y, &y);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_MT_SLOT, &slot);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_MT_POSITION_X, &x);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_MT_POSITION_Y, &y);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_MT_TRACKING_ID,
+				   &tracking_id);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_LEFT, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_RIGHT, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_TOUCH, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_TOOL_FINGER, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_TOOL_DOUBLETAP, NULL);
+
+	return evdev;
+}
+
+START_TEST(replay_add_device)
+{
+	struct libinput *li;
+	struct libinput_device *device;
+	struct libinput_event *event;
+	struct libevdev *evdev;
+
+	li = libinput_replay_create_context(NULL, NULL);
+	ck_assert_notnull(li);
+
+	evdev = replay_mouse_description();
+	device = libinput_replay_add_device(li, evdev, mouse_properties);
+	ck_assert_notnull(device);
+	ck_assert(libinput_device_has_capability(device,
+						 LIBINPUT_DEVICE_CAP_POINTER));
+	ck_assert_str_eq(libinput_device_get_sysname(device), "replay0");
+	ck_assert(libinput_device_get_udev_device(device) == NULL);
+
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	ck_assert_int_eq(libinput_event_get_type(event),
+			 LIBINPUT_EVENT_DEVICE_ADDED);
+	ck_assert(libinput_event_get_device(event) == device);
+	libinput_event_destroy(event);
+
+	libinput_replay_remove_device(device);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	ck_assert_int_eq(libinput_event_get_type(event),
+			 LIBINPUT_EVENT_DEVICE_REMOVED);
+	libinput_event_destroy(event);
+
+	/* not tagged by "udev", the description remains ours */
+	evdev = replay_mouse_description();
+	litest_disable_log_handler(li);
+	device = libinput_replay_add_device(li, evdev, NULL);
+	litest_restore_log_handler(li);
+	ck_assert(device == NULL);
+	libevdev_free(evdev);
+
+	litest_assert_empty_queue(li);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(replay_mouse_motion)
+{
+	struct libinput *li;
+	struct libinput_device *device;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	const struct input_event events[] = {
+		EV(1000000, EV_REL, REL_X, 5),
+		EV(1000000, EV_SYN, SYN_REPORT, 0),
+		EV(1008000, EV_REL, REL_X, 5),
+		EV(1008000, EV_SYN, SYN_REPORT, 0),
+		EV(1016000, EV_KEY, BTN_LEFT, 1),
+		EV(1016000, EV_SYN, SYN_REPORT, 0),
+	};
+	int i;
+
+	li = libinput_replay_create_context(NULL, NULL);
+	device = libinput_replay_add_device(li,
+					    replay_mouse_description(),
+					    mouse_properties);
+	ck_assert_notnull(device);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_replay_device_push_events(device,
+							    events,
+							    ARRAY_LENGTH(events)),
+			 0);
+
+	for (i = 0; i < 2; i++) {
+		event = libinput_get_event(li);
+		ptrev = litest_is_motion_event(event);
+		ck_assert(libinput_event_pointer_get_dx(ptrev) > 0);
+		ck_assert(libinput_event_pointer_get_time_usec(ptrev) ==
+			  1000000ULL + i * 8000);
+		libinput_event_destroy(event);
+	}
+
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_empty_queue(li);
+
+	libinput_suspend(li);
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_replay_device_push_events(device,
+							    events,
+							    ARRAY_LENGTH(events)),
+			 -EAGAIN);
+	libinput_resume(li);
+	litest_assert_empty_queue(li);
+
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(replay_mouse_fd)
+{
+	struct libinput *li;
+	struct libinput_device *device;
+	struct libinput_event *event;
+	const struct input_event events[] = {
+		EV(1000000, EV_REL, REL_Y, -2),
+		EV(1000000, EV_SYN, SYN_REPORT, 0),
+		EV(1008000, EV_REL, REL_Y, -2),
+		EV(1008000, EV_SYN, SYN_REPORT, 0),
+		EV(1016000, EV_REL, REL_Y, -2),
+		EV(1016000, EV_SYN, SYN_REPORT, 0),
+	};
+	int fds[2];
+	int count = 0;
+
+	li = libinput_replay_create_context(NULL, NULL);
+	device = libinput_replay_add_device(li,
+					    replay_mouse_description(),
+					    mouse_properties);
+	ck_assert_notnull(device);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(pipe(fds), 0);
+	ck_assert_int_eq(write(fds[1], events, sizeof(events)),
+			 sizeof(events));
+	close(fds[1]);
+
+	ck_assert_int_eq(libinput_replay_device_push_fd(device, fds[0]), 0);
+	close(fds[0]);
+
+	while ((event = libinput_get_event(li))) {
+		litest_is_motion_event(event);
+		libinput_event_destroy(event);
+		count++;
+	}
+	ck_assert_int_eq(count, 3);
+
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(replay_touchpad_tap)
+{
+	struct libinput *li;
+	struct libinput_device *device;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	const struct input_event events[] = {
+		EV(1000000, EV_ABS, ABS_MT_SLOT, 0),
+		EV(1000000, EV_ABS, ABS_MT_TRACKING_ID, 1),
+		EV(1000000, EV_ABS, ABS_MT_POSITION_X, 2000),
+		EV(1000000, EV_ABS, ABS_MT_POSITION_Y, 1500),
+		EV(1000000, EV_ABS, ABS_X, 2000),
+		EV(1000000, EV_ABS, ABS_Y, 1500),
+		EV(1000000, EV_KEY, BTN_TOUCH, 1),
+		EV(1000000, EV_KEY, BTN_TOOL_FINGER, 1),
+		EV(1000000, EV_SYN, SYN_REPORT, 0),
+		EV(1050000, EV_ABS, ABS_MT_TRACKING_ID, -1),
+		EV(1050000, EV_KEY, BTN_TOUCH, 0),
+		EV(1050000, EV_KEY, BTN_TOOL_FINGER, 0),
+		EV(1050000, EV_SYN, SYN_REPORT, 0),
+	};
+	uint64_t release;
+
+	li = libinput_replay_create_context(NULL, NULL);
+	device = libinput_replay_add_device(li,
+					    replay_touchpad_description(),
+					    touchpad_properties);
+	ck_assert_notnull(device);
+	libinput_device_config_tap_set_enabled(device,
+					       LIBINPUT_CONFIG_TAP_ENABLED);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_replay_device_push_events(device,
+							    events,
+							    ARRAY_LENGTH(events)),
+			 0);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+
+	/* replay time stands at the last event, the tap timeout is
+	 * pending */
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+	release = libinput_get_next_timeout(li);
+	ck_assert(release > 1050000);
+
+	ck_assert_int_eq(libinput_replay_set_time(li, 1000000), -1);
+	ck_assert_int_eq(libinput_replay_set_time(li, 60000000), 0);
+	event = libinput_get_event(li);
+	ptrev = litest_is_button_event(event,
+				       BTN_LEFT,
+				       LIBINPUT_BUTTON_STATE_RELEASED);
+	ck_assert(libinput_event_pointer_get_time_usec(ptrev) == release);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+	libinput_unref(li);
+}
+END_TEST
+
+void
+litest_setup_tests(void)
+{
+	litest_add_no_device("replay:device", replay_add_device);
+	litest_add_no_device("replay:events", replay_mouse_motion);
+	litest_add_no_device("replay:events", replay_mouse_fd);
+	litest_add_no_device("replay:events", replay_touchpad_tap);
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <check.h>
+#include <stdarg.h>
+#include <stdlib.h>
+
+/* The timers are internal to libinput, test them on a context of our own
+ * with a simulated clock and no timerfd */
+#include "../src/timer.c"
+#include "litest.h"
+
+#ifdef HAVE_USDT_PROBES
+unsigned short USDT_SEMAPHORE(timer_fire);
+#endif
+
+static int bugs_logged;
+
+void
+log_msg(struct libinput *libinput,
+	enum libinput_log_priority priority,
+	const char *format, ...)
+{
+	if (priority == LIBINPUT_LOG_PRIORITY_ERROR &&
+	    strneq(format, "libinput bug: ", 14))
+		bugs_logged++;
+}
+
+struct libinput_source *
+libinput_add_fd(struct libinput *libinput,
+		int fd,
+		libinput_source_dispatch_t dispatch,
+		void *user_data)
+{
+	return NULL;
+}
+
+void
+libinput_remove_source(struct libinput *libinput,
+		       struct libinput_source *source)
+{
+}
+
+void
+libinput_flush_pointer_frames(struct libinput *libinput)
+{
+}
+
+void
+libinput_workers_lock(struct libinput *libinput)
+{
+}
+
+void
+libinput_workers_unlock(struct libinput *libinput)
+{
+}
+
+static uint64_t clock_now;
+
+static uint64_t
+simulated_clock(void *user_data)
+{
+	return clock_now;
+}
+
+static struct libinput *
+timer_context_new(void)
+{
+	struct libinput *libinput;
+
+	libinput = zalloc(sizeof(*libinput));
+	ck_assert_notnull(libinput);
+
+	mem_allocator_init(&libinput->mem, NULL);
+	list_init(&libinput->timer.deferred);
+	libinput->timer.heap_len = 16;
+	libinput->timer.heap = libinput_calloc(libinput,
+					       libinput->timer.heap_len,
+					       sizeof(*libinput->timer.heap));
+	ck_assert_notnull(libinput->timer.heap);
+	libinput->timer.fd = -1;
+	libinput->clock.func = simulated_clock;
+
+	clock_now = 0;
+	bugs_logged = 0;
+
+	return libinput;
+}
+
+static void
+timer_context_destroy(struct libinput *libinput)
+{
+	libinput_timer_subsys_destroy(libinput);
+	free(libinput);
+}
+
+struct test_timer {
+	struct libinput_timer timer;
+	bool rearm; /* re-arm at now + rearm_offset on the first fire */
+	int64_t rearm_offset;
+	struct test_timer *cancel; /* cancelled on every fire */
+	int fired;
+	uint64_t fire_time;
+};
+
+static void
+test_timer_func(uint64_t now, void *data)
+{
+	struct test_timer *t = data;
+
+	if (t->fired++ == 0 && t->rearm)
+		libinput_timer_set(&t->timer, now + t->rearm_offset);
+
+	if (t->cancel)
+		libinput_timer_cancel(&t->cancel->timer);
+
+	t->fire_time = now;
+}
+
+static void
+test_timer_init(struct test_timer *t, struct libinput *libinput)
+{
+	memset(t, 0, sizeof(*t));
+	libinput_timer_init(&t->timer, libinput, test_timer_func, t);
+}
+
+START_TEST(timer_rearmed_does_not_delay_others)
+{
+	struct libinput *libinput = timer_context_new();
+	struct test_timer a, b;
+
+	/* a re-arms itself before the time it fired at and ends up in
+	 * front of b again, b is due at the same time and must not wait
+	 * for the next round because of a */
+	test_timer_init(&a, libinput);
+	a.rearm = true;
+	a.rearm_offset = -50;
+	test_timer_init(&b, libinput);
+	libinput_timer_set(&a.timer, 100);
+	libinput_timer_set(&b.timer, 100);
+
+	clock_now = 150;
+	libinput_timer_dispatch(libinput);
+	ck_assert_int_eq(a.fired, 1);
+	ck_assert_int_eq(b.fired, 1);
+	ck_assert_int_eq(b.fire_time, 100);
+	ck_assert_int_eq(bugs_logged, 1);
+
+	/* a is back in the heap and fires in the next round */
+	ck_assert_int_eq(libinput_timer_next_expiry(libinput), 50);
+	libinput_timer_dispatch(libinput);
+	ck_assert_int_eq(a.fired, 2);
+	ck_assert_int_eq(a.fire_time, 50);
+	ck_assert_int_eq(b.fired, 1);
+	ck_assert_int_eq(libinput_timer_next_expiry(libinput), 0);
+
+	timer_context_destroy(libinput);
+}
+END_TEST
+
+START_TEST(timer_rearmed_later_fires_same_round)
+{
+	struct libinput *libinput = timer_context_new();
+	struct test_timer a, b;
+
+	/* a moves its deadline forward, still within now */
+	test_timer_init(&a, libinput);
+	a.rearm = true;
+	a.rearm_offset = 20;
+	test_timer_init(&b, libinput);
+	libinput_timer_set(&a.timer, 100);
+	libinput_timer_set(&b.timer, 100);
+
+	clock_now = 150;
+	libinput_timer_dispatch(libinput);
+	ck_assert_int_eq(a.fired, 2);
+	ck_assert_int_eq(a.fire_time, 120);
+	ck_assert_int_eq(b.fired, 1);
+	ck_assert_int_eq(bugs_logged, 0);
+	ck_assert_int_eq(libinput_timer_next_expiry(libinput), 0);
+
+	timer_context_destroy(libinput);
+}
+END_TEST
+
+START_TEST(timer_deferred_cancel)
+{
+	struct libinput *libinput = timer_context_new();
+	struct test_timer a, b;
+
+	/* b cancels a while a is set aside for the round */
+	test_timer_init(&a, libinput);
+	a.rearm = true;
+	a.rearm_offset = -50;
+	test_timer_init(&b, libinput);
+	b.cancel = &a;
+	libinput_timer_set(&a.timer, 100);
+	libinput_timer_set(&b.timer, 100);
+
+	clock_now = 150;
+	libinput_timer_dispatch(libinput);
+	ck_assert_int_eq(a.fired, 1);
+	ck_assert_int_eq(b.fired, 1);
+	ck_assert_int_eq(libinput_timer_next_expiry(libinput), 0);
+
+	libinput_timer_dispatch(libinput);
+	ck_assert_int_eq(a.fired, 1);
+
+	timer_context_destroy(libinput);
+}
+END_TEST
+
+void
+litest_setup_tests(void)
+{
+	litest_add_no_device("timer:simulated clock", timer_rearmed_does_not_delay_others);
+	litest_add_no_device("timer:simulated clock", timer_rearmed_later_fires_same_round);
+	litest_add_no_device("timer:simulated clock", timer_deferred_cancel);
+}
@@ -26,10 +26,12 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <libinput.h>
+#include <stdio.h>
 #include <unistd.h>
 
 #include "libinput-util.h"
 #include "litest.h"
+#include "state-trace.h"
 
 START_TEST(touchpad_1fg_motion)
 {
@@ -123,6 +125,177 @@ START_TEST(touchpad_1fg_tap)
 }
 END_TEST
 
+START_TEST(touchpad_1fg_tap_external_timer)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct timespec ts;
+	uint64_t now, timeout;
+
+	libinput_device_config_tap_set_enabled(dev->libinput_device,
+					       LIBINPUT_CONFIG_TAP_ENABLED);
+
+	ck_assert_int_eq(libinput_set_internal_timer_enabled(li, 0), 0);
+	ck_assert_int_eq(libinput_get_internal_timer_enabled(li), 0);
+
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_up(dev, 0);
+
+	libinput_dispatch(li);
+
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now = ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+	timeout = libinput_get_next_timeout(li);
+	ck_assert(timeout > now);
+	ck_assert(timeout <= now + ms2us(200));
+
+	/* the release is only sent once we dispatch past the deadline */
+	litest_timeout_tap();
+	libinput_dispatch(li);
+	ck_assert_int_eq(libinput_next_event_type(li),
+			 LIBINPUT_EVENT_POINTER_BUTTON);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+
+	ck_assert_int_eq(libinput_set_internal_timer_enabled(li, 1), 0);
+	ck_assert_int_eq(libinput_get_internal_timer_enabled(li), 1);
+
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+static uint64_t
+simulated_clock(void *user_data)
+{
+	return *(uint64_t *)user_data;
+}
+
+START_TEST(touchpad_1fg_tap_simulated_clock)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	struct timespec ts;
+	uint64_t now, timeout;
+
+	libinput_device_config_tap_set_enabled(dev->libinput_device,
+					       LIBINPUT_CONFIG_TAP_ENABLED);
+	litest_drain_events(li);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now = ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+	libinput_set_clock(li, simulated_clock, &now);
+	ck_assert_int_eq(libinput_get_internal_timer_enabled(li), 0);
+	ck_assert_int_eq(libinput_set_internal_timer_enabled(li, 1), -1);
+
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+
+	/* the clock stands still, no matter how long we wait */
+	timeout = libinput_get_next_timeout(li);
+	ck_assert(timeout > now);
+	litest_timeout_tap();
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	/* the timer fires at its deadline, not at the time we got to */
+	now += ms2us(60000);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	ptrev = litest_is_button_event(event,
+				       BTN_LEFT,
+				       LIBINPUT_BUTTON_STATE_RELEASED);
+	ck_assert(libinput_event_pointer_get_time_usec(ptrev) == timeout);
+	libinput_event_destroy(event);
+
+	libinput_set_clock(li, NULL, NULL);
+	ck_assert_int_eq(libinput_set_internal_timer_enabled(li, 1), 0);
+
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(touchpad_tap_state_trace)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct state_trace_file_header header;
+	struct state_trace_file_record record;
+	char strings[4096];
+	const char *names[64];
+	char *p;
+	bool found = false;
+	FILE *fp;
+	size_t len;
+	uint32_t i;
+
+	libinput_device_config_tap_set_enabled(dev->libinput_device,
+					       LIBINPUT_CONFIG_TAP_ENABLED);
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 50, 50);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+	litest_timeout_tap();
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	fp = tmpfile();
+	ck_assert_notnull(fp);
+	ck_assert_int_eq(libinput_device_dump_state_trace(dev->libinput_device,
+							  fileno(fp)),
+			 0);
+	rewind(fp);
+
+	ck_assert_int_eq(fread(&header, sizeof(header), 1, fp), 1);
+	ck_assert_int_eq(memcmp(header.magic,
+				STATE_TRACE_MAGIC,
+				sizeof(header.magic)), 0);
+	ck_assert_int_gt(header.nrecords, 0);
+	ck_assert_int_le(header.nrecords, STATE_TRACE_SIZE);
+	ck_assert_int_le(header.nstrings, ARRAY_LENGTH(names));
+
+	/* the string table is followed by the records */
+	len = fread(strings, 1, sizeof(strings), fp);
+	p = strings;
+	for (i = 0; i < header.nstrings; i++) {
+		names[i] = p;
+		p = memchr(p, '\0', len - (p - strings));
+		ck_assert_notnull(p);
+		p++;
+	}
+	ck_assert_int_eq(fseek(fp, sizeof(header) + (p - strings), SEEK_SET), 0);
+
+	for (i = 0; i < header.nrecords; i++) {
+		ck_assert_int_eq(fread(&record, sizeof(record), 1, fp), 1);
+		ck_assert_int_lt(record.machine, header.nstrings);
+		ck_assert_int_lt(record.event, header.nstrings);
+
+		if (streq(names[record.machine], "tap") &&
+		    streq(names[record.event], "TAP_EVENT_TOUCH")) {
+			ck_assert_int_eq(record.touch, 0);
+			ck_assert_str_eq(names[record.from], "TAP_STATE_IDLE");
+			ck_assert_str_eq(names[record.to], "TAP_STATE_TOUCH");
+			found = true;
+		}
+	}
+	ck_assert(found);
+	ck_assert_int_eq(fread(&record, 1, 1, fp), 0);
+
+	fclose(fp);
+}
+END_TEST
+
 START_TEST(touchpad_1fg_doubletap)
 {
 	struct litest_device *dev = litest_current_device();
@@ -4600,6 +4773,9 @@ litest_setup_tests(void)
 	litest_add("touchpad:motion", touchpad_2fg_no_motion, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH);
 
 	litest_add("touchpad:tap", touchpad_1fg_tap, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("touchpad:tap", touchpad_1fg_tap_external_timer, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("touchpad:tap", touchpad_1fg_tap_simulated_clock, LITEST_TOUCHPAD, LITEST_ANY);
+	litest_add("touchpad:tap", touchpad_tap_state_trace, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("touchpad:tap", touchpad_1fg_doubletap, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add_ranged("touchpad:tap", touchpad_1fg_multitap, LITEST_TOUCHPAD, LITEST_ANY, &multitap_range);
 	litest_add_ranged("touchpad:tap", touchpad_1fg_multitap_n_drag_timeout, LITEST_TOUCHPAD, LITEST_ANY, &multitap_range);
@@ -23,6 +23,7 @@
 #define _GNU_SOURCE
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <poll.h>
 #include <stdio.h>
 #include <signal.h>
@@ -34,6 +35,7 @@
 #include <sys/ioctl.h>
 
 #include <libinput.h>
+#include <libinput-util.h>
 
 #include "shared.h"
 
@@ -43,6 +45,11 @@ static const uint32_t screen_height = 100;
 struct tools_options options;
 static unsigned int stop = 0;
 
+/* for --show-latency */
+#define MAX_DEVICES 64
+#define LATENCY_BUCKETS 32
+static struct libinput_device *devices[MAX_DEVICES];
+
 static int
 open_restricted(const char *path, int flags, void *user_data)
 {
@@ -65,48 +72,7 @@ static void
 print_event_header(struct libinput_event *ev)
 {
 	struct libinput_device *dev = libinput_event_get_device(ev);
-	const char *type = NULL;
-
-	switch(libinput_event_get_type(ev)) {
-	case LIBINPUT_EVENT_NONE:
-		abort();
-	case LIBINPUT_EVENT_DEVICE_ADDED:
-		type = "DEVICE_ADDED";
-		break;
-	case LIBINPUT_EVENT_DEVICE_REMOVED:
-		type = "DEVICE_REMOVED";
-		break;
-	case LIBINPUT_EVENT_KEYBOARD_KEY:
-		type = "KEYBOARD_KEY";
-		break;
-	case LIBINPUT_EVENT_POINTER_MOTION:
-		type = "POINTER_MOTION";
-		break;
-	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
-		type = "POINTER_MOTION_ABSOLUTE";
-		break;
-	case LIBINPUT_EVENT_POINTER_BUTTON:
-		type = "POINTER_BUTTON";
-		break;
-	case LIBINPUT_EVENT_POINTER_AXIS:
-		type = "POINTER_AXIS";
-		break;
-	case LIBINPUT_EVENT_TOUCH_DOWN:
-		type = "TOUCH_DOWN";
-		break;
-	case LIBINPUT_EVENT_TOUCH_MOTION:
-		type = "TOUCH_MOTION";
-		break;
-	case LIBINPUT_EVENT_TOUCH_UP:
-		type = "TOUCH_UP";
-		break;
-	case LIBINPUT_EVENT_TOUCH_CANCEL:
-		type = "TOUCH_CANCEL";
-		break;
-	case LIBINPUT_EVENT_TOUCH_FRAME:
-		type = "TOUCH_FRAME";
-		break;
-	}
+	const char *type = tools_event_type_name(libinput_event_get_type(ev));
 
 	printf("%-7s	%s	", libinput_device_get_sysname(dev), type);
 }
@@ -259,6 +225,15 @@ print_axis_event(struct libinput_event *ev)
 	printf("vert %.2f horiz %.2f\n", v, h);
 }
 
+static void
+print_pointer_frame_event(struct libinput_event *ev)
+{
+	struct libinput_event_pointer *p = libinput_event_get_pointer_event(ev);
+
+	print_event_time(libinput_event_pointer_get_time(p));
+	printf("\n");
+}
+
 static void
 print_touch_event_without_coords(struct libinput_event *ev)
 {
@@ -286,6 +261,94 @@ print_touch_event_with_coords(struct libinput_event *ev)
 	       xmm, ymm);
 }
 
+static void
+track_device(struct libinput_event *ev)
+{
+	struct libinput_device *dev = libinput_event_get_device(ev);
+	int i;
+
+	for (i = 0; i < MAX_DEVICES; i++) {
+		if (libinput_event_get_type(ev) == LIBINPUT_EVENT_DEVICE_ADDED &&
+		    devices[i] == NULL) {
+			devices[i] = libinput_device_ref(dev);
+			break;
+		} else if (libinput_event_get_type(ev) == LIBINPUT_EVENT_DEVICE_REMOVED &&
+			   devices[i] == dev) {
+			libinput_device_unref(dev);
+			devices[i] = NULL;
+			break;
+		}
+	}
+}
+
+/* upper bound of the bucket that holds the given percentile */
+static uint64_t
+latency_percentile(const uint64_t *buckets, size_t nbuckets,
+		   uint64_t total, unsigned int percentile)
+{
+	uint64_t count = 0;
+	size_t i;
+
+	for (i = 0; i < nbuckets; i++) {
+		count += buckets[i];
+		if (count * 100 >= total * percentile)
+			break;
+	}
+
+	return 2ULL << min(i, nbuckets - 1);
+}
+
+static void
+print_latency_histograms(void)
+{
+	static const enum libinput_event_type types[] = {
+		LIBINPUT_EVENT_KEYBOARD_KEY,
+		LIBINPUT_EVENT_POINTER_MOTION,
+		LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+		LIBINPUT_EVENT_POINTER_BUTTON,
+		LIBINPUT_EVENT_POINTER_AXIS,
+		LIBINPUT_EVENT_POINTER_FRAME,
+		LIBINPUT_EVENT_TOUCH_DOWN,
+		LIBINPUT_EVENT_TOUCH_MOTION,
+		LIBINPUT_EVENT_TOUCH_UP,
+		LIBINPUT_EVENT_TOUCH_CANCEL,
+		LIBINPUT_EVENT_TOUCH_FRAME,
+	};
+	uint64_t buckets[LATENCY_BUCKETS];
+	uint64_t total;
+	size_t i, t, b, nbuckets;
+
+	for (i = 0; i < MAX_DEVICES; i++) {
+		if (!devices[i])
+			continue;
+
+		for (t = 0; t < ARRAY_LENGTH(types); t++) {
+			nbuckets = libinput_device_get_latency_histogram(
+							devices[i],
+							types[t],
+							buckets,
+							LATENCY_BUCKETS);
+			total = 0;
+			for (b = 0; b < nbuckets; b++)
+				total += buckets[b];
+			if (total == 0)
+				continue;
+
+			printf("%-7s	%-23s	latency: %6" PRIu64 " events, "
+			       "p50 <%" PRIu64 "us p99 <%" PRIu64 "us "
+			       "max <%" PRIu64 "us\n",
+			       libinput_device_get_sysname(devices[i]),
+			       tools_event_type_name(types[t]),
+			       total,
+			       latency_percentile(buckets, nbuckets, total, 50),
+			       latency_percentile(buckets, nbuckets, total, 99),
+			       latency_percentile(buckets, nbuckets, total, 100));
+		}
+
+		libinput_device_reset_latency_histograms(devices[i]);
+	}
+}
+
 static int
 handle_and_print_events(struct libinput *li)
 {
@@ -304,6 +367,7 @@ handle_and_print_events(struct libinput *li)
 			print_device_notify(ev);
 			tools_device_apply_config(libinput_event_get_device(ev),
 						  &options);
+			track_device(ev);
 			break;
 		case LIBINPUT_EVENT_KEYBOARD_KEY:
 			print_key_event(ev);
@@ -320,6 +384,9 @@ handle_and_print_events(struct libinput *li)
 		case LIBINPUT_EVENT_POINTER_AXIS:
 			print_axis_event(ev);
 			break;
+		case LIBINPUT_EVENT_POINTER_FRAME:
+			print_pointer_frame_event(ev);
+			break;
 		case LIBINPUT_EVENT_TOUCH_DOWN:
 			print_touch_event_with_coords(ev);
 			break;
@@ -350,11 +417,22 @@ sighandler(int signal, siginfo_t *siginfo, void *userdata)
 	stop = 1;
 }
 
+static uint64_t
+now_in_ms(void)
+{
+	struct timespec tp;
+
+	clock_gettime(CLOCK_MONOTONIC, &tp);
+	return tp.tv_sec * 1000ULL + tp.tv_nsec / 1000000;
+}
+
 static void
 mainloop(struct libinput *li)
 {
 	struct pollfd fds;
 	struct sigaction act;
+	int timeout = options.show_latency ? 1000 : -1;
+	uint64_t last_print = now_in_ms();
 
 	fds.fd = libinput_get_fd(li);
 	fds.events = POLLIN;
@@ -375,8 +453,14 @@ mainloop(struct libinput *li)
 		fprintf(stderr, "Expected device added events on startup but got none. "
 				"Maybe you don't have the right permissions?\n");
 
-	while (!stop && poll(&fds, 1, -1) > -1)
+	while (!stop && poll(&fds, 1, timeout) > -1) {
 		handle_and_print_events(li);
+
+		if (options.show_latency && now_in_ms() - last_print >= 1000) {
+			print_latency_histograms();
+			last_print = now_in_ms();
+		}
+	}
 }
 
 int
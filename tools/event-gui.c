@@ -456,6 +456,7 @@ handle_event_libinput(GIOChannel *source, GIOCondition condition, gpointer data)
 		case LIBINPUT_EVENT_POINTER_AXIS:
 			handle_event_axis(ev, w);
 			break;
+		case LIBINPUT_EVENT_POINTER_FRAME:
 		case LIBINPUT_EVENT_TOUCH_CANCEL:
 		case LIBINPUT_EVENT_TOUCH_FRAME:
 			break;
@@ -0,0 +1,830 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+#include <config.h>
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libevdev/libevdev.h>
+#include <libinput.h>
+#include <libinput-util.h>
+#include <libinput-version.h>
+#include <filter.h>
+
+#include "record-replay.h"
+
+/* Touchpad frames are 10ms apart, mouse frames 1ms */
+#define TP_FRAME_INTERVAL ms2us(10)
+#define MOUSE_FRAME_INTERVAL ms2us(1)
+
+/* Deltas per filter_dispatch_batch() call in the batch benchmarks */
+#define FILTER_BATCH_SIZE 64
+
+/* A tenth of the frames of each run warm up, untimed */
+#define WARMUP_DIVISOR 10
+
+/* The replay clock treats 0 as invalid, start somewhere else */
+#define BENCH_START_TIME ms2us(1000)
+
+/* Timers still pending at the end of a recording get this long */
+#define RECORDING_TRAILING_TIME ms2us(10000)
+
+struct frame {
+	struct input_event events[64];
+	size_t count;
+	uint64_t time;
+};
+
+struct bench_state {
+	unsigned int nfingers;
+	int tracking_id;
+};
+
+struct bench {
+	const char *name;
+	bool touchpad;
+	bool clickpad;
+	void (*setup)(struct libinput_device *device);
+	void (*frame)(struct bench_state *state,
+		      struct frame *f,
+		      unsigned int n);
+	unsigned int nfingers;
+};
+
+struct bench_result {
+	uint64_t events;	/* kernel events or deltas in */
+	uint64_t out;		/* libinput events or deltas out */
+	uint64_t allocs;
+	uint64_t nsec;
+};
+
+static uint64_t allocations;
+
+/* keeps the compiler from dropping the filter results */
+static volatile double filter_sink;
+
+static const char *mouse_properties[] = {
+	"ID_INPUT=1",
+	"ID_INPUT_MOUSE=1",
+	NULL,
+};
+
+static const char *touchpad_properties[] = {
+	"ID_INPUT=1",
+	"ID_INPUT_TOUCHPAD=1",
+	NULL,
+};
+
+/* deltas of a mouse speeding up and slowing down again */
+static const int mouse_deltas[] = {
+	1, 1, 2, 2, 3, 4, 6, 8, 10, 13, 16, 20, 24, 20, 16, 13,
+	10, 8, 6, 4, 3, 2, 2, 1,
+};
+
+static void *
+bench_malloc(size_t size, void *data)
+{
+	allocations++;
+	return malloc(size);
+}
+
+static void *
+bench_realloc(void *ptr, size_t size, void *data)
+{
+	allocations++;
+	return realloc(ptr, size);
+}
+
+static void
+bench_free(void *ptr, void *data)
+{
+	free(ptr);
+}
+
+static const struct libinput_allocator bench_allocator = {
+	.malloc_func = bench_malloc,
+	.realloc_func = bench_realloc,
+	.free_func = bench_free,
+};
+
+static inline uint64_t
+now_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+frame_init(struct frame *f, uint64_t time)
+{
+	f->count = 0;
+	f->time = BENCH_START_TIME + time;
+}
+
+static void
+frame_add(struct frame *f, unsigned int type, unsigned int code, int value)
+{
+	struct input_event *ev = &f->events[f->count++];
+
+	ev->time.tv_sec = f->time / 1000000;
+	ev->time.tv_usec = f->time % 1000000;
+	ev->type = type;
+	ev->code = code;
+	ev->value = value;
+}
+
+static struct libevdev *
+mouse_description(void)
+{
+	struct libevdev *evdev = libevdev_new();
+
+	if (!evdev)
+		return NULL;
+
+	libevdev_set_name(evdev, "bench mouse");
+	libevdev_set_id_bustype(evdev, BUS_USB);
+	libevdev_enable_event_code(evdev, EV_REL, REL_X, NULL);
+	libevdev_enable_event_code(evdev, EV_REL, REL_Y, NULL);
+	libevdev_enable_event_code(evdev, EV_REL, REL_WHEEL, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_LEFT, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_RIGHT, NULL);
+
+	return evdev;
+}
+
+static struct libevdev *
+touchpad_description(bool clickpad)
+{
+	struct libevdev *evdev = libevdev_new();
+	struct input_absinfo x = { .minimum = 0, .maximum = 4000,
+				   .resolution = 40 };
+	struct input_absinfo y = { .minimum = 0, .maximum = 3000,
+				   .resolution = 40 };
+	struct input_absinfo slot = { .minimum = 0, .maximum = 4 };
+	struct input_absinfo tracking_id = { .minimum = 0,
+					     .maximum = 65535 };
+
+	if (!evdev)
+		return NULL;
+
+	libevdev_set_name(evdev, "bench touchpad");
+	libevdev_set_id_bustype(evdev, BUS_I8042);
+	libevdev_enable_property(evdev, INPUT_PROP_POINTER);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_X, &x);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_Y, &y);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_MT_SLOT, &slot);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_MT_POSITION_X, &x);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_MT_POSITION_Y, &y);
+	libevdev_enable_event_code(evdev, EV_ABS, ABS_MT_TRACKING_ID,
+				   &tracking_id);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_LEFT, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_TOUCH, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_TOOL_FINGER, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_TOOL_DOUBLETAP, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_TOOL_TRIPLETAP, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_TOOL_QUADTAP, NULL);
+	libevdev_enable_event_code(evdev, EV_KEY, BTN_TOOL_QUINTTAP, NULL);
+
+	if (clickpad)
+		libevdev_enable_property(evdev, INPUT_PROP_BUTTONPAD);
+	else
+		libevdev_enable_event_code(evdev, EV_KEY, BTN_RIGHT, NULL);
+
+	return evdev;
+}
+
+static unsigned int
+btn_tool(unsigned int nfingers)
+{
+	static const unsigned int tools[] = {
+		BTN_TOOL_FINGER,
+		BTN_TOOL_DOUBLETAP,
+		BTN_TOOL_TRIPLETAP,
+		BTN_TOOL_QUADTAP,
+		BTN_TOOL_QUINTTAP,
+	};
+
+	return tools[nfingers - 1];
+}
+
+static void
+touch_down(struct bench_state *state, struct frame *f, int x, int y)
+{
+	unsigned int s;
+
+	for (s = 0; s < state->nfingers; s++) {
+		frame_add(f, EV_ABS, ABS_MT_SLOT, s);
+		frame_add(f, EV_ABS, ABS_MT_TRACKING_ID, state->tracking_id++);
+		frame_add(f, EV_ABS, ABS_MT_POSITION_X, x + s * 400);
+		frame_add(f, EV_ABS, ABS_MT_POSITION_Y, y);
+	}
+	frame_add(f, EV_ABS, ABS_X, x);
+	frame_add(f, EV_ABS, ABS_Y, y);
+	frame_add(f, EV_KEY, BTN_TOUCH, 1);
+	frame_add(f, EV_KEY, btn_tool(state->nfingers), 1);
+	frame_add(f, EV_SYN, SYN_REPORT, 0);
+
+	state->tracking_id &= 0xffff;
+}
+
+static void
+touch_move(struct bench_state *state, struct frame *f, int x, int y)
+{
+	unsigned int s;
+
+	for (s = 0; s < state->nfingers; s++) {
+		frame_add(f, EV_ABS, ABS_MT_SLOT, s);
+		frame_add(f, EV_ABS, ABS_MT_POSITION_X, x + s * 400);
+		frame_add(f, EV_ABS, ABS_MT_POSITION_Y, y);
+	}
+	frame_add(f, EV_ABS, ABS_X, x);
+	frame_add(f, EV_ABS, ABS_Y, y);
+	frame_add(f, EV_SYN, SYN_REPORT, 0);
+}
+
+static void
+touch_up(struct bench_state *state, struct frame *f)
+{
+	unsigned int s;
+
+	for (s = 0; s < state->nfingers; s++) {
+		frame_add(f, EV_ABS, ABS_MT_SLOT, s);
+		frame_add(f, EV_ABS, ABS_MT_TRACKING_ID, -1);
+	}
+	frame_add(f, EV_KEY, BTN_TOUCH, 0);
+	frame_add(f, EV_KEY, btn_tool(state->nfingers), 0);
+	frame_add(f, EV_SYN, SYN_REPORT, 0);
+}
+
+/* Fingers go down, move for 48 frames and lift off again */
+static void
+touchpad_motion_frame(struct bench_state *state,
+		      struct frame *f,
+		      unsigned int n)
+{
+	unsigned int k = n % 50;
+
+	frame_init(f, n * TP_FRAME_INTERVAL);
+
+	if (k == 0)
+		touch_down(state, f, 1000, 1000);
+	else if (k == 49)
+		touch_up(state, f);
+	else
+		touch_move(state, f, 1000 + k * 15, 1000 + k * 20);
+}
+
+/* One finger in the right software button area, clicking */
+static void
+touchpad_clickpad_frame(struct bench_state *state,
+			struct frame *f,
+			unsigned int n)
+{
+	unsigned int k = n % 20;
+
+	frame_init(f, n * TP_FRAME_INTERVAL);
+
+	if (k == 0) {
+		touch_down(state, f, 3500, 2850);
+	} else if (k == 19) {
+		touch_up(state, f);
+	} else {
+		if (k == 5)
+			frame_add(f, EV_KEY, BTN_LEFT, 1);
+		else if (k == 10)
+			frame_add(f, EV_KEY, BTN_LEFT, 0);
+		touch_move(state, f, 3500 + k % 2, 2850);
+	}
+}
+
+/* One finger moving down the right edge */
+static void
+touchpad_edge_scroll_frame(struct bench_state *state,
+			   struct frame *f,
+			   unsigned int n)
+{
+	unsigned int k = n % 50;
+
+	frame_init(f, n * TP_FRAME_INTERVAL);
+
+	if (k == 0)
+		touch_down(state, f, 3980, 200);
+	else if (k == 49)
+		touch_up(state, f);
+	else
+		touch_move(state, f, 3980, 200 + k * 50);
+}
+
+/* Taps, the gap after each is long enough for the timeout to expire */
+static void
+touchpad_tap_frame(struct bench_state *state,
+		   struct frame *f,
+		   unsigned int n)
+{
+	uint64_t cycle = n / 2;
+
+	if (n % 2 == 0) {
+		frame_init(f, cycle * ms2us(500));
+		touch_down(state, f, 2000, 1500);
+	} else {
+		frame_init(f, cycle * ms2us(500) + ms2us(50));
+		touch_up(state, f);
+	}
+}
+
+static void
+mouse_motion_frame(struct bench_state *state,
+		   struct frame *f,
+		   unsigned int n)
+{
+	int delta = mouse_deltas[n % ARRAY_LENGTH(mouse_deltas)];
+
+	frame_init(f, n * MOUSE_FRAME_INTERVAL);
+	frame_add(f, EV_REL, REL_X, delta);
+	frame_add(f, EV_REL, REL_Y, (n / 64) % 2 ? -delta / 2 : delta / 2);
+	frame_add(f, EV_SYN, SYN_REPORT, 0);
+}
+
+/* Left+right for a middle click, then left and right on their own */
+static void
+mouse_middlebutton_frame(struct bench_state *state,
+			 struct frame *f,
+			 unsigned int n)
+{
+	static const struct {
+		unsigned int button;
+		int value;
+	} sequence[] = {
+		{ BTN_LEFT, 1 },
+		{ BTN_RIGHT, 1 },
+		{ BTN_LEFT, 0 },
+		{ BTN_RIGHT, 0 },
+		{ BTN_LEFT, 1 },
+		{ BTN_LEFT, 0 },
+		{ BTN_RIGHT, 1 },
+		{ BTN_RIGHT, 0 },
+	};
+	unsigned int k = n % ARRAY_LENGTH(sequence);
+
+	frame_init(f, n * ms2us(20));
+	frame_add(f, EV_KEY, sequence[k].button, sequence[k].value);
+	frame_add(f, EV_SYN, SYN_REPORT, 0);
+}
+
+static void
+setup_tap(struct libinput_device *device)
+{
+	libinput_device_config_tap_set_enabled(device,
+					       LIBINPUT_CONFIG_TAP_ENABLED);
+}
+
+static void
+setup_edge_scroll(struct libinput_device *device)
+{
+	libinput_device_config_scroll_set_method(device,
+						 LIBINPUT_CONFIG_SCROLL_EDGE);
+}
+
+static void
+setup_middlebutton(struct libinput_device *device)
+{
+	libinput_device_config_middle_emulation_set_enabled(device,
+			LIBINPUT_CONFIG_MIDDLE_EMULATION_ENABLED);
+}
+
+static const struct bench benchmarks[] = {
+	{ "fallback-motion", false, false, NULL, mouse_motion_frame, 0 },
+	{ "fallback-middlebutton", false, false, setup_middlebutton,
+	  mouse_middlebutton_frame, 0 },
+	{ "touchpad-1fg", true, false, NULL, touchpad_motion_frame, 1 },
+	{ "touchpad-2fg", true, false, NULL, touchpad_motion_frame, 2 },
+	{ "touchpad-3fg", true, false, NULL, touchpad_motion_frame, 3 },
+	{ "touchpad-4fg", true, false, NULL, touchpad_motion_frame, 4 },
+	{ "touchpad-5fg", true, false, NULL, touchpad_motion_frame, 5 },
+	{ "touchpad-clickpad", true, true, NULL, touchpad_clickpad_frame, 1 },
+	{ "touchpad-edge-scroll", true, false, setup_edge_scroll,
+	  touchpad_edge_scroll_frame, 1 },
+	{ "touchpad-tap", true, false, setup_tap, touchpad_tap_frame, 1 },
+};
+
+static uint64_t
+drain_events(struct libinput *li)
+{
+	struct libinput_event *event;
+	uint64_t count = 0;
+
+	while ((event = libinput_get_event(li))) {
+		libinput_event_destroy(event);
+		count++;
+	}
+
+	return count;
+}
+
+static void
+push_frames(struct libinput_device *device,
+	    const struct bench *bench,
+	    struct bench_state *state,
+	    unsigned int first,
+	    unsigned int nframes,
+	    struct bench_result *result)
+{
+	struct libinput *li = libinput_device_get_context(device);
+	struct frame f;
+	unsigned int n;
+
+	for (n = first; n < first + nframes; n++) {
+		bench->frame(state, &f, n);
+		libinput_replay_device_push_events(device, f.events, f.count);
+		result->out += drain_events(li);
+		result->events += f.count;
+	}
+}
+
+static int
+run_device_bench(const struct bench *bench,
+		 unsigned int nframes,
+		 struct bench_result *result)
+{
+	struct libinput *li;
+	struct libinput_device *device;
+	struct libevdev *evdev;
+	struct bench_state state;
+	struct bench_result warmup;
+	unsigned int nwarmup = nframes / WARMUP_DIVISOR;
+	uint64_t start, allocs;
+
+	li = libinput_replay_create_context(NULL, &bench_allocator);
+	if (!li)
+		return -1;
+
+	evdev = bench->touchpad ? touchpad_description(bench->clickpad) :
+				  mouse_description();
+	device = evdev ? libinput_replay_add_device(li, evdev,
+						    bench->touchpad ?
+						    touchpad_properties :
+						    mouse_properties) :
+			 NULL;
+	if (!device) {
+		libevdev_free(evdev);
+		libinput_unref(li);
+		return -1;
+	}
+
+	if (bench->setup)
+		bench->setup(device);
+	drain_events(li);
+
+	memset(&state, 0, sizeof(state));
+	state.nfingers = bench->nfingers;
+
+	/* fill the event pools, the velocity trackers, etc. */
+	memset(&warmup, 0, sizeof(warmup));
+	push_frames(device, bench, &state, 0, nwarmup, &warmup);
+
+	memset(result, 0, sizeof(*result));
+	allocs = allocations;
+	start = now_nsec();
+	push_frames(device, bench, &state, nwarmup, nframes, result);
+	result->nsec = now_nsec() - start;
+	result->allocs = allocations - allocs;
+
+	libinput_unref(li);
+
+	return 0;
+}
+
+static int
+run_recording_bench(const struct record_file *file,
+		    struct bench_result *result)
+{
+	const struct record_header *header = file->header;
+	struct libinput *li;
+	struct libinput_device **devices;
+	uint64_t nwarmup = header->nevents / WARMUP_DIVISOR;
+	uint64_t i = 0;
+	uint64_t start, allocs;
+	uint32_t d;
+	int n, rc = -1;
+
+	li = libinput_replay_create_context(NULL, &bench_allocator);
+	if (!li)
+		return -1;
+
+	devices = calloc(header->ndevices, sizeof(*devices));
+	if (!devices && header->ndevices > 0)
+		goto out;
+
+	for (d = 0; d < header->ndevices; d++) {
+		devices[d] = record_add_device(li, &file->devices[d]);
+		if (!devices[d]) {
+			fprintf(stderr, "Failed to add %s\n",
+				file->devices[d].name);
+			goto out;
+		}
+	}
+	drain_events(li);
+
+	/* the first tenth of the recording warms up, untimed */
+	while (i < nwarmup) {
+		if (record_push_events(file, devices, &i) < 0)
+			goto out;
+		drain_events(li);
+	}
+
+	memset(result, 0, sizeof(*result));
+	allocs = allocations;
+	start = now_nsec();
+	while (i < header->nevents) {
+		n = record_push_events(file, devices, &i);
+		if (n < 0)
+			goto out;
+		result->events += n;
+		result->out += drain_events(li);
+	}
+	if (header->nevents > 0) {
+		libinput_replay_set_time(li,
+					 file->events[header->nevents - 1].time +
+					 RECORDING_TRAILING_TIME);
+		result->out += drain_events(li);
+	}
+	result->nsec = now_nsec() - start;
+	result->allocs = allocations - allocs;
+
+	rc = 0;
+out:
+	libinput_unref(li);
+	free(devices);
+
+	return rc;
+}
+
+static void
+dispatch_deltas(struct motion_filter *filter,
+		bool batch,
+		const struct normalized_coords *in,
+		struct normalized_coords *out,
+		const uint64_t *times,
+		unsigned int ndeltas)
+{
+	unsigned int n, count;
+
+	for (n = 0; n < ndeltas && !batch; n++)
+		out[n] = filter_dispatch(filter, &in[n], NULL, times[n]);
+
+	/* the same deltas, FILTER_BATCH_SIZE at a time */
+	for (n = 0; n < ndeltas && batch; n += count) {
+		count = min(ndeltas - n, FILTER_BATCH_SIZE);
+		filter_dispatch_batch(filter, in + n, out + n, times + n,
+				      count, NULL);
+	}
+}
+
+static int
+run_filter_bench(accel_profile_func_t profile,
+		 bool batch,
+		 unsigned int nframes,
+		 struct bench_result *result)
+{
+	struct motion_filter *filter;
+	struct mem_allocator mem;
+	struct normalized_coords *deltas, *accel;
+	uint64_t *times;
+	unsigned int nwarmup = nframes / WARMUP_DIVISOR;
+	unsigned int ndeltas = nwarmup + nframes;
+	unsigned int n;
+	uint64_t start, allocs;
+	double sum = 0.0;
+	int rc = -1;
+
+	mem_allocator_init(&mem, &bench_allocator);
+	filter = create_pointer_accelerator_filter(profile, &mem);
+	deltas = calloc(ndeltas, sizeof(*deltas));
+	accel = calloc(ndeltas, sizeof(*accel));
+	times = calloc(ndeltas, sizeof(*times));
+	if (!filter || !deltas || !accel || !times)
+		goto out;
+
+	/* the input is generated up front, only the filter is timed */
+	for (n = 0; n < ndeltas; n++) {
+		deltas[n].x = mouse_deltas[n % ARRAY_LENGTH(mouse_deltas)];
+		deltas[n].y = deltas[n].x / 2;
+		times[n] = n * MOUSE_FRAME_INTERVAL;
+	}
+
+	/* fill the velocity trackers */
+	dispatch_deltas(filter, batch, deltas, accel, times, nwarmup);
+
+	memset(result, 0, sizeof(*result));
+	allocs = allocations;
+	start = now_nsec();
+	dispatch_deltas(filter, batch, deltas + nwarmup, accel + nwarmup,
+			times + nwarmup, nframes);
+	result->nsec = now_nsec() - start;
+	result->allocs = allocations - allocs;
+	result->events = nframes;
+	result->out = nframes;
+
+	for (n = nwarmup; n < ndeltas; n++)
+		sum += accel[n].x;
+	filter_sink = sum;
+
+	rc = 0;
+out:
+	if (filter)
+		filter_destroy(filter);
+	free(deltas);
+	free(accel);
+	free(times);
+
+	return rc;
+}
+
+static const struct filter_bench {
+	const char *name;
+	accel_profile_func_t profile;
+	bool batch;
+} filter_benchmarks[] = {
+	{ "filter-pointer", pointer_accel_profile_linear, false },
+	{ "filter-pointer-batch", pointer_accel_profile_linear, true },
+	{ "filter-touchpad", touchpad_accel_profile_linear, false },
+	{ "filter-touchpad-batch", touchpad_accel_profile_linear, true },
+};
+
+static void
+print_result(const char *name, const struct bench_result *r)
+{
+	double events = r->events ? r->events : 1;
+
+	printf("%s\t%" PRIu64 "\t%" PRIu64 "\t%.1f\t%.4f\t%.0f\n",
+	       name,
+	       r->events,
+	       r->out,
+	       r->nsec / events,
+	       r->allocs / events,
+	       r->nsec ? r->events * 1e9 / r->nsec : 0.0);
+}
+
+static bool
+bench_selected(const char *name, int argc, char **argv)
+{
+	int i;
+
+	if (optind >= argc)
+		return true;
+
+	for (i = optind; i < argc; i++) {
+		if (strstr(name, argv[i]))
+			return true;
+	}
+
+	return false;
+}
+
+static void
+usage(void)
+{
+	printf("Usage: %s [--frames N] [name ...]\n"
+	       "       %s --recording FILE\n"
+	       "\n"
+	       "Run the input pipeline microbenchmarks, or those whose name\n"
+	       "contains one of the given strings. No devices are needed.\n"
+	       "\n"
+	       "--frames N ......... number of hardware frames per benchmark\n"
+	       "                     (default 100000)\n"
+	       "--recording FILE ... replay a recording made with libinput-record\n"
+	       "                     instead of the synthetic streams\n"
+	       "--help ............. print this help\n"
+	       "\n"
+	       "The output is tab-separated, one benchmark per line. 'events'\n"
+	       "are kernel events in (deltas for the filter benchmarks), 'out'\n"
+	       "the libinput events produced.\n",
+	       program_invocation_short_name,
+	       program_invocation_short_name);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct bench_result result;
+	struct record_file file;
+	const char *recording = NULL;
+	const char *error;
+	unsigned int nframes = 100000;
+	size_t i;
+	int rc = 0;
+
+	while (1) {
+		int c;
+		int option_index = 0;
+		static struct option opts[] = {
+			{ "frames", 1, 0, 'n' },
+			{ "recording", 1, 0, 'r' },
+			{ "help", 0, 0, 'h' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "hn:r:", opts, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			usage();
+			return 0;
+		case 'n':
+			nframes = strtoul(optarg, NULL, 10);
+			if (nframes == 0) {
+				usage();
+				return 1;
+			}
+			break;
+		case 'r':
+			recording = optarg;
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	printf("# libinput %s\n", LIBINPUT_VERSION);
+	printf("# name\tevents\tout\tns/event\tallocs/event\tevents/s\n");
+
+	if (recording) {
+		error = record_file_open(&file, recording);
+		if (error) {
+			fprintf(stderr, "%s: %s\n", recording, error);
+			return 1;
+		}
+
+		if (run_recording_bench(&file, &result) != 0) {
+			fprintf(stderr, "%s: failed to replay\n", recording);
+			rc = 1;
+		} else {
+			print_result(recording, &result);
+		}
+
+		record_file_close(&file);
+		return rc;
+	}
+
+	for (i = 0; i < ARRAY_LENGTH(benchmarks); i++) {
+		if (!bench_selected(benchmarks[i].name, argc, argv))
+			continue;
+
+		if (run_device_bench(&benchmarks[i], nframes, &result) != 0) {
+			fprintf(stderr, "%s: failed to set up\n",
+				benchmarks[i].name);
+			rc = 1;
+			continue;
+		}
+		print_result(benchmarks[i].name, &result);
+	}
+
+	for (i = 0; i < ARRAY_LENGTH(filter_benchmarks); i++) {
+		if (!bench_selected(filter_benchmarks[i].name, argc, argv))
+			continue;
+
+		if (run_filter_bench(filter_benchmarks[i].profile,
+				     filter_benchmarks[i].batch,
+				     nframes, &result) != 0) {
+			fprintf(stderr, "%s: failed to set up\n",
+				filter_benchmarks[i].name);
+			rc = 1;
+			continue;
+		}
+		print_result(filter_benchmarks[i].name, &result);
+	}
+
+	return rc;
+}
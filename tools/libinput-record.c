@@ -0,0 +1,407 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <libudev.h>
+
+#include <libevdev/libevdev.h>
+#include <libinput-util.h>
+
+#include "record-format.h"
+
+#define MAX_DEVICES 16
+
+/* The udev properties libinput looks at */
+static const char *property_prefixes[] = {
+	"ID_INPUT",
+	"LIBINPUT_",
+	"MOUSE_",
+	"POINTINGSTICK_",
+	"TOUCHPAD_",
+};
+
+static volatile sig_atomic_t stop;
+
+static void
+usage(void)
+{
+	printf("Usage: %s --output <file> /dev/input/event0 [/dev/input/event1 ...]\n"
+	       "\n"
+	       "Record the description and the events of the given devices until\n"
+	       "interrupted, for libinput-replay. Needs read access to the\n"
+	       "device nodes.\n"
+	       "\n"
+	       "--output <file> .... the file to write the recording to\n"
+	       "--help ............. print this help\n",
+	       program_invocation_short_name);
+}
+
+static void
+sighandler(int signal)
+{
+	stop = 1;
+}
+
+static bool
+property_is_relevant(const char *key)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_LENGTH(property_prefixes); i++) {
+		if (strneq(key, property_prefixes[i],
+			   strlen(property_prefixes[i])))
+			return true;
+	}
+
+	return false;
+}
+
+static bool
+properties_contain(const char *properties, size_t len, const char *key)
+{
+	size_t keylen = strlen(key);
+	const char *p = properties;
+
+	while (p < properties + len) {
+		if (strneq(p, key, keylen) && p[keylen] == '=')
+			return true;
+		p += strlen(p) + 1;
+	}
+
+	return false;
+}
+
+static void
+record_udev_properties(struct record_device *d, int fd)
+{
+	struct udev *udev;
+	struct udev_device *devices[2] = { NULL, NULL };
+	struct udev_list_entry *entry;
+	struct stat st;
+	const char *key, *value;
+	size_t used = 0, len;
+	int i;
+
+	if (fstat(fd, &st) < 0)
+		return;
+
+	udev = udev_new();
+	if (!udev)
+		return;
+
+	/* libinput takes the ID_INPUT tags from the parent too */
+	devices[0] = udev_device_new_from_devnum(udev, 'c', st.st_rdev);
+	if (devices[0])
+		devices[1] = udev_device_get_parent(devices[0]);
+
+	for (i = 0; i < 2 && devices[i]; i++) {
+		udev_list_entry_foreach(entry,
+			udev_device_get_properties_list_entry(devices[i])) {
+			key = udev_list_entry_get_name(entry);
+			value = udev_list_entry_get_value(entry);
+
+			if (!property_is_relevant(key) ||
+			    (i > 0 && !strneq(key, "ID_INPUT", 8)) ||
+			    properties_contain(d->properties, used, key))
+				continue;
+
+			/* leave room for the terminating empty string */
+			len = strlen(key) + strlen(value) + 2;
+			if (used + len + 1 > sizeof(d->properties)) {
+				fprintf(stderr,
+					"Too many udev properties, dropping %s\n",
+					key);
+				continue;
+			}
+
+			snprintf(d->properties + used, len, "%s=%s", key, value);
+			used += len;
+		}
+	}
+
+	if (devices[0])
+		udev_device_unref(devices[0]);
+	udev_unref(udev);
+}
+
+static void
+record_describe_device(struct record_device *d,
+		       struct libevdev *evdev,
+		       int fd)
+{
+	const struct input_absinfo *abs;
+	unsigned int type, code;
+	int max;
+
+	memset(d, 0, sizeof(*d));
+
+	snprintf(d->name, sizeof(d->name), "%s", libevdev_get_name(evdev));
+	d->bustype = libevdev_get_id_bustype(evdev);
+	d->vendor = libevdev_get_id_vendor(evdev);
+	d->product = libevdev_get_id_product(evdev);
+	d->version = libevdev_get_id_version(evdev);
+
+	for (code = 0; code < RECORD_PROP_CNT; code++) {
+		if (libevdev_has_property(evdev, code))
+			record_set_bit(d->props, code);
+	}
+
+	for (type = 0; type < RECORD_EV_CNT; type++) {
+		max = libevdev_event_type_get_max(type);
+		for (code = 0; (int)code <= max && code < RECORD_CODE_CNT; code++) {
+			if (libevdev_has_event_code(evdev, type, code))
+				record_set_bit(d->bits[type], code);
+		}
+	}
+
+	for (code = 0; code < RECORD_ABS_CNT; code++) {
+		abs = libevdev_get_abs_info(evdev, code);
+		if (!abs)
+			continue;
+
+		d->absinfo[code].value = abs->value;
+		d->absinfo[code].minimum = abs->minimum;
+		d->absinfo[code].maximum = abs->maximum;
+		d->absinfo[code].fuzz = abs->fuzz;
+		d->absinfo[code].flat = abs->flat;
+		d->absinfo[code].resolution = abs->resolution;
+	}
+
+	record_udev_properties(d, fd);
+}
+
+static void
+record_event(FILE *fp,
+	     uint32_t device,
+	     const struct input_event *ev,
+	     uint64_t *nevents)
+{
+	struct record_event r;
+
+	memset(&r, 0, sizeof(r));
+	r.time = ev->time.tv_sec * 1000000ULL + ev->time.tv_usec;
+	r.device = device;
+	r.type = ev->type;
+	r.code = ev->code;
+	r.value = ev->value;
+
+	if (fwrite(&r, sizeof(r), 1, fp) == 1)
+		(*nevents)++;
+}
+
+/* Records what evdev_device_dispatch() passes on to the dispatch */
+static int
+record_read_device(FILE *fp,
+		   struct libevdev *evdev,
+		   uint32_t device,
+		   uint64_t *nevents)
+{
+	struct input_event ev;
+	int rc;
+
+	do {
+		rc = libevdev_next_event(evdev, LIBEVDEV_READ_FLAG_NORMAL, &ev);
+		if (rc == LIBEVDEV_READ_STATUS_SYNC) {
+			/* one SYN_REPORT to terminate the frame before the
+			 * drop, then the device state as sync events */
+			ev.code = SYN_REPORT;
+			record_event(fp, device, &ev, nevents);
+
+			do {
+				rc = libevdev_next_event(evdev,
+							 LIBEVDEV_READ_FLAG_SYNC,
+							 &ev);
+				if (rc < 0)
+					break;
+				record_event(fp, device, &ev, nevents);
+			} while (rc == LIBEVDEV_READ_STATUS_SYNC);
+
+			if (rc == -EAGAIN)
+				rc = LIBEVDEV_READ_STATUS_SUCCESS;
+		} else if (rc == LIBEVDEV_READ_STATUS_SUCCESS) {
+			record_event(fp, device, &ev, nevents);
+		}
+	} while (rc == LIBEVDEV_READ_STATUS_SUCCESS);
+
+	return rc == -EAGAIN ? 0 : rc;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct libevdev *evdevs[MAX_DEVICES] = { NULL };
+	struct pollfd fds[MAX_DEVICES];
+	struct record_header header;
+	struct record_device device;
+	const char *output = NULL;
+	FILE *fp = NULL;
+	int ndevices = 0, nactive;
+	int i, rc = 1;
+
+	while (1) {
+		int c;
+		int option_index = 0;
+		static struct option opts[] = {
+			{ "output", 1, 0, 'o' },
+			{ "help", 0, 0, 'h' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "ho:", opts, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			usage();
+			return 0;
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	if (!output || optind >= argc) {
+		usage();
+		return 1;
+	}
+
+	if (argc - optind > MAX_DEVICES) {
+		fprintf(stderr, "At most %d devices can be recorded\n",
+			MAX_DEVICES);
+		return 1;
+	}
+
+	fp = fopen(output, "w");
+	if (!fp) {
+		fprintf(stderr, "Failed to open %s: %s\n",
+			output, strerror(errno));
+		return 1;
+	}
+
+	/* nevents is filled in once we're done */
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+	header.byteorder = RECORD_BYTEORDER;
+	header.ndevices = argc - optind;
+	header.events_offset = sizeof(header) +
+			       header.ndevices * sizeof(device);
+	fwrite(&header, sizeof(header), 1, fp);
+
+	for (i = optind; i < argc; i++) {
+		const char *path = argv[i];
+		int fd;
+
+		fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0) {
+			fprintf(stderr, "Failed to open %s: %s\n",
+				path, strerror(errno));
+			goto out;
+		}
+
+		fds[ndevices].fd = fd;
+		fds[ndevices].events = POLLIN;
+		ndevices++;
+
+		if (libevdev_new_from_fd(fd, &evdevs[ndevices - 1]) < 0) {
+			fprintf(stderr, "Failed to initialize %s\n", path);
+			goto out;
+		}
+
+		/* the timestamps libinput sees */
+		libevdev_set_clock_id(evdevs[ndevices - 1], CLOCK_MONOTONIC);
+
+		record_describe_device(&device, evdevs[ndevices - 1], fd);
+		fwrite(&device, sizeof(device), 1, fp);
+
+		fprintf(stderr, "Recording %s: %s\n", path, device.name);
+	}
+
+	signal(SIGINT, sighandler);
+	signal(SIGTERM, sighandler);
+
+	nactive = ndevices;
+	while (!stop && nactive > 0) {
+		if (poll(fds, ndevices, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "poll failed: %s\n", strerror(errno));
+			break;
+		}
+
+		for (i = 0; i < ndevices; i++) {
+			if (fds[i].fd < 0 || fds[i].revents == 0)
+				continue;
+
+			if (record_read_device(fp, evdevs[i], i,
+					       &header.nevents) < 0) {
+				fprintf(stderr, "%s went away\n",
+					libevdev_get_name(evdevs[i]));
+				/* poll() ignores negative fds */
+				close(fds[i].fd);
+				fds[i].fd = -1;
+				nactive--;
+			}
+		}
+	}
+
+	if (fseek(fp, 0, SEEK_SET) != 0 ||
+	    fwrite(&header, sizeof(header), 1, fp) != 1) {
+		fprintf(stderr, "Failed to write %s: %s\n",
+			output, strerror(errno));
+		goto out;
+	}
+
+	fprintf(stderr, "Recorded %" PRIu64 " events to %s\n",
+		header.nevents, output);
+	rc = 0;
+
+out:
+	for (i = 0; i < ndevices; i++) {
+		libevdev_free(evdevs[i]);
+		if (fds[i].fd >= 0)
+			close(fds[i].fd);
+	}
+
+	if (fclose(fp) != 0)
+		rc = 1;
+
+	return rc;
+}
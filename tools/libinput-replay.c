@@ -0,0 +1,267 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+#include <config.h>
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <libinput.h>
+#include <libinput-util.h>
+
+#include "record-replay.h"
+#include "shared.h"
+
+/* Timers still pending at the end of the recording get this long */
+#define REPLAY_TRAILING_TIME ms2us(10000)
+
+static bool quiet;
+static bool tapping;
+
+static void
+usage(void)
+{
+	printf("Usage: %s [options] <file>\n"
+	       "\n"
+	       "Replay a recording made with libinput-record through libinput and\n"
+	       "print the resulting events. No access to the recorded devices is\n"
+	       "needed, the events are processed as fast as possible.\n"
+	       "\n"
+	       "--enable-tap .... enable tapping on touchpads\n"
+	       "--quiet ......... only print the summary\n"
+	       "--verbose ....... print debugging output\n"
+	       "--help .......... print this help\n",
+	       program_invocation_short_name);
+}
+
+static void
+log_handler(struct libinput *li,
+	    enum libinput_log_priority priority,
+	    const char *format,
+	    va_list args)
+{
+	vprintf(format, args);
+}
+
+static struct libinput_device *
+replay_add_device(struct libinput *li, const struct record_device *d)
+{
+	struct libinput_device *device;
+
+	device = record_add_device(li, d);
+	if (device && tapping)
+		libinput_device_config_tap_set_enabled(device,
+						       LIBINPUT_CONFIG_TAP_ENABLED);
+
+	return device;
+}
+
+static uint64_t
+event_time(struct libinput_event *ev)
+{
+	switch (libinput_event_get_type(ev)) {
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return libinput_event_keyboard_get_time_usec(
+				libinput_event_get_keyboard_event(ev));
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		return libinput_event_pointer_get_time_usec(
+				libinput_event_get_pointer_event(ev));
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		return libinput_event_touch_get_time_usec(
+				libinput_event_get_touch_event(ev));
+	default:
+		return 0;
+	}
+}
+
+static uint64_t
+handle_events(struct libinput *li, uint64_t start_time)
+{
+	struct libinput_event *ev;
+	uint64_t count = 0, time;
+
+	while ((ev = libinput_get_event(li))) {
+		count++;
+
+		if (!quiet) {
+			time = event_time(ev);
+			printf("%-7s	%-24s",
+			       libinput_device_get_sysname(
+					libinput_event_get_device(ev)),
+			       tools_event_type_name(libinput_event_get_type(ev)));
+			if (time)
+				printf("	%+10.3fs",
+				       ((int64_t)(time - start_time)) / 1e6);
+			printf("\n");
+		}
+
+		libinput_event_destroy(ev);
+	}
+
+	return count;
+}
+
+static int
+replay(struct libinput *li,
+       const struct record_file *file,
+       struct libinput_device **devices)
+{
+	const struct record_header *header = file->header;
+	struct timespec start, end;
+	uint64_t i, nlibinput = 0, start_time = 0, last_time = 0;
+	double msec;
+
+	if (header->nevents > 0)
+		start_time = file->events[0].time;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	nlibinput += handle_events(li, start_time);
+
+	i = 0;
+	while (i < header->nevents) {
+		if (record_push_events(file, devices, &i) < 0) {
+			fprintf(stderr,
+				"Event %" PRIu64 " refers to an invalid device\n",
+				i);
+			return 1;
+		}
+		last_time = file->events[i - 1].time;
+		nlibinput += handle_events(li, start_time);
+	}
+
+	libinput_replay_set_time(li, last_time + REPLAY_TRAILING_TIME);
+	nlibinput += handle_events(li, start_time);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	msec = (end.tv_sec - start.tv_sec) * 1e3 +
+	       (end.tv_nsec - start.tv_nsec) / 1e6;
+
+	printf("%u devices, %" PRIu64 " kernel events, %" PRIu64
+	       " libinput events in %.3fms (%.0f kernel events/s)\n",
+	       header->ndevices, header->nevents, nlibinput, msec,
+	       msec > 0 ? header->nevents / msec * 1e3 : 0.0);
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct libinput *li = NULL;
+	struct libinput_device **devices = NULL;
+	struct record_file file;
+	const char *error;
+	bool verbose = false;
+	uint32_t i;
+	int rc = 1;
+
+	while (1) {
+		int c;
+		int option_index = 0;
+		static struct option opts[] = {
+			{ "enable-tap", 0, 0, 't' },
+			{ "quiet", 0, 0, 'q' },
+			{ "verbose", 0, 0, 'v' },
+			{ "help", 0, 0, 'h' },
+			{ 0, 0, 0, 0 }
+		};
+
+		c = getopt_long(argc, argv, "h", opts, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			usage();
+			return 0;
+		case 't':
+			tapping = true;
+			break;
+		case 'q':
+			quiet = true;
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage();
+		return 1;
+	}
+
+	error = record_file_open(&file, argv[optind]);
+	if (error) {
+		fprintf(stderr, "%s: %s\n", argv[optind], error);
+		return 1;
+	}
+
+	li = libinput_replay_create_context(NULL, NULL);
+	if (!li) {
+		fprintf(stderr, "Failed to create the libinput context\n");
+		goto out;
+	}
+
+	if (verbose) {
+		libinput_log_set_handler(li, log_handler);
+		libinput_log_set_priority(li, LIBINPUT_LOG_PRIORITY_DEBUG);
+	}
+
+	devices = calloc(file.header->ndevices, sizeof(*devices));
+	if (!devices && file.header->ndevices > 0)
+		goto out;
+
+	for (i = 0; i < file.header->ndevices; i++) {
+		devices[i] = replay_add_device(li, &file.devices[i]);
+		if (!devices[i])
+			fprintf(stderr, "Failed to add %s, skipping its events\n",
+				file.devices[i].name);
+	}
+
+	rc = replay(li, &file, devices);
+
+out:
+	libinput_unref(li);
+	free(devices);
+	record_file_close(&file);
+
+	return rc;
+}
@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <filter.h>
 #include <getopt.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -49,7 +50,7 @@ print_ptraccel_deltas(struct motion_filter *filter, double step)
 	for (i = 0.0; i < 15.0; i += step) {
 		motion.x = i;
 		motion.y = 0;
-		time += 12; /* pretend 80Hz data */
+		time += 12000; /* pretend 80Hz data, in us */
 
 		motion = filter_dispatch(filter, &motion, NULL, time);
 
@@ -92,7 +93,7 @@ print_ptraccel_movement(struct motion_filter *filter,
 	for (i = 0; i < nevents; i++) {
 		motion.x = dx;
 		motion.y = 0;
-		time += 12; /* pretend 80Hz data */
+		time += 12000; /* pretend 80Hz data, in us */
 
 		filter_dispatch(filter, &motion, NULL, time);
 
@@ -108,9 +109,9 @@ print_ptraccel_sequence(struct motion_filter *filter,
 			int nevents,
 			double *deltas)
 {
-	struct normalized_coords motion;
+	struct normalized_coords motion[1024], accelerated[1024];
+	uint64_t times[1024];
 	uint64_t time = 0;
-	double *dx;
 	int i;
 
 	printf("# gnuplot:\n");
@@ -121,21 +122,21 @@ print_ptraccel_sequence(struct motion_filter *filter,
 	printf("#      \"gnuplot.data\" using 1:3 title \"dx in\"\n");
 	printf("#\n");
 
-	dx = deltas;
-
-	for (i = 0; i < nevents; i++, dx++) {
-		motion.x = *dx;
-		motion.y = 0;
-		time += 12; /* pretend 80Hz data */
+	for (i = 0; i < nevents; i++) {
+		motion[i].x = deltas[i];
+		motion[i].y = 0;
+		time += 12000; /* pretend 80Hz data, in us */
+		times[i] = time;
+	}
 
-		filter_dispatch(filter, &motion, NULL, time);
+	filter_dispatch_batch(filter, motion, accelerated, times, nevents, NULL);
 
-		printf("%d	%.3f	%.3f\n", i, motion.x, *dx);
-	}
+	for (i = 0; i < nevents; i++)
+		printf("%d	%.3f	%.3f\n", i, accelerated[i].x, deltas[i]);
 }
 
 static void
-print_accel_func(struct motion_filter *filter)
+print_accel_func(struct motion_filter *filter, accel_profile_func_t profile)
 {
 	double vel;
 
@@ -145,25 +146,56 @@ print_accel_func(struct motion_filter *filter)
 	printf("# set style data lines\n");
 	printf("# plot \"gnuplot.data\" using 1:2\n");
 	for (vel = 0.0; vel < 3.0; vel += .0001) {
-		double result = pointer_accel_profile_linear(filter,
-                                                             NULL,
-                                                             vel,
-                                                             0 /* time */);
+		double result = profile(filter,
+					NULL,
+					vel,
+					0 /* time */);
 		printf("%.4f\t%.4f\n", vel, result);
 	}
 }
 
+static void
+print_accel_error(struct motion_filter *filter, accel_profile_func_t profile)
+{
+	double vel;
+	double max_error = 0.0, max_vel = 0.0;
+
+	printf("# gnuplot:\n");
+	printf("# set xlabel \"speed\"\n");
+	printf("# set ylabel \"raw accel factor\"\n");
+	printf("# set style data lines\n");
+	printf("# plot \"gnuplot.data\" using 1:2 title \"profile\", \\\n");
+	printf("#      \"gnuplot.data\" using 1:3 title \"lookup\"\n");
+	printf("#\n");
+	for (vel = 0.0; vel < 10.0; vel += .0001) {
+		double expected = profile(filter, NULL, vel, 0 /* time */);
+		double result = pointer_accel_lookup(filter,
+						     NULL,
+						     vel,
+						     0 /* time */);
+		if (fabs(result - expected) > max_error) {
+			max_error = fabs(result - expected);
+			max_vel = vel;
+		}
+		printf("%.4f\t%.6f\t%.6f\n", vel, expected, result);
+	}
+	printf("# maximum error %.6f at speed %.4f\n", max_error, max_vel);
+}
+
 static void
 usage(void)
 {
 	printf("Usage: %s [options] [dx1] [dx2] [...] > gnuplot.data\n", program_invocation_short_name);
 	printf("\n"
 	       "Options:\n"
-	       "--mode=<motion|accel|delta|sequence> \n"
+	       "--mode=<motion|accel|error|delta|sequence> \n"
 	       "	motion   ... print motion to accelerated motion (default)\n"
 	       "	delta    ... print delta to accelerated delta\n"
 	       "	accel    ... print accel factor\n"
+	       "	error    ... print accel factor and its lookup table value,\n"
+	       "	             followed by the maximum difference\n"
 	       "	sequence ... print motion for custom delta sequence\n"
+	       "--profile=<linear|touchpad|x230>\n  ... the acceleration profile, default linear\n"
 	       "--maxdx=<double>\n  ... in motion mode only. Stop increasing dx at maxdx\n"
 	       "--steps=<double>\n  ... in motion and delta modes only. Increase dx by step each round\n"
 	       "--speed=<double>\n  ... accel speed [-1, 1], default 0\n"
@@ -181,10 +213,12 @@ int
 main(int argc, char **argv)
 {
 	struct motion_filter *filter;
+	accel_profile_func_t profile = pointer_accel_profile_linear;
 	double step = 0.1,
 	       max_dx = 10;
 	int nevents = 0;
 	bool print_accel = false,
+	     print_error = false,
 	     print_motion = true,
 	     print_delta = false,
 	     print_sequence = false;
@@ -196,11 +230,9 @@ main(int argc, char **argv)
 		OPT_MAXDX,
 		OPT_STEP,
 		OPT_SPEED,
+		OPT_PROFILE,
 	};
 
-	filter = create_pointer_accelerator_filter(pointer_accel_profile_linear);
-	assert(filter != NULL);
-
 	while (1) {
 		int c;
 		int option_index = 0;
@@ -210,6 +242,7 @@ main(int argc, char **argv)
 			{"maxdx", 1, 0, OPT_MAXDX },
 			{"step", 1, 0, OPT_STEP },
 			{"speed", 1, 0, OPT_SPEED },
+			{"profile", 1, 0, OPT_PROFILE },
 			{0, 0, 0, 0}
 		};
 
@@ -222,6 +255,8 @@ main(int argc, char **argv)
 		case OPT_MODE:
 			if (streq(optarg, "accel"))
 				print_accel = true;
+			else if (streq(optarg, "error"))
+				print_error = true;
 			else if (streq(optarg, "motion"))
 				print_motion = true;
 			else if (streq(optarg, "delta"))
@@ -257,6 +292,18 @@ main(int argc, char **argv)
 		case OPT_SPEED:
 			speed = strtod(optarg, NULL);
 			break;
+		case OPT_PROFILE:
+			if (streq(optarg, "linear"))
+				profile = pointer_accel_profile_linear;
+			else if (streq(optarg, "touchpad"))
+				profile = touchpad_accel_profile_linear;
+			else if (streq(optarg, "x230"))
+				profile = touchpad_lenovo_x230_accel_profile;
+			else {
+				usage();
+				return 1;
+			}
+			break;
 		default:
 			usage();
 			exit(1);
@@ -264,6 +311,9 @@ main(int argc, char **argv)
 		}
 	}
 
+	filter = create_pointer_accelerator_filter(profile, NULL);
+	assert(filter != NULL);
+
 	filter_set_speed(filter, speed);
 
 	if (!isatty(STDIN_FILENO)) {
@@ -286,7 +336,9 @@ main(int argc, char **argv)
 	}
 
 	if (print_accel)
-		print_accel_func(filter);
+		print_accel_func(filter, profile);
+	else if (print_error)
+		print_accel_error(filter, profile);
 	else if (print_delta)
 		print_ptraccel_deltas(filter, step);
 	else if (print_motion)
@@ -0,0 +1,120 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#ifndef _RECORD_FORMAT_H_
+#define _RECORD_FORMAT_H_
+
+#include <stdint.h>
+
+/*
+ * The recording format written by libinput-record and read by
+ * libinput-replay. It is designed to be mmap()ed and used in place,
+ * there is nothing to parse: every section has a fixed size and
+ * 8-byte alignment, all integers are in the byte order of the
+ * recording host.
+ *
+ *   struct record_header			at offset 0
+ *   struct record_device[ndevices]		at sizeof(struct record_header)
+ *   struct record_event[nevents]		at events_offset
+ *
+ * A device holds what libinput reads from the kernel and from udev at
+ * device creation time: the IDs, the name, the property and event
+ * code bits, the absinfo of every axis and the udev properties that
+ * influence libinput (ID_INPUT*, LIBINPUT_*, MOUSE_*, POINTINGSTICK_*
+ * and TOUCHPAD_*).
+ *
+ * The events of all devices are a single stream in the order libinput
+ * received them, each referring to its device by index. The stream is
+ * what libevdev passes on to libinput, i.e. after a SYN_DROPPED it
+ * contains the SYN_REPORT and the sync events libinput processes in
+ * place of the dropped ones.
+ *
+ * The array sizes are fixed here rather than taken from linux/input.h
+ * so the layout doesn't change with the kernel headers.
+ */
+
+#define RECORD_MAGIC "LIREC001"
+#define RECORD_BYTEORDER 0x01020304
+
+#define RECORD_NAME_LEN 128
+#define RECORD_PROP_CNT 0x20		/* INPUT_PROP_CNT */
+#define RECORD_EV_CNT 0x20		/* EV_CNT */
+#define RECORD_CODE_CNT 0x300		/* KEY_CNT, the largest type */
+#define RECORD_ABS_CNT 0x40		/* ABS_CNT */
+#define RECORD_PROPERTIES_LEN 1024
+
+struct record_header {
+	char magic[8];			/* RECORD_MAGIC, not NUL-terminated */
+	uint32_t byteorder;		/* RECORD_BYTEORDER */
+	uint32_t ndevices;
+	uint64_t nevents;
+	uint64_t events_offset;		/* in bytes from the start */
+};
+
+struct record_absinfo {
+	int32_t value;
+	int32_t minimum;
+	int32_t maximum;
+	int32_t fuzz;
+	int32_t flat;
+	int32_t resolution;
+};
+
+struct record_device {
+	char name[RECORD_NAME_LEN];	/* NUL-terminated */
+	uint16_t bustype;
+	uint16_t vendor;
+	uint16_t product;
+	uint16_t version;
+	uint8_t props[RECORD_PROP_CNT / 8];
+	uint8_t padding[4];
+	/* bits[type][code / 8] & (1 << (code % 8)) */
+	uint8_t bits[RECORD_EV_CNT][RECORD_CODE_CNT / 8];
+	struct record_absinfo absinfo[RECORD_ABS_CNT];
+	/* KEY=value strings, each NUL-terminated, the list ends with an
+	 * empty string */
+	char properties[RECORD_PROPERTIES_LEN];
+};
+
+struct record_event {
+	uint64_t time;			/* in us, CLOCK_MONOTONIC */
+	uint32_t device;		/* index into the devices */
+	uint16_t type;
+	uint16_t code;
+	int32_t value;
+	uint32_t padding;
+};
+
+static inline int
+record_bit_is_set(const uint8_t *bits, unsigned int bit)
+{
+	return !!(bits[bit / 8] & (1 << (bit % 8)));
+}
+
+static inline void
+record_set_bit(uint8_t *bits, unsigned int bit)
+{
+	bits[bit / 8] |= (1 << (bit % 8));
+}
+
+#endif
@@ -0,0 +1,238 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <libevdev/libevdev.h>
+#include <libinput-util.h>
+
+#include "record-replay.h"
+
+static const char *
+validate_recording(const void *data, size_t size)
+{
+	const struct record_header *header = data;
+	const struct record_device *devices;
+	uint32_t i;
+
+	if (size < sizeof(*header) ||
+	    memcmp(header->magic, RECORD_MAGIC, sizeof(header->magic)) != 0)
+		return "not a libinput recording";
+
+	if (header->byteorder != RECORD_BYTEORDER)
+		return "recorded on a host with a different byte order";
+
+	if (header->ndevices > (size - sizeof(*header)) / sizeof(*devices) ||
+	    header->events_offset != sizeof(*header) +
+				     header->ndevices * sizeof(*devices))
+		return "invalid device section";
+
+	if (header->nevents > (size - header->events_offset) /
+			      sizeof(struct record_event))
+		return "truncated event section";
+
+	devices = (const struct record_device *)(header + 1);
+	for (i = 0; i < header->ndevices; i++) {
+		if (devices[i].name[sizeof(devices[i].name) - 1] != '\0' ||
+		    devices[i].properties[sizeof(devices[i].properties) - 1] != '\0')
+			return "invalid device description";
+	}
+
+	return NULL;
+}
+
+const char *
+record_file_open(struct record_file *file, const char *path)
+{
+	struct stat st;
+	const char *error;
+	int fd;
+
+	memset(file, 0, sizeof(*file));
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return strerror(errno);
+
+	if (fstat(fd, &st) < 0) {
+		error = strerror(errno);
+		close(fd);
+		return error;
+	}
+
+	if (st.st_size > 0)
+		file->data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+				  fd, 0);
+	close(fd);
+
+	if (!file->data || file->data == MAP_FAILED) {
+		file->data = NULL;
+		return "failed to map the file";
+	}
+	file->size = st.st_size;
+
+	error = validate_recording(file->data, file->size);
+	if (error) {
+		record_file_close(file);
+		return error;
+	}
+
+	file->header = file->data;
+	file->devices = (const struct record_device *)(file->header + 1);
+	file->events = (const struct record_event *)
+		((const char *)file->data + file->header->events_offset);
+
+	return NULL;
+}
+
+void
+record_file_close(struct record_file *file)
+{
+	if (file->data)
+		munmap(file->data, file->size);
+	memset(file, 0, sizeof(*file));
+}
+
+static struct libevdev *
+record_device_description(const struct record_device *d)
+{
+	struct libevdev *evdev;
+	struct input_absinfo abs;
+	unsigned int type, code;
+	int rep = 0;
+
+	evdev = libevdev_new();
+	if (!evdev)
+		return NULL;
+
+	libevdev_set_name(evdev, d->name);
+	libevdev_set_id_bustype(evdev, d->bustype);
+	libevdev_set_id_vendor(evdev, d->vendor);
+	libevdev_set_id_product(evdev, d->product);
+	libevdev_set_id_version(evdev, d->version);
+
+	for (code = 0; code < RECORD_PROP_CNT; code++) {
+		if (record_bit_is_set(d->props, code))
+			libevdev_enable_property(evdev, code);
+	}
+
+	for (type = 0; type < RECORD_EV_CNT; type++) {
+		for (code = 0; code < RECORD_CODE_CNT; code++) {
+			if (!record_bit_is_set(d->bits[type], code))
+				continue;
+
+			switch (type) {
+			case EV_ABS:
+				if (code >= RECORD_ABS_CNT)
+					break;
+				abs.value = d->absinfo[code].value;
+				abs.minimum = d->absinfo[code].minimum;
+				abs.maximum = d->absinfo[code].maximum;
+				abs.fuzz = d->absinfo[code].fuzz;
+				abs.flat = d->absinfo[code].flat;
+				abs.resolution = d->absinfo[code].resolution;
+				libevdev_enable_event_code(evdev, type, code, &abs);
+				break;
+			case EV_REP:
+				libevdev_enable_event_code(evdev, type, code, &rep);
+				break;
+			default:
+				libevdev_enable_event_code(evdev, type, code, NULL);
+				break;
+			}
+		}
+	}
+
+	return evdev;
+}
+
+struct libinput_device *
+record_add_device(struct libinput *libinput,
+		  const struct record_device *d)
+{
+	const char *properties[RECORD_PROPERTIES_LEN / 2 + 1];
+	const char *p = d->properties;
+	struct libinput_device *device;
+	struct libevdev *evdev;
+	size_t n = 0;
+
+	while (*p) {
+		properties[n++] = p;
+		p += strlen(p) + 1;
+		if (p >= d->properties + sizeof(d->properties))
+			break;
+	}
+	properties[n] = NULL;
+
+	evdev = record_device_description(d);
+	if (!evdev)
+		return NULL;
+
+	device = libinput_replay_add_device(libinput, evdev, properties);
+	if (!device) {
+		libevdev_free(evdev);
+		return NULL;
+	}
+
+	return device;
+}
+
+int
+record_push_events(const struct record_file *file,
+		   struct libinput_device **devices,
+		   uint64_t *index)
+{
+	const struct record_event *events = file->events;
+	struct input_event buf[64];
+	uint64_t i = *index;
+	uint32_t device;
+	size_t n = 0;
+
+	device = events[i].device;
+	if (device >= file->header->ndevices)
+		return -1;
+
+	while (i < file->header->nevents &&
+	       events[i].device == device &&
+	       n < ARRAY_LENGTH(buf)) {
+		buf[n].time.tv_sec = events[i].time / 1000000;
+		buf[n].time.tv_usec = events[i].time % 1000000;
+		buf[n].type = events[i].type;
+		buf[n].code = events[i].code;
+		buf[n].value = events[i].value;
+		n++;
+		i++;
+	}
+
+	if (devices[device])
+		libinput_replay_device_push_events(devices[device], buf, n);
+	*index = i;
+
+	return n;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef _RECORD_REPLAY_H_
+#define _RECORD_REPLAY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libinput.h>
+
+#include "record-format.h"
+
+/* A recording made with libinput-record, mapped into memory */
+struct record_file {
+	void *data;
+	size_t size;
+	const struct record_header *header;
+	const struct record_device *devices;
+	const struct record_event *events;
+};
+
+/* Returns NULL on success or a description of the error */
+const char *
+record_file_open(struct record_file *file, const char *path);
+
+void
+record_file_close(struct record_file *file);
+
+/* Adds a recorded device to a context created with
+ * libinput_replay_create_context() */
+struct libinput_device *
+record_add_device(struct libinput *libinput,
+		  const struct record_device *device);
+
+/*
+ * Pushes the events from *index onwards up to the next event of another
+ * device through libinput_replay_device_push_events() and advances *index
+ * past them. Events of a device that is NULL in devices are skipped.
+ * Returns the number of events or -1 if the event at *index refers to an
+ * invalid device.
+ */
+int
+record_push_events(const struct record_file *file,
+		   struct libinput_device **devices,
+		   uint64_t *index);
+
+#endif
@@ -52,6 +52,8 @@ enum options {
 	OPT_SCROLL_METHOD,
 	OPT_SCROLL_BUTTON,
 	OPT_SPEED,
+	OPT_SHOW_LATENCY,
+	OPT_POINTER_FRAMES,
 };
 
 static void
@@ -90,6 +92,8 @@ tools_usage()
 	       "\n"
 	       "Other options:\n"
 	       "--verbose ....... Print debugging output.\n"
+	       "--show-latency .. Print per-device latency histograms every second.\n"
+	       "--pointer-frames  Terminate each hardware report with a pointer frame.\n"
 	       "--help .......... Print this help.\n",
 		program_invocation_short_name);
 }
@@ -133,6 +137,8 @@ tools_parse_args(int argc, char **argv, struct tools_options *options)
 			{ "set-scroll-method", 1, 0, OPT_SCROLL_METHOD },
 			{ "set-scroll-button", 1, 0, OPT_SCROLL_BUTTON },
 			{ "speed", 1, 0, OPT_SPEED },
+			{ "show-latency", 0, 0, OPT_SHOW_LATENCY },
+			{ "pointer-frames", 0, 0, OPT_POINTER_FRAMES },
 			{ 0, 0, 0, 0}
 		};
 
@@ -161,6 +167,12 @@ tools_parse_args(int argc, char **argv, struct tools_options *options)
 			case OPT_VERBOSE: /* --verbose */
 				options->verbose = 1;
 				break;
+			case OPT_SHOW_LATENCY: /* --show-latency */
+				options->show_latency = 1;
+				break;
+			case OPT_POINTER_FRAMES: /* --pointer-frames */
+				options->pointer_frames = 1;
+				break;
 			case OPT_TAP_ENABLE:
 				options->tapping = 1;
 				break;
@@ -344,6 +356,9 @@ tools_open_backend(struct tools_options *options,
 	} else
 		abort();
 
+	if (li && options->pointer_frames)
+		libinput_set_pointer_frames(li, 1);
+
 	return li;
 }
 
@@ -376,3 +391,40 @@ tools_device_apply_config(struct libinput_device *device,
 		libinput_device_config_accel_set_speed(device,
 						       options->speed);
 }
+
+const char *
+tools_event_type_name(enum libinput_event_type type)
+{
+	switch(type) {
+	case LIBINPUT_EVENT_NONE:
+		abort();
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+		return "DEVICE_ADDED";
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		return "DEVICE_REMOVED";
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return "KEYBOARD_KEY";
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		return "POINTER_MOTION";
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+		return "POINTER_MOTION_ABSOLUTE";
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+		return "POINTER_BUTTON";
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		return "POINTER_AXIS";
+	case LIBINPUT_EVENT_POINTER_FRAME:
+		return "POINTER_FRAME";
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+		return "TOUCH_DOWN";
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+		return "TOUCH_MOTION";
+	case LIBINPUT_EVENT_TOUCH_UP:
+		return "TOUCH_UP";
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+		return "TOUCH_CANCEL";
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		return "TOUCH_FRAME";
+	}
+
+	return NULL;
+}
@@ -36,6 +36,8 @@ struct tools_options {
 	const char *seat; /* if backend is BACKEND_UDEV */
 
 	int verbose;
+	int show_latency;
+	int pointer_frames;
 	int tapping;
 	int natural_scroll;
 	int left_handed;
@@ -54,5 +56,6 @@ struct libinput* tools_open_backend(struct tools_options *options,
 void tools_device_apply_config(struct libinput_device *device,
 			       struct tools_options *options);
 void tools_usage();
+const char *tools_event_type_name(enum libinput_event_type type);
 
 #endif
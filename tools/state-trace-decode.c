@@ -0,0 +1,185 @@
+/*
+ * Copyright © 2015 Red Hat, Inc.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and
+ * its documentation for any purpose is hereby granted without fee, provided
+ * that the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of the copyright holders not be used in
+ * advertising or publicity pertaining to distribution of the software
+ * without specific, written prior permission.  The copyright holders make
+ * no representations about the suitability of this software for any
+ * purpose.  It is provided "as is" without express or implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <state-trace.h>
+
+static void
+usage(void)
+{
+	printf("Usage: %s [file]\n"
+	       "\n"
+	       "Print a state trace written by libinput_device_dump_state_trace()\n"
+	       "as text. Reads from stdin if no file is given.\n",
+	       program_invocation_short_name);
+}
+
+static char *
+read_file(FILE *fp, size_t *len)
+{
+	char *data = NULL, *tmp;
+	size_t size = 0, n;
+
+	*len = 0;
+	do {
+		if (*len == size) {
+			size = size ? size * 2 : 4096;
+			tmp = realloc(data, size);
+			if (!tmp) {
+				free(data);
+				return NULL;
+			}
+			data = tmp;
+		}
+		n = fread(data + *len, 1, size - *len, fp);
+		*len += n;
+	} while (n > 0);
+
+	if (ferror(fp)) {
+		free(data);
+		return NULL;
+	}
+
+	return data;
+}
+
+static int
+decode(const char *data, size_t len)
+{
+	struct state_trace_file_header header;
+	struct state_trace_file_record record;
+	const char **strings;
+	const char *p = data, *end = data + len;
+	uint64_t start = 0;
+	uint32_t i;
+
+	if (len < sizeof(header)) {
+		fprintf(stderr, "Truncated header\n");
+		return 1;
+	}
+
+	memcpy(&header, p, sizeof(header));
+	p += sizeof(header);
+	if (memcmp(header.magic, STATE_TRACE_MAGIC, sizeof(header.magic)) != 0) {
+		fprintf(stderr, "Not a libinput state trace\n");
+		return 1;
+	}
+
+	strings = calloc(header.nstrings + 1, sizeof *strings);
+	if (!strings)
+		return 1;
+
+	for (i = 0; i < header.nstrings; i++) {
+		strings[i] = p;
+		p = memchr(p, '\0', end - p);
+		if (!p) {
+			fprintf(stderr, "Truncated string table\n");
+			free(strings);
+			return 1;
+		}
+		p++;
+	}
+
+	if ((size_t)(end - p) / sizeof(record) < header.nrecords) {
+		fprintf(stderr, "Truncated trace, expected %u records\n",
+			header.nrecords);
+		free(strings);
+		return 1;
+	}
+
+	for (i = 0; i < header.nrecords; i++) {
+		memcpy(&record, p, sizeof(record));
+		p += sizeof(record);
+
+		if (record.machine >= header.nstrings ||
+		    record.from >= header.nstrings ||
+		    record.event >= header.nstrings ||
+		    record.to >= header.nstrings) {
+			fprintf(stderr, "Invalid record %u\n", i);
+			free(strings);
+			return 1;
+		}
+
+		if (i == 0)
+			start = record.time;
+
+		printf("%4" PRIu64 ".%06" PRIu64 " %-12s ",
+		       (record.time - start) / 1000000,
+		       (record.time - start) % 1000000,
+		       strings[record.machine]);
+		if (record.touch == STATE_TRACE_NO_TOUCH)
+			printf("    ");
+		else
+			printf("[%d] ", record.touch);
+		printf("%s → %s → %s\n",
+		       strings[record.from],
+		       strings[record.event],
+		       strings[record.to]);
+	}
+
+	free(strings);
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	FILE *fp = stdin;
+	char *data;
+	size_t len;
+	int rc;
+
+	if (argc > 2 ||
+	    (argc == 2 && strcmp(argv[1], "--help") == 0)) {
+		usage();
+		return argc > 2;
+	}
+
+	if (argc == 2) {
+		fp = fopen(argv[1], "rb");
+		if (!fp) {
+			fprintf(stderr, "Failed to open %s: %s\n",
+				argv[1], strerror(errno));
+			return 1;
+		}
+	}
+
+	data = read_file(fp, &len);
+	if (fp != stdin)
+		fclose(fp);
+	if (!data) {
+		fprintf(stderr, "Failed to read the trace\n");
+		return 1;
+	}
+
+	rc = decode(data, len);
+	free(data);
+
+	return rc;
+}